@@ -0,0 +1,72 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+
+/**
+ *  @file SDL_omapdss.h
+ *  Extensions only available with the omapdss video driver
+ */
+
+#ifndef _SDL_omapdss_h
+#define _SDL_omapdss_h
+
+#include "SDL_stdinc.h"
+
+#include "begin_code.h"
+/* Set up for C function definitions, even when using C++ */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SDL_OMAP_STATS_HIST	16	/**< flip latency buckets, 2ms each */
+#define SDL_OMAP_STATS_LOG	32	/**< recent frame timestamps kept */
+
+/** Frame timing stats, collected since they were first requested
+ *  (or since SDL_SetVideoMode() with SDL_OMAP_STATS set).
+ *  A frame is a SDL_Flip() or SDL_UpdateRects() call, times are in
+ *  microseconds, "copy" is the driver's work to get a frame on screen.
+ */
+typedef struct SDL_OMAP_Stats {
+	Uint32 frames;
+	Uint32 missed_vblanks;	/**< vblanks that passed without a new frame */
+	Uint32 frame_us_last, frame_us_avg, frame_us_max;
+	Uint32 flip_us_avg, flip_us_max;	/**< time spent flipping */
+	Uint32 copy_us_avg, copy_us_max;
+	Uint32 copy_bytes_last, copy_bytes_avg;
+	/** time from flip to the vsync that shows the frame, the last
+	 *  bucket counts everything longer; needs vsync or async flips */
+	Uint32 latency_hist[SDL_OMAP_STATS_HIST];
+	/** CLOCK_MONOTONIC times of the last frames, oldest first, 0 if none */
+	Uint64 frame_time_us[SDL_OMAP_STATS_LOG];
+} SDL_OMAP_Stats;
+
+/** Fills in the stats and starts collecting them if that wasn't done yet.
+ *  @return 0 on success, -1 if the omapdss driver is not in use
+ */
+extern DECLSPEC int SDLCALL SDL_OMAP_GetStats(SDL_OMAP_Stats *stats);
+
+/* Ends C function definitions when using C++ */
+#ifdef __cplusplus
+}
+#endif
+#include "close_code.h"
+
+#endif /* _SDL_omapdss_h */
@@ -131,6 +131,7 @@ typedef struct SDL_Surface {
 #define SDL_SWSURFACE	0x00000000	/**< Surface is in system memory */
 #define SDL_HWSURFACE	0x00000001	/**< Surface is in video memory */
 #define SDL_ASYNCBLIT	0x00000004	/**< Use asynchronous blits if possible */
+#define SDL_PREMULALPHA	0x00020000	/**< Color channels are premultiplied by alpha */
 /*@}*/
 
 /** Available for SDL_SetVideoMode() */
@@ -202,6 +203,11 @@ typedef struct SDL_VideoInfo {
 #define SDL_YUY2_OVERLAY  0x32595559	/**< Packed mode: Y0+U0+Y1+V0 (1 plane) */
 #define SDL_UYVY_OVERLAY  0x59565955	/**< Packed mode: U0+Y0+V0+Y1 (1 plane) */
 #define SDL_YVYU_OVERLAY  0x55595659	/**< Packed mode: Y0+V0+Y1+U0 (1 plane) */
+#define SDL_NV12_OVERLAY  0x3231564E	/**< Planar mode: Y + U0+V0  (2 planes) */
+#define SDL_NV21_OVERLAY  0x3132564E	/**< Planar mode: Y + V0+U0  (2 planes) */
+#define SDL_P010_OVERLAY  0x30313050	/**< Planar mode: Y + U0+V0, 16 bit
+					     little endian, 10 bits at the top
+					     (2 planes) */
 /*@}*/
 
 /** The YUV hardware video overlay */
@@ -541,6 +547,9 @@ extern DECLSPEC void SDLCALL SDL_GetRGBA(Uint32 pixel,
  * if the hardware supports hardware acceleration of alpha blits between
  * two surfaces in video memory, to place the surface in video memory
  * if possible, otherwise it will be placed in system memory.
+ * SDL_PREMULALPHA means that the colors of a surface with an alpha channel
+ * are premultiplied by alpha, see SDL_SetAlpha().  It is ignored without
+ * 'Amask'.
  * If the surface is created in video memory, blits will be _much_ faster,
  * but the surface format must be identical to the video surface format,
  * and the only way to access the pixels member of the surface is to use
@@ -580,6 +589,18 @@ extern DECLSPEC void SDLCALL SDL_FreeSurface(SDL_Surface *surface);
 extern DECLSPEC int SDLCALL SDL_LockSurface(SDL_Surface *surface);
 extern DECLSPEC void SDLCALL SDL_UnlockSurface(SDL_Surface *surface);
 
+/**
+ * SDL_LockSurfaceReadOnly() is like SDL_LockSurface(), but promises that
+ * the pixels are only read.  RLE accelerated surfaces keep their encoding
+ * this way instead of having it redone after SDL_UnlockSurface().  The
+ * pixels must not be changed, a SDL_LockSurface() call on a surface that
+ * is locked read-only makes it writable as usual.
+ *
+ * SDL_LockSurfaceReadOnly() returns 0, or -1 if the surface couldn't be
+ * locked.
+ */
+extern DECLSPEC int SDLCALL SDL_LockSurfaceReadOnly(SDL_Surface *surface);
+
 /**
  * Load a surface from a seekable SDL data source (memory or file.)
  * If 'freesrc' is non-zero, the source will be closed after being read.
@@ -629,6 +650,12 @@ extern DECLSPEC int SDLCALL SDL_SetColorKey
  * surface; if SDL_RLEACCEL is not specified, the RLE accel will be removed.
  *
  * The 'alpha' parameter is ignored for surfaces that have an alpha channel.
+ *
+ * Surfaces with an alpha channel that were created with SDL_PREMULALPHA
+ * hold colors already multiplied by their alpha, and are blended as
+ * dst = src + dst * (255 - alpha) / 255, which also composites the
+ * destination alpha channel.  The color channels must not be larger
+ * than alpha.
  */
 extern DECLSPEC int SDLCALL SDL_SetAlpha(SDL_Surface *surface, Uint32 flag, Uint8 alpha);
 
@@ -663,6 +690,13 @@ extern DECLSPEC void SDLCALL SDL_GetClipRect(SDL_Surface *surface, SDL_Rect *rec
  * SDL will try to RLE accelerate colorkey and alpha blits in the resulting
  * surface.
  *
+ * If SDL_PREMULALPHA is passed and 'fmt' has an alpha channel, the new
+ * surface is premultiplied, otherwise a premultiplied source gets its
+ * colors divided by alpha again.  This is only done when both formats
+ * have an alpha channel: converting a premultiplied surface to a format
+ * without one keeps the premultiplied colors, i.e. the image as if it
+ * was blended onto black.
+ *
  * This function is used internally by SDL_DisplayFormat().
  */
 extern DECLSPEC SDL_Surface * SDLCALL SDL_ConvertSurface
@@ -767,6 +801,43 @@ extern DECLSPEC int SDLCALL SDL_LowerBlit
 extern DECLSPEC int SDLCALL SDL_FillRect
 		(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color);
 
+/**
+ * Same as SDL_FillRect() for each of the 'count' rectangles, but the
+ * surface is locked only once. Each rectangle is clipped in place.
+ * This function returns 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_FillRects
+		(SDL_Surface *dst, SDL_Rect *rects, int count, Uint32 color);
+
+/** @name Stretch filters for SDL_StretchBlit() */
+/*@{*/
+#define SDL_STRETCH_NEAREST	0
+#define SDL_STRETCH_BILINEAR	1
+/*@}*/
+
+/**
+ * This performs a scaled blit from the source rectangle to the
+ * destination rectangle, which may have different sizes.
+ * If 'srcrect' is NULL the whole source surface is used, otherwise it
+ * must lie within the source surface.
+ * If 'dstrect' is NULL the whole destination surface is used, otherwise
+ * its x, y, w and h give the area to stretch to.  That area is clipped
+ * to the destination clip rectangle and the final blit rectangle is
+ * saved in 'dstrect' after all clipping is performed.
+ *
+ * Like SDL_BlitSurface(), the surfaces may have any formats and the
+ * source colorkey and alpha settings are honored.  'filter' is one of
+ * SDL_STRETCH_NEAREST or SDL_STRETCH_BILINEAR.  Bilinear filtering
+ * blends the 2x2 nearest source pixels, so downscaling by more than
+ * half skips pixels.
+ *
+ * The surfaces must not be locked.
+ * This function returns 0 on success, or -1 on error.
+ */
+extern DECLSPEC int SDLCALL SDL_StretchBlit
+			(SDL_Surface *src, SDL_Rect *srcrect,
+			 SDL_Surface *dst, SDL_Rect *dstrect, int filter);
+
 /**
  * This function takes a surface and copies it to a new surface of the
  * pixel format and colors of the video framebuffer, suitable for fast
@@ -794,6 +865,16 @@ extern DECLSPEC SDL_Surface * SDLCALL SDL_DisplayFormat(SDL_Surface *surface);
  */
 extern DECLSPEC SDL_Surface * SDLCALL SDL_DisplayFormatAlpha(SDL_Surface *surface);
 
+/**
+ * This works like SDL_DisplayFormatAlpha(), but the new surface has
+ * premultiplied alpha (SDL_PREMULALPHA), which blends faster.
+ * SDL_DisplayFormatAlpha() keeps surfaces that are already premultiplied
+ * that way too.
+ *
+ * If the conversion fails or runs out of memory, it returns NULL
+ */
+extern DECLSPEC SDL_Surface * SDLCALL SDL_DisplayFormatPremulAlpha(SDL_Surface *surface);
+
 
 /* * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * * */
 /** @name YUV video surface overlay functions                                */ /*@{*/
@@ -47,6 +47,11 @@ extern void SDL_StartTicks(void);
 extern int  SDL_TimerInit(void);
 extern void SDL_TimerQuit(void);
 #endif
+extern int  SDL_BlitThreadsInit(void);
+extern void SDL_BlitThreadsQuit(void);
+extern void SDL_RLEThreadQuit(void);
+extern void SDL_FreePaletteMaps(void);
+extern void SDL_ResetNeonBlitFeatures(void);
 
 /* The current SDL version */
 static SDL_version version = 
@@ -163,6 +168,9 @@ int SDL_Init(Uint32 flags)
 		return(-1);
 	}
 
+	/* Start the software blit threads, if requested */
+	SDL_BlitThreadsInit();
+
 	/* Everything is initialized */
 	if ( !(flags & SDL_INIT_NOPARACHUTE) ) {
 		SDL_InstallParachute();
@@ -219,7 +227,13 @@ void SDL_Quit(void)
 #ifdef DEBUG_BUILD
   printf("[SDL_Quit] : Enter! Calling QuitSubSystem()\n"); fflush(stdout);
 #endif
+	/* The blit threads finish their bands first, before the video
+	   surfaces they may write to are gone */
+	SDL_BlitThreadsQuit();
 	SDL_QuitSubSystem(SDL_INIT_EVERYTHING);
+	SDL_RLEThreadQuit();
+	SDL_FreePaletteMaps();
+	SDL_ResetNeonBlitFeatures();
 
 #ifdef CHECK_LEAKS
 #ifdef DEBUG_BUILD
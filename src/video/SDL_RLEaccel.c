@@ -82,11 +82,17 @@
  *   for the translucent lines. Two padding bytes may be inserted
  *   before each translucent line to keep them 32-bit aligned.
  *
+ *   When NEON blitting is enabled, translucent runs for 565 targets
+ *   are extended over following fully transparent pixels until their
+ *   length is a multiple of 4, so that they can be blended in groups of
+ *   4. Such pixels are stored as 0, which blends to no change.
+ *
  *   The end of the sequence is marked by a zero <skip>,<run> pair at the
  *   beginning of an opaque line.
  */
 
 #include "SDL_video.h"
+#include "SDL_thread.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
 #include "SDL_RLEaccel_c.h"
@@ -107,6 +113,62 @@
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
 #endif
 
+#ifdef __ARM_NEON__
+
+/*
+ * NEON run decoders. They do groups of 4 translucent pixels or 32 bytes
+ * of opaque ones, the rest is left to the C code. rle_neon is updated
+ * from SDL_GetNeonBlitFeatures() each time a surface is encoded.
+ */
+extern void neon_rle_transl_16(Uint16 *dst, const Uint32 *src, int count,
+			       Uint32 mask);
+extern void neon_rle_transl_32(Uint32 *dst, const Uint32 *src, int count);
+extern void neon_rle_copy(void *dst, const void *src, int bytes);
+
+static int rle_neon = 1;
+
+static void RLENeonFeatures(void)
+{
+    rle_neon = (SDL_GetNeonBlitFeatures() & SDL_BLIT_FEATURE_NEON) != 0;
+}
+
+/* shorter runs aren't worth the call */
+#define NEON_COPY_MIN 64
+
+static void neon_pixel_copy(Uint8 *to, Uint8 *from, size_t bytes)
+{
+    size_t len = bytes & ~31;
+    neon_rle_copy(to, from, (int)len);
+    if(bytes != len)
+	SDL_memcpy(to + len, from + len, bytes - len);
+}
+
+#define PIXEL_COPY(to, from, len, bpp)			\
+do {							\
+    if(rle_neon && (size_t)(len) * (bpp) >= NEON_COPY_MIN) {	\
+	neon_pixel_copy((Uint8 *)(to), (Uint8 *)(from),	\
+			(size_t)(len) * (bpp));		\
+    } else if(bpp == 4) {				\
+	SDL_memcpy4(to, from, (size_t)(len));		\
+    } else {						\
+	SDL_memcpy(to, from, (size_t)(len) * (bpp));	\
+    }							\
+} while(0)
+
+/* blend as many translucent pixels as possible, return how many */
+#define NEON_TRANSL_16(dst, src, n, mask)				\
+    (rle_neon && (n) >= 4						\
+     ? (neon_rle_transl_16(dst, src, (int)(n) & ~3, mask), (n) & ~3) : 0)
+#define NEON_TRANSL_565(dst, src, n)	\
+    NEON_TRANSL_16(dst, src, n, 0x07e0f81f)
+#define NEON_TRANSL_555(dst, src, n)	\
+    NEON_TRANSL_16(dst, src, n, 0x03e07c1f)
+#define NEON_TRANSL_888(dst, src, n)					\
+    (rle_neon && (n) >= 4						\
+     ? (neon_rle_transl_32(dst, src, (int)(n) & ~3), (n) & ~3) : 0)
+
+#else
+
 #define PIXEL_COPY(to, from, len, bpp)			\
 do {							\
     if(bpp == 4) {					\
@@ -116,6 +178,12 @@ do {							\
     }							\
 } while(0)
 
+#define NEON_TRANSL_565(dst, src, n) 0
+#define NEON_TRANSL_555(dst, src, n) 0
+#define NEON_TRANSL_888(dst, src, n) 0
+
+#endif /* __ARM_NEON__ */
+
 /*
  * Various colorkey blit methods, for opaque and per-surface alpha
  */
@@ -835,6 +903,11 @@ static void RLEClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
 }
 
 
+/* for surfaces being encoded in the background */
+static int RLEJobDone(SDL_Surface *surface);
+static int RLEOriginalBlit(SDL_Surface *src, SDL_Rect *srcrect,
+			   SDL_Surface *dst, SDL_Rect *dstrect);
+
 /* blit a colorkeyed RLE surface */
 int SDL_RLEBlit(SDL_Surface *src, SDL_Rect *srcrect,
 		SDL_Surface *dst, SDL_Rect *dstrect)
@@ -845,6 +918,11 @@ int SDL_RLEBlit(SDL_Surface *src, SDL_Rect *srcrect,
 	int w = src->w;
 	unsigned alpha;
 
+	/* Not encoded yet? */
+	if ( src->map->sw_data->rle_job && !RLEJobDone(src) ) {
+		return(RLEOriginalBlit(src, srcrect, dst, dstrect));
+	}
+
 	/* Lock the destination if necessary */
 	if ( SDL_MUSTLOCK(dst) ) {
 		if ( SDL_LockSurface(dst) < 0 ) {
@@ -1017,10 +1095,10 @@ static void RLEAlphaClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
     SDL_PixelFormat *df = dst->format;
     /*
      * clipped blitter: Ptype is the destination pixel type,
-     * Ctype the translucent count type, and do_blend the macro
-     * to blend one pixel.
+     * Ctype the translucent count type, do_blend the macro
+     * to blend one pixel and do_run the one to start a run with.
      */
-#define RLEALPHACLIPBLIT(Ptype, Ctype, do_blend)			  \
+#define RLEALPHACLIPBLIT(Ptype, Ctype, do_blend, do_run)		  \
     do {								  \
 	int linecount = srcrect->h;					  \
 	int left = srcrect->x;						  \
@@ -1076,8 +1154,8 @@ static void RLEAlphaClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
 		    if(crun > 0) {					  \
 			Ptype *dst = (Ptype *)dstbuf + cofs;		  \
 			Uint32 *src = (Uint32 *)srcbuf + (cofs - ofs);	  \
-			int i;						  \
-			for(i = 0; i < crun; i++)			  \
+			int i = do_run(dst, src, crun);			  \
+			for(; i < crun; i++)				  \
 			    do_blend(src[i], dst[i]);			  \
 		    }							  \
 		    srcbuf += run * 4;					  \
@@ -1092,12 +1170,12 @@ static void RLEAlphaClipBlit(int w, Uint8 *srcbuf, SDL_Surface *dst,
     case 2:
 	if(df->Gmask == 0x07e0 || df->Rmask == 0x07e0
 	   || df->Bmask == 0x07e0)
-	    RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_565);
+	    RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_565, NEON_TRANSL_565);
 	else
-	    RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_555);
+	    RLEALPHACLIPBLIT(Uint16, Uint8, BLIT_TRANSL_555, NEON_TRANSL_555);
 	break;
     case 4:
-	RLEALPHACLIPBLIT(Uint32, Uint16, BLIT_TRANSL_888);
+	RLEALPHACLIPBLIT(Uint32, Uint16, BLIT_TRANSL_888, NEON_TRANSL_888);
 	break;
     }
 }
@@ -1111,6 +1189,10 @@ int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
     Uint8 *srcbuf, *dstbuf;
     SDL_PixelFormat *df = dst->format;
 
+    /* Not encoded yet? */
+    if(src->map->sw_data->rle_job && !RLEJobDone(src))
+	return RLEOriginalBlit(src, srcrect, dst, dstrect);
+
     /* Lock the destination if necessary */
     if ( SDL_MUSTLOCK(dst) ) {
 	if ( SDL_LockSurface(dst) < 0 ) {
@@ -1187,10 +1269,10 @@ int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
 
 	/*
 	 * non-clipped blitter. Ptype is the destination pixel type,
-	 * Ctype the translucent count type, and do_blend the
-	 * macro to blend one pixel.
+	 * Ctype the translucent count type, do_blend the macro
+	 * to blend one pixel and do_run the one to start a run with.
 	 */
-#define RLEALPHABLIT(Ptype, Ctype, do_blend)				 \
+#define RLEALPHABLIT(Ptype, Ctype, do_blend, do_run)			 \
 	do {								 \
 	    int linecount = srcrect->h;					 \
 	    do {							 \
@@ -1221,8 +1303,10 @@ int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
 		    srcbuf += 4;					 \
 		    if(run) {						 \
 			Ptype *dst = (Ptype *)dstbuf + ofs;		 \
-			unsigned i;					 \
-			for(i = 0; i < run; i++) {			 \
+			unsigned i = do_run(dst, (Uint32 *)srcbuf, run); \
+			srcbuf += i * 4;				 \
+			dst += i;					 \
+			for(; i < run; i++) {				 \
 			    Uint32 src = *(Uint32 *)srcbuf;		 \
 			    do_blend(src, *dst);			 \
 			    srcbuf += 4;				 \
@@ -1239,12 +1323,12 @@ int SDL_RLEAlphaBlit(SDL_Surface *src, SDL_Rect *srcrect,
 	case 2:
 	    if(df->Gmask == 0x07e0 || df->Rmask == 0x07e0
 	       || df->Bmask == 0x07e0)
-		RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_565);
+		RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_565, NEON_TRANSL_565);
 	    else
-		RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_555);
+		RLEALPHABLIT(Uint16, Uint8, BLIT_TRANSL_555, NEON_TRANSL_555);
 	    break;
 	case 4:
-	    RLEALPHABLIT(Uint32, Uint16, BLIT_TRANSL_888);
+	    RLEALPHABLIT(Uint32, Uint16, BLIT_TRANSL_888, NEON_TRANSL_888);
 	    break;
 	}
     }
@@ -1314,6 +1398,8 @@ static int copy_transl_565(void *dst, Uint32 *src, int n,
 	RGBA_FROM_8888(*src, sfmt, r, g, b, a);
 	PIXEL_FROM_RGB(pix, dfmt, r, g, b);
 	*d = ((pix & 0x7e0) << 16) | (pix & 0xf81f) | ((a << 2) & 0x7e0);
+	if(!a)
+	    *d = 0;		/* run alignment padding */
 	src++;
 	d++;
     }
@@ -1395,14 +1481,15 @@ static int uncopy_32(Uint32 *dst, void *src, int n,
 #define ISTRANSL(pixel, fmt)	\
     ((unsigned)((((pixel) & fmt->Amask) >> fmt->Ashift) - 1U) < 254U)
 
-/* convert surface to be quickly alpha-blittable onto dest, if possible */
-static int RLEAlphaSurface(SDL_Surface *surface)
+#define ISCLEAR(pixel, fmt) (((pixel) & fmt->Amask) == 0)
+
+/* encode surface to be quickly alpha-blittable onto df, if possible */
+static void *RLEAlphaEncode(SDL_Surface *surface, SDL_PixelFormat *df)
 {
-    SDL_Surface *dest;
-    SDL_PixelFormat *df;
     int maxsize = 0;
     int max_opaque_run;
     int max_transl_run = 65535;
+    int transl_align = 1;
     unsigned masksum;
     Uint8 *rlebuf, *dst;
     int (*copy_opaque)(void *, Uint32 *, int,
@@ -1410,12 +1497,8 @@ static int RLEAlphaSurface(SDL_Surface *surface)
     int (*copy_transl)(void *, Uint32 *, int,
 		       SDL_PixelFormat *, SDL_PixelFormat *);
 
-    dest = surface->map->dst;
-    if(!dest)
-	return -1;
-    df = dest->format;
     if(surface->format->BitsPerPixel != 32)
-	return -1;		/* only 32bpp source supported */
+	return NULL;		/* only 32bpp source supported */
 
     /* find out whether the destination is one we support,
        and determine the max size of the encoded result */
@@ -1429,8 +1512,12 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 	       || df->Rmask == 0x07e0 || df->Bmask == 0x07e0) {
 		copy_opaque = copy_opaque_16;
 		copy_transl = copy_transl_565;
+#ifdef __ARM_NEON__
+		if(rle_neon)
+		    transl_align = 4;
+#endif
 	    } else
-		return -1;
+		return NULL;
 	    break;
 	case 0x7fff:
 	    if(df->Gmask == 0x03e0
@@ -1438,10 +1525,10 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 		copy_opaque = copy_opaque_16;
 		copy_transl = copy_transl_555;
 	    } else
-		return -1;
+		return NULL;
 	    break;
 	default:
-	    return -1;
+	    return NULL;
 	}
 	max_opaque_run = 255;	/* runs stored as bytes */
 
@@ -1451,7 +1538,7 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 	break;
     case 4:
 	if(masksum != 0x00ffffff)
-	    return -1;		/* requires unused high byte */
+	    return NULL;		/* requires unused high byte */
 	copy_opaque = copy_32;
 	copy_transl = copy_32;
 	max_opaque_run = 255;	/* runs stored as short ints */
@@ -1460,14 +1547,14 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 	maxsize = surface->h * 2 * 4 * (surface->w + 1) + 4;
 	break;
     default:
-	return -1;		/* anything else unsupported right now */
+	return NULL;		/* anything else unsupported right now */
     }
 
     maxsize += sizeof(RLEDestFormat);
     rlebuf = (Uint8 *)SDL_malloc(maxsize);
     if(!rlebuf) {
 	SDL_OutOfMemory();
-	return -1;
+	return NULL;
     }
     {
 	/* save the destination format so we can undo the encoding later */
@@ -1557,7 +1644,9 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 		while(x < w && !ISTRANSL(src[x], sf))
 		    x++;
 		runstart = x;
-		while(x < w && ISTRANSL(src[x], sf))
+		while(x < w && (ISTRANSL(src[x], sf)
+				|| ((x - runstart) % transl_align
+				    && ISCLEAR(src[x], sf))))
 		    x++;
 		skip = runstart - skipstart;
 		blankline &= (skip == w);
@@ -1591,22 +1680,13 @@ static int RLEAlphaSurface(SDL_Surface *surface)
 #undef ADD_OPAQUE_COUNTS
 #undef ADD_TRANSL_COUNTS
 
-    /* Now that we have it encoded, release the original pixels */
-    if((surface->flags & SDL_PREALLOC) != SDL_PREALLOC
-       && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
-	SDL_free( surface->pixels );
-	surface->pixels = NULL;
-    }
-
     /* realloc the buffer to release unused memory */
     {
 	Uint8 *p = SDL_realloc(rlebuf, dst - rlebuf);
 	if(!p)
 	    p = rlebuf;
-	surface->map->sw_data->aux_data = p;
+	return p;
     }
-
-    return 0;
 }
 
 static Uint32 getpix_8(Uint8 *srcbuf)
@@ -1639,7 +1719,7 @@ static getpix_func getpixes[4] = {
     getpix_8, getpix_16, getpix_24, getpix_32
 };
 
-static int RLEColorkeySurface(SDL_Surface *surface)
+static void *RLEColorkeyEncode(SDL_Surface *surface)
 {
         Uint8 *rlebuf, *dst;
 	int maxn;
@@ -1675,7 +1755,7 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 	rlebuf = (Uint8 *)SDL_malloc(maxsize);
 	if ( rlebuf == NULL ) {
 		SDL_OutOfMemory();
-		return(-1);
+		return(NULL);
 	}
 
 	/* Set up the conversion */
@@ -1751,28 +1831,242 @@ static int RLEColorkeySurface(SDL_Surface *surface)
 
 #undef ADD_COUNTS
 
-	/* Now that we have it encoded, release the original pixels */
-	if((surface->flags & SDL_PREALLOC) != SDL_PREALLOC
-	   && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
-	    SDL_free( surface->pixels );
-	    surface->pixels = NULL;
-	}
-
 	/* realloc the buffer to release unused memory */
 	{
 	    /* If realloc returns NULL, the original block is left intact */
 	    Uint8 *p = SDL_realloc(rlebuf, dst - rlebuf);
 	    if(!p)
 		p = rlebuf;
-	    surface->map->sw_data->aux_data = p;
+	    return(p);
 	}
+}
 
-	return(0);
+/* release the original pixels once the surface is encoded */
+static void RLEInstall(SDL_Surface *surface, void *rle)
+{
+    if((surface->flags & SDL_PREALLOC) != SDL_PREALLOC
+       && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
+	SDL_free( surface->pixels );
+	surface->pixels = NULL;
+    }
+    surface->map->sw_data->aux_data = rle;
+}
+
+/* blit a surface that is still waiting for its encoding */
+static int RLEOriginalBlit(SDL_Surface *src, SDL_Rect *srcrect,
+			   SDL_Surface *dst, SDL_Rect *dstrect)
+{
+    Uint32 rle_flag = src->flags & SDL_RLEACCEL;
+    int retval;
+
+    src->flags &= ~SDL_RLEACCEL;	/* the pixels are all there */
+    retval = SDL_SoftBlit(src, srcrect, dst, dstrect);
+    src->flags |= rle_flag;
+    return retval;
 }
 
+#if SDL_THREADS_DISABLED
+
+static int RLEQueue(SDL_Surface *surface)
+{
+    return -1;
+}
+
+static int RLEJobDone(SDL_Surface *surface)
+{
+    return 1;
+}
+
+static void RLECancel(SDL_Surface *surface)
+{
+}
+
+void SDL_RLEThreadQuit(void)
+{
+}
+
+#else
+
+/*
+ * Background encoding: with SDL_RLE_BACKGROUND set to 1 surfaces are
+ * encoded by a worker thread, and until that is done they are blitted
+ * from the original pixels with the usual software blitter. The first
+ * blit after it's done switches to the RLE data. The surface looks RLE
+ * accelerated all the time, so locking or changing it cancels the job.
+ */
+enum { RLE_QUEUED, RLE_RUNNING, RLE_DONE };
+
+struct SDL_RLEJob {
+    SDL_Surface *surface;
+    SDL_PixelFormat df;		/* target format for pixel alpha */
+    int colorkey;
+    int state;
+    void *rle;			/* the result, NULL if it failed */
+    struct SDL_RLEJob *next;
+};
+
+static struct {
+    SDL_mutex *lock;
+    SDL_cond *work;
+    SDL_cond *done;
+    SDL_Thread *thread;
+    struct SDL_RLEJob *queue;	/* oldest first */
+    int quit;
+} rle_worker;
+
+static int SDLCALL RLEWorker(void *unused)
+{
+    struct SDL_RLEJob *job;
+
+    SDL_mutexP(rle_worker.lock);
+    for(;;) {
+	while(!rle_worker.queue && !rle_worker.quit)
+	    SDL_CondWait(rle_worker.work, rle_worker.lock);
+	if(rle_worker.quit)
+	    break;
+
+	job = rle_worker.queue;
+	rle_worker.queue = job->next;
+	job->state = RLE_RUNNING;
+	SDL_mutexV(rle_worker.lock);
+
+	if(job->colorkey)
+	    job->rle = RLEColorkeyEncode(job->surface);
+	else
+	    job->rle = RLEAlphaEncode(job->surface, &job->df);
+
+	SDL_mutexP(rle_worker.lock);
+	job->state = RLE_DONE;
+	SDL_CondBroadcast(rle_worker.done);
+    }
+    SDL_mutexV(rle_worker.lock);
+    return 0;
+}
+
+/* hand the encoding to the worker thread if that's enabled */
+static int RLEQueue(SDL_Surface *surface)
+{
+    const char *env = SDL_getenv("SDL_RLE_BACKGROUND");
+    struct SDL_RLEJob *job, **tail;
+
+    if(!env || SDL_atoi(env) <= 0 || SDL_MUSTLOCK(surface))
+	return -1;
+
+    if(!rle_worker.lock) {
+	rle_worker.lock = SDL_CreateMutex();
+	rle_worker.work = SDL_CreateCond();
+	rle_worker.done = SDL_CreateCond();
+	if(!rle_worker.lock || !rle_worker.work || !rle_worker.done) {
+	    SDL_RLEThreadQuit();
+	    return -1;
+	}
+    }
+    if(!rle_worker.thread) {
+	rle_worker.quit = 0;
+	rle_worker.thread = SDL_CreateThread(RLEWorker, NULL);
+	if(!rle_worker.thread)
+	    return -1;		/* encode it right here then */
+    }
+
+    job = SDL_malloc(sizeof(*job));
+    if(!job)
+	return -1;
+    job->surface = surface;
+    job->colorkey = (surface->flags & SDL_SRCCOLORKEY) == SDL_SRCCOLORKEY;
+    if(!job->colorkey) {
+	job->df = *surface->map->dst->format;
+	job->df.palette = NULL;
+    }
+    job->state = RLE_QUEUED;
+    job->rle = NULL;
+    job->next = NULL;
+
+    SDL_mutexP(rle_worker.lock);
+    for(tail = &rle_worker.queue; *tail; tail = &(*tail)->next)
+	;
+    *tail = job;
+    SDL_CondSignal(rle_worker.work);
+    SDL_mutexV(rle_worker.lock);
+
+    surface->map->sw_data->rle_job = job;
+    return 0;
+}
+
+/* pick up the finished encoding, returns 0 if it's still being done */
+static int RLEJobDone(SDL_Surface *surface)
+{
+    struct SDL_RLEJob *job = surface->map->sw_data->rle_job;
+    void *rle;
+    int state;
+
+    SDL_mutexP(rle_worker.lock);
+    state = job->state;
+    SDL_mutexV(rle_worker.lock);
+    if(state != RLE_DONE)
+	return 0;
+
+    surface->map->sw_data->rle_job = NULL;
+    rle = job->rle;
+    SDL_free(job);
+    if(rle) {
+	RLEInstall(surface, rle);
+    } else {
+	/* couldn't encode it, stay with the software blitter */
+	surface->flags &= ~SDL_RLEACCEL;
+	surface->map->sw_blit = SDL_SoftBlit;
+    }
+    return rle != NULL;
+}
+
+/* forget about the encoding, the worker is done with the pixels after this */
+static void RLECancel(SDL_Surface *surface)
+{
+    struct SDL_RLEJob *job = surface->map->sw_data->rle_job;
+    struct SDL_RLEJob **prev;
+
+    surface->map->sw_data->rle_job = NULL;
+    SDL_mutexP(rle_worker.lock);
+    if(job->state == RLE_QUEUED) {
+	for(prev = &rle_worker.queue; *prev != job; prev = &(*prev)->next)
+	    ;
+	*prev = job->next;
+    }
+    while(job->state == RLE_RUNNING)
+	SDL_CondWait(rle_worker.done, rle_worker.lock);
+    SDL_mutexV(rle_worker.lock);
+
+    if(job->rle)
+	SDL_free(job->rle);
+    SDL_free(job);
+}
+
+/* stop the worker, jobs still queued are done if it's started again */
+void SDL_RLEThreadQuit(void)
+{
+    if(rle_worker.thread) {
+	SDL_mutexP(rle_worker.lock);
+	rle_worker.quit = 1;
+	SDL_CondSignal(rle_worker.work);
+	SDL_mutexV(rle_worker.lock);
+	SDL_WaitThread(rle_worker.thread, NULL);
+	rle_worker.thread = NULL;
+    }
+    if(!rle_worker.queue) {
+	if(rle_worker.done)
+	    SDL_DestroyCond(rle_worker.done);
+	if(rle_worker.work)
+	    SDL_DestroyCond(rle_worker.work);
+	if(rle_worker.lock)
+	    SDL_DestroyMutex(rle_worker.lock);
+	SDL_memset(&rle_worker, 0, sizeof(rle_worker));
+    }
+}
+
+#endif /* SDL_THREADS_DISABLED */
+
 int SDL_RLESurface(SDL_Surface *surface)
 {
-	int retcode;
+	void *rle;
 
 	/* Clear any previous RLE conversion */
 	if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
@@ -1784,6 +2078,23 @@ int SDL_RLESurface(SDL_Surface *surface)
 		return(-1);
 	}
 
+	/* no RLE for per-surface alpha sans ckey */
+	if ( (surface->flags & SDL_SRCCOLORKEY) != SDL_SRCCOLORKEY &&
+	     ((surface->flags & SDL_SRCALPHA) != SDL_SRCALPHA ||
+	      surface->format->Amask == 0 || !surface->map->dst) ) {
+		return(-1);
+	}
+
+#ifdef __ARM_NEON__
+	RLENeonFeatures();
+#endif
+
+	/* Leave it to the worker thread if requested */
+	if ( RLEQueue(surface) == 0 ) {
+		surface->flags |= SDL_RLEACCEL;
+		return(0);
+	}
+
 	/* Lock the surface if it's in hardware */
 	if ( SDL_MUSTLOCK(surface) ) {
 		if ( SDL_LockSurface(surface) < 0 ) {
@@ -1793,13 +2104,9 @@ int SDL_RLESurface(SDL_Surface *surface)
 
 	/* Encode */
 	if((surface->flags & SDL_SRCCOLORKEY) == SDL_SRCCOLORKEY) {
-	    retcode = RLEColorkeySurface(surface);
+	    rle = RLEColorkeyEncode(surface);
 	} else {
-	    if((surface->flags & SDL_SRCALPHA) == SDL_SRCALPHA
-	       && surface->format->Amask != 0)
-		retcode = RLEAlphaSurface(surface);
-	    else
-		retcode = -1;	/* no RLE for per-surface alpha sans ckey */
+	    rle = RLEAlphaEncode(surface, surface->map->dst->format);
 	}
 
 	/* Unlock the surface if it's in hardware */
@@ -1807,10 +2114,11 @@ int SDL_RLESurface(SDL_Surface *surface)
 		SDL_UnlockSurface(surface);
 	}
 
-	if(retcode < 0)
+	if(!rle)
 	    return -1;
 
 	/* The surface is now accelerated */
+	RLEInstall(surface, rle);
 	surface->flags |= SDL_RLEACCEL;
 
 	return(0);
@@ -1894,42 +2202,61 @@ static SDL_bool UnRLEAlpha(SDL_Surface *surface)
     return(SDL_TRUE);
 }
 
+/*
+ * Un-RLE a colorkeyed surface
+ * Transparent pixels get the colorkey, the rest is exactly as before.
+ */
+static SDL_bool UnRLEColorkey(SDL_Surface *surface)
+{
+    SDL_Rect full;
+    unsigned alpha_flag;
+
+    /* re-create the original surface */
+    surface->pixels = SDL_malloc(surface->h * surface->pitch);
+    if ( !surface->pixels ) {
+	return(SDL_FALSE);
+    }
+
+    /* fill it with the background colour */
+    SDL_FillRect(surface, NULL, surface->format->colorkey);
+
+    /* now render the encoded surface */
+    full.x = full.y = 0;
+    full.w = surface->w;
+    full.h = surface->h;
+    alpha_flag = surface->flags & SDL_SRCALPHA;
+    surface->flags &= ~SDL_SRCALPHA; /* opaque blit */
+    SDL_RLEBlit(surface, &full, surface, &full);
+    surface->flags |= alpha_flag;
+    return(SDL_TRUE);
+}
+
 void SDL_UnRLESurface(SDL_Surface *surface, int recode)
 {
     if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
 	surface->flags &= ~SDL_RLEACCEL;
 
-	if(recode && (surface->flags & SDL_PREALLOC) != SDL_PREALLOC
-	   && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
-	    if((surface->flags & SDL_SRCCOLORKEY) == SDL_SRCCOLORKEY) {
-		SDL_Rect full;
-		unsigned alpha_flag;
-
-		/* re-create the original surface */
-		surface->pixels = SDL_malloc(surface->h * surface->pitch);
-		if ( !surface->pixels ) {
-			/* Oh crap... */
-			surface->flags |= SDL_RLEACCEL;
-			return;
-		}
+	if(surface->map && surface->map->sw_data->rle_job) {
+	    /* not encoded yet, the original pixels are all there */
+	    RLECancel(surface);
+	    surface->map->sw_data->rle_readonly = 0;
+	    return;
+	}
 
-		/* fill it with the background colour */
-		SDL_FillRect(surface, NULL, surface->format->colorkey);
-
-		/* now render the encoded surface */
-		full.x = full.y = 0;
-		full.w = surface->w;
-		full.h = surface->h;
-		alpha_flag = surface->flags & SDL_SRCALPHA;
-		surface->flags &= ~SDL_SRCALPHA; /* opaque blit */
-		SDL_RLEBlit(surface, &full, surface, &full);
-		surface->flags |= alpha_flag;
-	    } else {
-		if ( !UnRLEAlpha(surface) ) {
-		    /* Oh crap... */
-		    surface->flags |= SDL_RLEACCEL;
-		    return;
-		}
+	if(surface->map && surface->map->sw_data->rle_readonly) {
+	    /* locked read-only, the pixels are decoded already */
+	    surface->map->sw_data->rle_readonly = 0;
+	} else if(recode && (surface->flags & SDL_PREALLOC) != SDL_PREALLOC
+	   && (surface->flags & SDL_HWSURFACE) != SDL_HWSURFACE) {
+	    SDL_bool ok;
+	    if((surface->flags & SDL_SRCCOLORKEY) == SDL_SRCCOLORKEY)
+		ok = UnRLEColorkey(surface);
+	    else
+		ok = UnRLEAlpha(surface);
+	    if ( !ok ) {
+		/* Oh crap... */
+		surface->flags |= SDL_RLEACCEL;
+		return;
 	    }
 	}
 
@@ -1940,4 +2267,40 @@ void SDL_UnRLESurface(SDL_Surface *surface, int recode)
     }
 }
 
+/*
+ * Lock an encoded surface for reading only. The RLE data is kept, the
+ * pixels are decoded to a temporary copy if they aren't around anyway.
+ */
+int SDL_RLELockReadOnly(SDL_Surface *surface)
+{
+    struct private_swaccel *sw_data = surface->map->sw_data;
+    SDL_bool ok;
+
+    if(surface->pixels) {
+	/* kept along the encoding or not encoded yet */
+	sw_data->rle_readonly = 1;
+	return 0;
+    }
+
+    surface->flags &= ~SDL_RLEACCEL;
+    if((surface->flags & SDL_SRCCOLORKEY) == SDL_SRCCOLORKEY)
+	ok = UnRLEColorkey(surface);
+    else
+	ok = UnRLEAlpha(surface);
+    surface->flags |= SDL_RLEACCEL;
+    if(!ok) {
+	SDL_OutOfMemory();
+	return -1;
+    }
+    sw_data->rle_readonly = 2;
+    return 0;
+}
 
+void SDL_RLEUnlockReadOnly(SDL_Surface *surface)
+{
+    if(surface->map->sw_data->rle_readonly == 2) {
+	SDL_free(surface->pixels);
+	surface->pixels = NULL;
+    }
+    surface->map->sw_data->rle_readonly = 0;
+}
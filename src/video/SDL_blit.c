@@ -39,9 +39,56 @@
 #include "mmx.h"
 #endif
 
+/* The SDL_NEON_BLIT_FEATURES override, mostly for comparing the NEON
+   blitters and converters against the C ones.  It's read on first use
+   and kept until SDL_Quit().
+*/
+static Uint32 neon_blit_features = 0xffffffff;
+
+Uint32 SDL_GetNeonBlitFeatures(void)
+{
+	if ( neon_blit_features == 0xffffffff ) {
+		const char *override = SDL_getenv("SDL_NEON_BLIT_FEATURES");
+
+		neon_blit_features = SDL_BLIT_FEATURE_NEON;
+		if ( override ) {
+			neon_blit_features = 0;
+			SDL_sscanf(override, "%u", &neon_blit_features);
+		}
+	}
+	return(neon_blit_features);
+}
+
+void SDL_ResetNeonBlitFeatures(void)
+{
+	neon_blit_features = 0xffffffff;
+}
+
+/* One band of a blit split into several, see SDL_blit_threads.c */
+typedef struct {
+	SDL_BlitInfo info;
+	SDL_loblit blit;
+	int s_pitch;
+	int d_pitch;
+} SDL_BlitBandJob;
+
+static void SDL_SoftBlitBand(void *arg, int band, int bands)
+{
+	SDL_BlitBandJob *job = (SDL_BlitBandJob *)arg;
+	SDL_BlitInfo info = job->info;
+	int y0 = job->info.d_height * band / bands;
+	int y1 = job->info.d_height * (band + 1) / bands;
+
+	info.s_pixels += y0 * job->s_pitch;
+	info.d_pixels += y0 * job->d_pitch;
+	info.s_height = y1 - y0;
+	info.d_height = y1 - y0;
+	job->blit(&info);
+}
+
 /* The general purpose software blit routine */
-static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
-			SDL_Surface *dst, SDL_Rect *dstrect)
+int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
+		 SDL_Surface *dst, SDL_Rect *dstrect)
 {
 	int okay;
 	int src_locked;
@@ -73,6 +120,7 @@ static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 	if ( okay  && srcrect->w && srcrect->h ) {
 		SDL_BlitInfo info;
 		SDL_loblit RunBlit;
+		int bands;
 
 		/* Set up the blit information */
 		info.s_pixels = (Uint8 *)src->pixels +
@@ -93,8 +141,28 @@ static int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
 		info.dst = dst->format;
 		RunBlit = src->map->sw_data->blit;
 
-		/* Run the actual software blit */
-		RunBlit(&info);
+		/* Run the actual software blit, big ones in parallel bands
+		   unless source and destination pixels overlap */
+		bands = SDL_BlitBands(info.d_height,
+		          info.d_height*info.d_width*dst->format->BytesPerPixel);
+		if ( bands > 1 ) {
+			Uint8 *s_end = info.s_pixels + info.s_height*src->pitch;
+			Uint8 *d_end = info.d_pixels + info.d_height*dst->pitch;
+			if ( info.s_pixels < d_end && info.d_pixels < s_end ) {
+				bands = 1;
+			}
+		}
+		if ( bands > 1 ) {
+			SDL_BlitBandJob job;
+
+			job.info = info;
+			job.blit = RunBlit;
+			job.s_pitch = src->pitch;
+			job.d_pitch = dst->pitch;
+			SDL_RunBlitBands(SDL_SoftBlitBand, &job, bands);
+		} else {
+			RunBlit(&info);
+		}
 	}
 
 	/* We need to unlock the surfaces if they're locked */
@@ -229,19 +297,17 @@ static void SDL_BlitCopyOverlap(SDL_BlitInfo *info)
 	}
 }
 
-/* Figure out which of many blit routines to set up on a surface */
-int SDL_CalculateBlit(SDL_Surface *surface)
+/* Set up hardware blits for the surface and its mapped destination */
+void SDL_CalculateHWBlit(SDL_Surface *surface)
 {
-	int blit_index;
-
-	/* Clean everything out to start */
-	if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
-		SDL_UnRLESurface(surface, 1);
-	}
-	surface->map->sw_blit = NULL;
-
 	/* Figure out if an accelerated hardware blit is possible */
 	surface->flags &= ~SDL_HWACCEL;
+
+	/* Drivers don't know about premultiplied alpha */
+	if ( (surface->flags & (SDL_SRCALPHA|SDL_PREMULALPHA)) ==
+	     (SDL_SRCALPHA|SDL_PREMULALPHA) ) {
+		return;
+	}
 	if ( surface->map->identity ) {
 		int hw_blit_ok;
 
@@ -289,6 +355,20 @@ int SDL_CalculateBlit(SDL_Surface *surface)
 				video->CheckHWBlit(this, surface, surface->map->dst);
 			}
 	}
+}
+
+/* Figure out which of many blit routines to set up on a surface */
+int SDL_CalculateBlit(SDL_Surface *surface)
+{
+	int blit_index;
+
+	/* Clean everything out to start */
+	if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
+		SDL_UnRLESurface(surface, 1);
+	}
+	surface->map->sw_blit = NULL;
+
+	SDL_CalculateHWBlit(surface);
 
 	/* Get the blit function index, based on surface mode */
 	/* { 0 = nothing, 1 = colorkey, 2 = alpha, 3 = colorkey+alpha } */
@@ -346,7 +426,8 @@ int SDL_CalculateBlit(SDL_Surface *surface)
 		       || (blit_index == 3 && !surface->format->Amask))) {
 		        if ( SDL_RLESurface(surface) == 0 )
 			        surface->map->sw_blit = SDL_RLEBlit;
-		} else if(blit_index == 2 && surface->format->Amask) {
+		} else if(blit_index == 2 && surface->format->Amask
+			  && !(surface->flags & SDL_PREMULALPHA)) {
 		        if ( SDL_RLESurface(surface) == 0 )
 			        surface->map->sw_blit = SDL_RLEAlphaBlit;
 		}
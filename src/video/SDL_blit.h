@@ -49,13 +49,40 @@ typedef void (*SDL_loblit)(SDL_BlitInfo *info);
 struct private_swaccel {
 	SDL_loblit blit;
 	void *aux_data;
+	struct SDL_RLEJob *rle_job;	/* RLE encoding being done in background */
+	int rle_readonly;		/* locked read-only, RLE data kept */
 };
 
+/* What a software blit mapping depends on besides the source surface */
+typedef struct SDL_BlitMapKey {
+	SDL_Surface *dst;	/* only set for palettes and self blits */
+	unsigned int format_version;
+	Uint8 BitsPerPixel;
+	Uint32 Rmask, Gmask, Bmask, Amask;
+	Uint32 src_flags;
+	Uint32 dst_flags;
+} SDL_BlitMapKey;
+
+/* A previous mapping of the surface, kept for when it's blitted to a
+   destination like that again */
+typedef struct SDL_BlitMapEntry {
+	SDL_BlitMapKey key;
+	int identity;
+	Uint8 *table;
+	struct SDL_PaletteMap *palmap;
+	SDL_blit sw_blit;
+	SDL_loblit blit;
+	void *aux_data;
+} SDL_BlitMapEntry;
+
+#define SDL_BLITMAP_CACHE	4
+
 /* Blit mapping definition */
 typedef struct SDL_BlitMap {
 	SDL_Surface *dst;
 	int identity;
 	Uint8 *table;
+	struct SDL_PaletteMap *palmap;	/* shared owner of table, if any */
 	SDL_blit hw_blit;
 	SDL_blit sw_blit;
 	struct private_hwaccel *hw_data;
@@ -64,11 +91,31 @@ typedef struct SDL_BlitMap {
 	/* the version count matches the destination; mismatch indicates
 	   an invalid mapping */
         unsigned int format_version;
+
+	/* key of the current mapping and the recently used ones,
+	   most recent first, unused entries have no sw_blit */
+	SDL_BlitMapKey key;
+	SDL_BlitMapEntry cache[SDL_BLITMAP_CACHE];
 } SDL_BlitMap;
 
 
 /* Functions found in SDL_blit.c */
 extern int SDL_CalculateBlit(SDL_Surface *surface);
+extern int SDL_SoftBlit(SDL_Surface *src, SDL_Rect *srcrect,
+			SDL_Surface *dst, SDL_Rect *dstrect);
+extern void SDL_CalculateHWBlit(SDL_Surface *surface);
+#define SDL_BLIT_FEATURE_NEON	8	/* the NEON code may be used */
+extern Uint32 SDL_GetNeonBlitFeatures(void);
+extern void SDL_ResetNeonBlitFeatures(void);
+
+/* Functions found in SDL_blit_threads.c */
+typedef void (*SDL_bandfunc)(void *arg, int band, int bands);
+extern int SDL_BlitThreadsInit(void);
+extern void SDL_BlitThreadsQuit(void);
+extern int SDL_BlitBands(int rows, int bytes);
+extern void SDL_RunBlitBands(SDL_bandfunc func, void *arg, int bands);
+extern int SDL_StartBlitBands(SDL_bandfunc func, void *arg, int bands);
+extern void SDL_FinishBlitBands(void);
 
 /* Functions found in SDL_blit_{0,1,N,A}.c */
 extern SDL_loblit SDL_CalculateBlit0(SDL_Surface *surface, int complex);
@@ -389,6 +436,22 @@ do {						\
 	dB = (((sB-dB)*(A)+255)>>8)+dB;		\
 } while(0)
 
+/* Blend a premultiplied source component over the destination one,
+   d = s + d * (255 - A) / 255 rounded and clamped to 255 */
+#define PREMUL_BLEND(s, d, A)				\
+do {							\
+	unsigned t_ = (d) * (255 - (A)) + 128;		\
+	d = (s) + ((t_ + (t_ >> 8)) >> 8);		\
+	if ( d > 255 ) d = 255;				\
+} while(0)
+
+#define PREMUL_ALPHA_BLEND(sR, sG, sB, A, dR, dG, dB)	\
+do {							\
+	PREMUL_BLEND(sR, dR, A);			\
+	PREMUL_BLEND(sG, dG, A);			\
+	PREMUL_BLEND(sB, dB, A);			\
+} while(0)
+
 
 /* This is a very useful loop for optimizing blitters */
 #if defined(_MSC_VER) && (_MSC_VER == 1300)
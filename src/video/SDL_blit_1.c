@@ -483,6 +483,47 @@ static void Blit1toNAlphaKey(SDL_BlitInfo *info)
 	}
 }
 
+#ifdef __ARM_NEON__
+/* NEON palette expansion, does 8 pixel groups and leaves the right
+ * edge strip to the C versions */
+#define make_neon_edge_caller(name, neon_name, dbpp, c_name) \
+extern void neon_name(void *dst, const void *src, int count, const void *table); \
+static void name(SDL_BlitInfo *info) \
+{ \
+	int width = info->d_width & ~7; \
+	int height = info->d_height; \
+	Uint8 *src = info->s_pixels; \
+	Uint8 *dst = info->d_pixels; \
+	int srcskip = info->s_skip + (info->d_width - width); \
+	int dstskip = info->d_skip + (info->d_width - width) * dbpp; \
+	SDL_BlitInfo edge; \
+\
+	if ( width ) { \
+	    while ( height-- ) { \
+	        neon_name(dst, src, width, info->table); \
+	        src += width + srcskip; \
+	        dst += width * dbpp + dstskip; \
+	    } \
+	} \
+	if ( width != info->d_width ) { \
+	    edge = *info; \
+	    edge.s_pixels += width; \
+	    edge.d_pixels += width * dbpp; \
+	    edge.s_skip += width; \
+	    edge.d_skip += width * dbpp; \
+	    edge.d_width -= width; \
+	    c_name(&edge); \
+	} \
+}
+
+make_neon_edge_caller(Blit1to2_neon, neon_blit1to2, 2, Blit1to2)
+make_neon_edge_caller(Blit1to4_neon, neon_blit1to4, 4, Blit1to4)
+
+static SDL_loblit one_blit_neon[] = {
+	NULL, Blit1to1, Blit1to2_neon, Blit1to3, Blit1to4_neon
+};
+#endif /* __ARM_NEON__ */
+
 static SDL_loblit one_blit[] = {
 	NULL, Blit1to1, Blit1to2, Blit1to3, Blit1to4
 };
@@ -504,6 +545,11 @@ SDL_loblit SDL_CalculateBlit1(SDL_Surface *surface, int blit_index)
 	}
 	switch(blit_index) {
 	case 0:			/* copy */
+#ifdef __ARM_NEON__
+	    if ( SDL_GetNeonBlitFeatures() & SDL_BLIT_FEATURE_NEON ) {
+		return one_blit_neon[which];
+	    }
+#endif
 	    return one_blit[which];
 
 	case 1:			/* colorkey */
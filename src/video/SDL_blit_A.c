@@ -104,9 +104,7 @@ static void name(SDL_BlitInfo *info) \
 }
 
 make_neon_caller(BlitABGRtoXRGBalpha_neon, neon_ABGRtoXRGBalpha)
-make_neon_caller(BlitARGBtoXRGBalpha_neon, neon_ARGBtoXRGBalpha)
 make_neon_caller(BlitABGRtoRGB565alpha_neon, neon_ABGRtoRGB565alpha)
-make_neon_caller(BlitARGBtoRGB565alpha_neon, neon_ARGBtoRGB565alpha)
 make_neon_callerS(BlitABGRtoXRGBalphaS_neon, neon_ABGRtoXRGBalphaS)
 make_neon_callerS(BlitARGBtoXRGBalphaS_neon, neon_ARGBtoXRGBalphaS)
 
@@ -2692,9 +2690,12 @@ static void BlitNtoNSurfaceAlphaKey(SDL_BlitInfo *info)
 	unsigned sA = srcfmt->alpha;
 	unsigned dA = dstfmt->Amask ? SDL_ALPHA_OPAQUE : 0;
 
-	if (srcbpp == 2 && srcfmt->Gmask == 0x7e0 && dstbpp == 2 && dstfmt->Gmask == 0x7e0) {
+	if (srcbpp == 2 && dstbpp == 2 && srcfmt->Gmask == dstfmt->Gmask
+	    && srcfmt->Rmask == dstfmt->Rmask && !dstfmt->Amask
+	    && (srcfmt->Gmask == 0x7e0 || srcfmt->Gmask == 0x3e0)) {
 	    Uint16 *src16 = (Uint16 *)src;
 	    Uint16 *dst16 = (Uint16 *)dst;
+	    Uint32 mask = srcfmt->Gmask == 0x7e0 ? 0x07e0f81f : 0x03e07c1f;
 	    sA >>= 3;	/* downscale alpha to 5 bits */
 	    while ( height-- ) {
 		DUFFS_LOOP4(
@@ -2704,10 +2705,10 @@ static void BlitNtoNSurfaceAlphaKey(SDL_BlitInfo *info)
 		    s = *src16;
 		    if(sA && s != ckey) {
 			d = *dst16;
-			s = (s | s << 16) & 0x07e0f81f;
-			d = (d | d << 16) & 0x07e0f81f;
+			s = (s | s << 16) & mask;
+			d = (d | d << 16) & mask;
 			d += (s - d) * sA >> 5;
-			d &= 0x07e0f81f;
+			d &= mask;
 			*dst16 = (Uint16)(d | d >> 16);
 		    }
 		    src16++;
@@ -2720,6 +2721,46 @@ static void BlitNtoNSurfaceAlphaKey(SDL_BlitInfo *info)
 	    return;
 	}
 
+	/* 8 bits per component, red/blue and green done separately like
+	   BlitRGBtoRGBSurfaceAlpha but rounded like ALPHA_BLEND below:
+	   d = (d * 256 + (s - d) * alpha + 255) >> 8 fits in 16 bits */
+	if (srcbpp == 4 && dstbpp == 4 && srcfmt->Gmask == 0xff00
+	    && srcfmt->Rmask == dstfmt->Rmask && srcfmt->Gmask == dstfmt->Gmask
+	    && srcfmt->Bmask == dstfmt->Bmask
+	    && (srcfmt->Rmask | srcfmt->Bmask) == 0xff00ff) {
+	    Uint32 *src32 = (Uint32 *)src;
+	    Uint32 *dst32 = (Uint32 *)dst;
+	    Uint32 dalpha = dstfmt->Amask;
+	    while ( height-- ) {
+		DUFFS_LOOP4(
+		{
+		    Uint32 s;
+		    Uint32 d;
+		    Uint32 s1;
+		    Uint32 d1;
+		    s = *src32;
+		    if(sA && s != ckey) {
+			d = *dst32;
+			s1 = s & 0xff00ff;
+			d1 = d & 0xff00ff;
+			d1 = ((d1 << 8) + (s1 - d1) * sA + 0xff00ff) >> 8;
+			d1 &= 0xff00ff;
+			s &= 0xff00;
+			d &= 0xff00;
+			d = ((d << 8) + (s - d) * sA + 0xff00) >> 8;
+			d &= 0xff00;
+			*dst32 = d1 | d | dalpha;
+		    }
+		    src32++;
+		    dst32++;
+		},
+		width);
+		src32 += srcskip / 4;
+		dst32 += dstskip / 4;
+	    }
+	    return;
+	}
+
 	while ( height-- ) {
 	    DUFFS_LOOP4(
 	    {
@@ -2797,6 +2838,347 @@ static void BlitNtoNPixelAlpha(SDL_BlitInfo *info)
 	}
 }
 
+/*
+ * Premultiplied alpha: the source colors are already multiplied by
+ * alpha, so blending takes one multiply per destination component,
+ * d = s + d * (255 - alpha) / 255.  The sum is clamped, it only
+ * overflows if the source colors aren't really premultiplied.
+ */
+
+/* N->1 blending with premultiplied pixel alpha */
+static void BlitNto1PixelAlphaPremul(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint8 *src = info->s_pixels;
+	int srcskip = info->s_skip;
+	Uint8 *dst = info->d_pixels;
+	int dstskip = info->d_skip;
+	Uint8 *palmap = info->table;
+	SDL_PixelFormat *srcfmt = info->src;
+	SDL_PixelFormat *dstfmt = info->dst;
+	int srcbpp = srcfmt->BytesPerPixel;
+
+	while ( height-- ) {
+	    DUFFS_LOOP4(
+	    {
+		Uint32 Pixel;
+		unsigned sR;
+		unsigned sG;
+		unsigned sB;
+		unsigned sA;
+		unsigned dR;
+		unsigned dG;
+		unsigned dB;
+		DISEMBLE_RGBA(src,srcbpp,srcfmt,Pixel,sR,sG,sB,sA);
+		dR = dstfmt->palette->colors[*dst].r;
+		dG = dstfmt->palette->colors[*dst].g;
+		dB = dstfmt->palette->colors[*dst].b;
+		PREMUL_ALPHA_BLEND(sR, sG, sB, sA, dR, dG, dB);
+		/* Pack RGB into 8bit pixel */
+		if ( palmap == NULL ) {
+		    *dst =((dR>>5)<<(3+2))|
+			  ((dG>>5)<<(2))|
+			  ((dB>>6)<<(0));
+		} else {
+		    *dst = palmap[((dR>>5)<<(3+2))|
+				  ((dG>>5)<<(2))  |
+				  ((dB>>6)<<(0))  ];
+		}
+		dst++;
+		src += srcbpp;
+	    },
+	    width);
+	    src += srcskip;
+	    dst += dstskip;
+	}
+}
+
+/* Adds the bytes of two pixels, clamping each to 255 */
+static __inline__ Uint32 AddSat8888(Uint32 s, Uint32 d)
+{
+	Uint32 sum = (s & 0x7f7f7f7f) + (d & 0x7f7f7f7f);
+	Uint32 carry = ((s & d) | ((s ^ d) & sum)) & 0x80808080;
+
+	sum ^= (s ^ d) & 0x80808080;
+	return sum | carry | (carry - (carry >> 7));
+}
+
+/* all four bytes blended, so dst alpha gets composited too */
+static __inline__ Uint32 PremulBlend8888(Uint32 s, Uint32 d, Uint32 alpha)
+{
+	Uint32 ia = 255 - alpha;
+	Uint32 d1 = (d & 0xff00ff) * ia + 0x800080;
+	Uint32 d2 = (d >> 8 & 0xff00ff) * ia + 0x800080;
+
+	/* x / 255 as (x + (x >> 8)) >> 8, red/blue and green/alpha in
+	   parallel */
+	d1 = (d1 + (d1 >> 8 & 0xff00ff)) >> 8 & 0xff00ff;
+	d2 = (d2 + (d2 >> 8 & 0xff00ff)) & 0xff00ff00;
+	return AddSat8888(s, d1 | d2);
+}
+
+/* 8888->8888 with the same byte layout and premultiplied pixel alpha */
+static void BlitRGBtoRGBPixelAlphaPremul(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	int ashift = info->src->Ashift;
+
+	while(height--) {
+	    DUFFS_LOOP4({
+		Uint32 s = *srcp;
+		Uint32 alpha = s >> ashift & 0xff;
+		if(alpha == SDL_ALPHA_OPAQUE) {
+		    *dstp = s;
+		} else if(s) {
+		    *dstp = PremulBlend8888(s, *dstp, alpha);
+		}
+		++srcp;
+		++dstp;
+	    }, width);
+	    srcp += srcskip;
+	    dstp += dstskip;
+	}
+}
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+
+/* The same for alpha in the top byte, 4 pixels at a time */
+static void BlitRGBtoRGBPixelAlphaPremulSSE2(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint32 *dstp = (Uint32 *)info->d_pixels;
+	int dstskip = info->d_skip >> 2;
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i c255 = _mm_set1_epi16(0xff);
+	const __m128i c128 = _mm_set1_epi16(0x80);
+
+	while(height--) {
+	    int n;
+	    for(n = width; n >= 4; n -= 4) {
+		__m128i s = _mm_loadu_si128((const __m128i *)srcp);
+		__m128i d = _mm_loadu_si128((const __m128i *)dstp);
+		__m128i a = _mm_srli_epi32(s, 24);
+		__m128i lo, hi;
+
+		/* 255 - alpha in all four 16 bit lanes of each pixel */
+		a = _mm_or_si128(a, _mm_slli_epi32(a, 16));
+		lo = _mm_sub_epi16(c255, _mm_unpacklo_epi32(a, a));
+		hi = _mm_sub_epi16(c255, _mm_unpackhi_epi32(a, a));
+		lo = _mm_mullo_epi16(_mm_unpacklo_epi8(d, zero), lo);
+		hi = _mm_mullo_epi16(_mm_unpackhi_epi8(d, zero), hi);
+		lo = _mm_add_epi16(lo, c128);
+		hi = _mm_add_epi16(hi, c128);
+		lo = _mm_srli_epi16(_mm_add_epi16(lo, _mm_srli_epi16(lo, 8)), 8);
+		hi = _mm_srli_epi16(_mm_add_epi16(hi, _mm_srli_epi16(hi, 8)), 8);
+		d = _mm_adds_epu8(s, _mm_packus_epi16(lo, hi));
+		_mm_storeu_si128((__m128i *)dstp, d);
+		srcp += 4;
+		dstp += 4;
+	    }
+	    for(; n > 0; n--) {
+		Uint32 s = *srcp;
+		if(s)
+		    *dstp = PremulBlend8888(s, *dstp, s >> 24);
+		++srcp;
+		++dstp;
+	    }
+	    srcp += srcskip;
+	    dstp += dstskip;
+	}
+}
+#endif /* __SSE2__ */
+
+/* premultiplied ARGB8888->RGB565, with the alpha cut to 5 bits rounding
+   up so that valid colors can't overflow: d = s + d * (32 - a) / 32 */
+static void BlitARGBto565PixelAlphaPremul(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+
+	while(height--) {
+	    DUFFS_LOOP4({
+		Uint32 s = *srcp;
+		unsigned alpha = s >> 24;
+		if(s) {
+		  s = (s >> 8 & 0xf800) + (s >> 5 & 0x7e0) + (s >> 3 & 0x1f);
+		  if(alpha == SDL_ALPHA_OPAQUE) {
+		    *dstp = (Uint16)s;
+		  } else {
+		    Uint32 d = *dstp;
+		    Uint32 ov;
+		    /* G0RAB65565, all components at the same time */
+		    d = (d | d << 16) & 0x07e0f81f;
+		    d = (d * ((256 - alpha) >> 3) >> 5) & 0x07e0f81f;
+		    d += (s | s << 16) & 0x07e0f81f;
+		    /* clamp components that carried into the gaps */
+		    ov = d & 0x08010020;
+		    d |= (ov - (ov >> 5)) | (ov >> 6 & 0x200000);
+		    d &= 0x07e0f81f;
+		    *dstp = (Uint16)(d | d >> 16);
+		  }
+		}
+		srcp++;
+		dstp++;
+	    }, width);
+	    srcp += srcskip;
+	    dstp += dstskip;
+	}
+}
+
+/* premultiplied ARGB8888->RGB555, like above */
+static void BlitARGBto555PixelAlphaPremul(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint32 *srcp = (Uint32 *)info->s_pixels;
+	int srcskip = info->s_skip >> 2;
+	Uint16 *dstp = (Uint16 *)info->d_pixels;
+	int dstskip = info->d_skip >> 1;
+
+	while(height--) {
+	    DUFFS_LOOP4({
+		Uint32 s = *srcp;
+		unsigned alpha = s >> 24;
+		if(s) {
+		  s = (s >> 9 & 0x7c00) + (s >> 6 & 0x3e0) + (s >> 3 & 0x1f);
+		  if(alpha == SDL_ALPHA_OPAQUE) {
+		    *dstp = (Uint16)s;
+		  } else {
+		    Uint32 d = *dstp;
+		    Uint32 ov;
+		    d = (d | d << 16) & 0x03e07c1f;
+		    d = (d * ((256 - alpha) >> 3) >> 5) & 0x03e07c1f;
+		    d += (s | s << 16) & 0x03e07c1f;
+		    ov = d & 0x04008020;
+		    d |= ov - (ov >> 5);
+		    d &= 0x03e07c1f;
+		    *dstp = (Uint16)(d | d >> 16);
+		  }
+		}
+		srcp++;
+		dstp++;
+	    }, width);
+	    srcp += srcskip;
+	    dstp += dstskip;
+	}
+}
+
+/* General (slow) N->N blending with premultiplied pixel alpha */
+static void BlitNtoNPixelAlphaPremul(SDL_BlitInfo *info)
+{
+	int width = info->d_width;
+	int height = info->d_height;
+	Uint8 *src = info->s_pixels;
+	int srcskip = info->s_skip;
+	Uint8 *dst = info->d_pixels;
+	int dstskip = info->d_skip;
+	SDL_PixelFormat *srcfmt = info->src;
+	SDL_PixelFormat *dstfmt = info->dst;
+	int srcbpp = srcfmt->BytesPerPixel;
+	int dstbpp = dstfmt->BytesPerPixel;
+
+	while ( height-- ) {
+	    DUFFS_LOOP4(
+	    {
+		Uint32 Pixel;
+		unsigned sR;
+		unsigned sG;
+		unsigned sB;
+		unsigned dR;
+		unsigned dG;
+		unsigned dB;
+		unsigned sA;
+		unsigned dA;
+		DISEMBLE_RGBA(src, srcbpp, srcfmt, Pixel, sR, sG, sB, sA);
+		if(sA | sR | sG | sB) {
+		  DISEMBLE_RGBA(dst, dstbpp, dstfmt, Pixel, dR, dG, dB, dA);
+		  PREMUL_ALPHA_BLEND(sR, sG, sB, sA, dR, dG, dB);
+		  PREMUL_BLEND(sA, dA, sA);
+		  ASSEMBLE_RGBA(dst, dstbpp, dstfmt, dR, dG, dB, dA);
+		}
+		src += srcbpp;
+		dst += dstbpp;
+	    },
+	    width);
+	    src += srcskip;
+	    dst += dstskip;
+	}
+}
+
+#ifdef __ARM_NEON__
+#define GetBlitFeatures() SDL_GetNeonBlitFeatures()
+
+/* NEON versions of the C alpha blitters above with the same results,
+ * these do 8 pixel groups and leave the right edge strip to them */
+static void neon_alpha_params(SDL_BlitInfo *info, Uint32 *params)
+{
+	SDL_PixelFormat *srcfmt = info->src;
+	SDL_PixelFormat *dstfmt = info->dst;
+
+	params[0] = srcfmt->alpha;
+	params[1] = srcfmt->colorkey;
+	params[2] = dstfmt->Amask;
+	params[3] = dstfmt->Gmask == 0x7e0 ? 0x07e0f81f : 0x03e07c1f;
+}
+
+#define make_neon_edge_caller(name, neon_name, sbpp, dbpp, c_name) \
+extern void neon_name(void *dst, const void *src, int count, const Uint32 *params); \
+static void name(SDL_BlitInfo *info) \
+{ \
+	int width = info->d_width & ~7; \
+	int height = info->d_height; \
+	Uint8 *src = info->s_pixels; \
+	Uint8 *dst = info->d_pixels; \
+	int srcskip = info->s_skip + (info->d_width - width) * sbpp; \
+	int dstskip = info->d_skip + (info->d_width - width) * dbpp; \
+	SDL_BlitInfo edge; \
+	Uint32 params[4]; \
+\
+	if ( width ) { \
+	    neon_alpha_params(info, params); \
+	    while ( height-- ) { \
+	        neon_name(dst, src, width, params); \
+	        src += width * sbpp + srcskip; \
+	        dst += width * dbpp + dstskip; \
+	    } \
+	} \
+	if ( width != info->d_width ) { \
+	    edge = *info; \
+	    edge.s_pixels += width * sbpp; \
+	    edge.d_pixels += width * dbpp; \
+	    edge.s_skip += width * sbpp; \
+	    edge.d_skip += width * dbpp; \
+	    edge.d_width -= width; \
+	    c_name(&edge); \
+	} \
+}
+
+make_neon_edge_caller(Blit565to565SurfaceAlpha_neon, neon_alpha16, 2, 2, Blit565to565SurfaceAlpha)
+make_neon_edge_caller(Blit555to555SurfaceAlpha_neon, neon_alpha16, 2, 2, Blit555to555SurfaceAlpha)
+make_neon_edge_caller(Blit16to16SurfaceAlphaKey_neon, neon_alpha16key, 2, 2, BlitNtoNSurfaceAlphaKey)
+make_neon_edge_caller(Blit32to32SurfaceAlphaKey_neon, neon_alpha32key, 4, 4, BlitNtoNSurfaceAlphaKey)
+make_neon_edge_caller(BlitRGBtoRGBPixelAlpha_neon, neon_RGBtoRGBalpha, 4, 4, BlitRGBtoRGBPixelAlpha)
+make_neon_edge_caller(BlitARGBto565PixelAlpha_neon, neon_ARGBto565alpha, 4, 2, BlitARGBto565PixelAlpha)
+make_neon_edge_caller(BlitARGBto555PixelAlpha_neon, neon_ARGBto555alpha, 4, 2, BlitARGBto555PixelAlpha)
+make_neon_edge_caller(BlitRGBtoRGBPixelAlphaPremul_neon, neon_RGBtoRGBalpha_premul, 4, 4, BlitRGBtoRGBPixelAlphaPremul)
+make_neon_edge_caller(BlitARGBto565PixelAlphaPremul_neon, neon_ARGBto565alpha_premul, 4, 2, BlitARGBto565PixelAlphaPremul)
+make_neon_edge_caller(BlitARGBto555PixelAlphaPremul_neon, neon_ARGBto555alpha_premul, 4, 2, BlitARGBto555PixelAlphaPremul)
+#endif /* __ARM_NEON__ */
+
 
 SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 {
@@ -2808,6 +3190,21 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	    if(df->BytesPerPixel == 1)
 		return BlitNto1SurfaceAlphaKey;
 	    else
+#ifdef __ARM_NEON__
+	    /* same conditions as the fast paths in BlitNtoNSurfaceAlphaKey */
+	    if(sf->BytesPerPixel == 2 && df->BytesPerPixel == 2
+	       && sf->Gmask == df->Gmask && sf->Rmask == df->Rmask
+	       && !df->Amask && (sf->Gmask == 0x7e0 || sf->Gmask == 0x3e0)
+	       && (GetBlitFeatures() & SDL_BLIT_FEATURE_NEON))
+		return Blit16to16SurfaceAlphaKey_neon;
+	    else if(sf->BytesPerPixel == 4 && df->BytesPerPixel == 4
+	       && sf->Gmask == 0xff00 && sf->Rmask == df->Rmask
+	       && sf->Gmask == df->Gmask && sf->Bmask == df->Bmask
+	       && (sf->Rmask | sf->Bmask) == 0xff00ff
+	       && (GetBlitFeatures() & SDL_BLIT_FEATURE_NEON))
+		return Blit32to32SurfaceAlphaKey_neon;
+	    else
+#endif
 #if SDL_ALTIVEC_BLITTERS
 	if (sf->BytesPerPixel == 4 && df->BytesPerPixel == 4 &&
 	    !(surface->map->dst->flags & SDL_HWSURFACE) && SDL_HasAltiVec())
@@ -2829,6 +3226,11 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		if(SDL_HasMMX())
 			return Blit565to565SurfaceAlphaMMX;
 		else
+#endif
+#ifdef __ARM_NEON__
+		if(GetBlitFeatures() & SDL_BLIT_FEATURE_NEON)
+			return Blit565to565SurfaceAlpha_neon;
+		else
 #endif
 			return Blit565to565SurfaceAlpha;
 		    }
@@ -2838,6 +3240,11 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		if(SDL_HasMMX())
 			return Blit555to555SurfaceAlphaMMX;
 		else
+#endif
+#ifdef __ARM_NEON__
+		if(GetBlitFeatures() & SDL_BLIT_FEATURE_NEON)
+			return Blit555to555SurfaceAlpha_neon;
+		else
 #endif
 			return Blit555to555SurfaceAlpha;
 		    }
@@ -2860,7 +3267,8 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 #ifdef __ARM_NEON__
 			if(sf->Rshift % 8 == 0
 			   && sf->Gshift % 8 == 0
-			   && sf->Bshift % 8 == 0)
+			   && sf->Bshift % 8 == 0
+			   && (GetBlitFeatures() & SDL_BLIT_FEATURE_NEON))
 			{
 				return BlitARGBtoXRGBalphaS_neon;
 			}
@@ -2877,7 +3285,8 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		}
 #ifdef __ARM_NEON__
 		if (sf->Gmask == df->Gmask && sf->Rmask == df->Bmask && sf->Bmask == df->Rmask
-		    && sf->Rshift % 8 == 0 && sf->Gshift % 8 == 0 && sf->Bshift % 8 == 0)
+		    && sf->Rshift % 8 == 0 && sf->Gshift % 8 == 0 && sf->Bshift % 8 == 0
+		    && (GetBlitFeatures() & SDL_BLIT_FEATURE_NEON))
 		{
 			return BlitABGRtoXRGBalphaS_neon;
 		}
@@ -2895,6 +3304,61 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 		return BlitNtoNSurfaceAlpha;
 	    }
 	}
+    } else if(surface->flags & SDL_PREMULALPHA) {
+	/* Per-pixel premultiplied alpha blits */
+	switch(df->BytesPerPixel) {
+	case 1:
+	    return BlitNto1PixelAlphaPremul;
+
+	case 2:
+	    if(sf->BytesPerPixel == 4 && sf->Amask == 0xff000000
+	       && sf->Gmask == 0xff00
+	       && ((sf->Rmask == 0xff && df->Rmask == 0x1f)
+		   || (sf->Bmask == 0xff && df->Bmask == 0x1f))) {
+#ifdef __ARM_NEON__
+		if(df->Gmask == 0x7e0 && (GetBlitFeatures() & SDL_BLIT_FEATURE_NEON))
+		    return BlitARGBto565PixelAlphaPremul_neon;
+		else if(df->Gmask == 0x3e0 && (GetBlitFeatures() & SDL_BLIT_FEATURE_NEON))
+		    return BlitARGBto555PixelAlphaPremul_neon;
+		else
+#endif
+		if(df->Gmask == 0x7e0)
+		    return BlitARGBto565PixelAlphaPremul;
+		else if(df->Gmask == 0x3e0)
+		    return BlitARGBto555PixelAlphaPremul;
+	    }
+	    return BlitNtoNPixelAlphaPremul;
+
+	case 4:
+	    /* bytes are blended alike, alpha goes to the unused byte */
+	    if(sf->BytesPerPixel == 4
+	       && sf->Rmask == df->Rmask
+	       && sf->Gmask == df->Gmask
+	       && sf->Bmask == df->Bmask
+	       && (sf->Rmask | sf->Gmask | sf->Bmask | sf->Amask) == 0xffffffff
+	       && sf->Rshift % 8 == 0
+	       && sf->Gshift % 8 == 0
+	       && sf->Bshift % 8 == 0
+	       && sf->Ashift % 8 == 0)
+	    {
+		if(sf->Amask == 0xff000000)
+		{
+#ifdef __ARM_NEON__
+		    if(GetBlitFeatures() & SDL_BLIT_FEATURE_NEON)
+			return BlitRGBtoRGBPixelAlphaPremul_neon;
+#endif
+#ifdef __SSE2__
+		    return BlitRGBtoRGBPixelAlphaPremulSSE2;
+#endif
+		}
+		return BlitRGBtoRGBPixelAlphaPremul;
+	    }
+	    return BlitNtoNPixelAlphaPremul;
+
+	case 3:
+	default:
+	    return BlitNtoNPixelAlphaPremul;
+	}
     } else {
 	/* Per-pixel alpha blits */
 	switch(df->BytesPerPixel) {
@@ -2908,26 +3372,30 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 	   df->Bmask == 0x1f && SDL_HasAltiVec())
             return Blit32to565PixelAlphaAltivec;
         else
-#endif
-#ifdef __ARM_NEON__
-	    if(sf->BytesPerPixel == 4 && sf->Amask == 0xff000000
-	       && sf->Gmask == 0xff00 && df->Gmask == 0x7e0) {
-	        if((sf->Bmask >> 3) == df->Bmask || (sf->Rmask >> 3) == df->Rmask)
-	            return BlitARGBtoRGB565alpha_neon;
-	        else
-	            return BlitABGRtoRGB565alpha_neon;
-	    }
-	    else
 #endif
 	    if(sf->BytesPerPixel == 4 && sf->Amask == 0xff000000
 	       && sf->Gmask == 0xff00
 	       && ((sf->Rmask == 0xff && df->Rmask == 0x1f)
 		   || (sf->Bmask == 0xff && df->Bmask == 0x1f))) {
+#ifdef __ARM_NEON__
+		if(df->Gmask == 0x7e0 && (GetBlitFeatures() & SDL_BLIT_FEATURE_NEON))
+		    return BlitARGBto565PixelAlpha_neon;
+		else if(df->Gmask == 0x3e0 && (GetBlitFeatures() & SDL_BLIT_FEATURE_NEON))
+		    return BlitARGBto555PixelAlpha_neon;
+		else
+#endif
 		if(df->Gmask == 0x7e0)
 		    return BlitARGBto565PixelAlpha;
 		else if(df->Gmask == 0x3e0)
 		    return BlitARGBto555PixelAlpha;
 	    }
+#ifdef __ARM_NEON__
+	    /* R and B swapped */
+	    if(sf->BytesPerPixel == 4 && sf->Amask == 0xff000000
+	       && sf->Gmask == 0xff00 && df->Gmask == 0x7e0
+	       && (GetBlitFeatures() & SDL_BLIT_FEATURE_NEON))
+	        return BlitABGRtoRGB565alpha_neon;
+#endif
 	    return BlitNtoNPixelAlpha;
 
 	case 4:
@@ -2948,18 +3416,13 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 			if(SDL_HasMMX())
 				return BlitRGBtoRGBPixelAlphaMMX;
 		}
-#endif
-#ifdef __ARM_NEON__
-		if(sf->Rshift % 8 == 0
-		   && sf->Gshift % 8 == 0
-		   && sf->Bshift % 8 == 0
-		   && sf->Ashift % 8 == 0)
-		{
-			return BlitARGBtoXRGBalpha_neon;
-		}
 #endif
 		if(sf->Amask == 0xff000000)
 		{
+#ifdef __ARM_NEON__
+			if(GetBlitFeatures() & SDL_BLIT_FEATURE_NEON)
+				return BlitRGBtoRGBPixelAlpha_neon;
+#endif
 #if SDL_ALTIVEC_BLITTERS
 			if(!(surface->map->dst->flags & SDL_HWSURFACE)
 				&& SDL_HasAltiVec())
@@ -2971,7 +3434,7 @@ SDL_loblit SDL_CalculateAlphaBlit(SDL_Surface *surface, int blit_index)
 #ifdef __ARM_NEON__
 	    if (sf->Gmask == df->Gmask && sf->Rmask == df->Bmask && sf->Bmask == df->Rmask
 		&& sf->Rshift % 8 == 0 && sf->Gshift % 8 == 0 && sf->Bshift % 8 == 0
-		&& sf->Amask == 0xff000000)
+		&& sf->Amask == 0xff000000 && (GetBlitFeatures() & SDL_BLIT_FEATURE_NEON))
 	    {
 		return BlitABGRtoXRGBalpha_neon;
 	    }
@@ -836,6 +836,9 @@ static Uint32 GetBlitFeatures( void )
 #if __MWERKS__
 #pragma altivec_model off
 #endif
+#elif defined(__ARM_NEON__)
+/* Feature 8 is has-NEON (SDL_BLIT_FEATURE_NEON) */
+#define GetBlitFeatures() SDL_GetNeonBlitFeatures()
 #else
 /* Feature 1 is has-MMX */
 #define GetBlitFeatures() ((Uint32)(SDL_HasMMX() ? 1 : 0))
@@ -894,10 +897,12 @@ static void Blit_RGB888_index8(SDL_BlitInfo *info)
 #ifdef USE_DUFFS_LOOP
 			DUFFS_LOOP(
 				RGB888_RGB332(*dst++, *src);
+				++src;
 			, width);
 #else
 			for ( c=width/4; c; --c ) {
 				/* Pack RGB into 8bit pixel */
+				RGB888_RGB332(*dst++, *src);
 				++src;
 				RGB888_RGB332(*dst++, *src);
 				++src;
@@ -2296,6 +2301,72 @@ static void BlitNtoNKeyCopyAlpha(SDL_BlitInfo *info)
 	}
 }
 
+#ifdef __ARM_NEON__
+
+/* NEON colorkey and 16bpp conversion blitters, these do 8 pixel groups
+ * and leave the right edge strip to the C versions */
+static void neon_blit_params(SDL_BlitInfo *info, Uint32 *params)
+{
+	SDL_PixelFormat *srcfmt = info->src;
+	SDL_PixelFormat *dstfmt = info->dst;
+
+	params[1] = ~srcfmt->Amask;
+	params[0] = srcfmt->colorkey & params[1];
+	params[2] = dstfmt->Rmask | dstfmt->Gmask | dstfmt->Bmask;
+	params[3] = 0;
+	if ( dstfmt->Amask ) {
+		if ( srcfmt->Amask )
+			params[2] |= dstfmt->Amask;
+		else
+			params[3] = (srcfmt->alpha >> dstfmt->Aloss) << dstfmt->Ashift;
+	}
+}
+
+#define make_neon_edge_caller(name, neon_name, sbpp, dbpp, c_name) \
+extern void neon_name(void *dst, const void *src, int count, const Uint32 *params); \
+static void name(SDL_BlitInfo *info) \
+{ \
+	int width = info->d_width & ~7; \
+	int height = info->d_height; \
+	Uint8 *src = info->s_pixels; \
+	Uint8 *dst = info->d_pixels; \
+	int srcskip = info->s_skip + (info->d_width - width) * sbpp; \
+	int dstskip = info->d_skip + (info->d_width - width) * dbpp; \
+	SDL_BlitInfo edge; \
+	Uint32 params[4]; \
+\
+	if ( width ) { \
+	    neon_blit_params(info, params); \
+	    while ( height-- ) { \
+	        neon_name(dst, src, width, params); \
+	        src += width * sbpp + srcskip; \
+	        dst += width * dbpp + dstskip; \
+	    } \
+	} \
+	if ( width != info->d_width ) { \
+	    edge = *info; \
+	    edge.s_pixels += width * sbpp; \
+	    edge.d_pixels += width * dbpp; \
+	    edge.s_skip += width * sbpp; \
+	    edge.d_skip += width * dbpp; \
+	    edge.d_width -= width; \
+	    c_name(&edge); \
+	} \
+}
+
+make_neon_edge_caller(Blit2to2Key_neon, neon_key16, 2, 2, Blit2to2Key)
+make_neon_edge_caller(BlitNtoNKey_neon, neon_key32, 4, 4, BlitNtoNKey)
+make_neon_edge_caller(BlitNtoNKeyCopyAlpha_neon, neon_key32, 4, 4, BlitNtoNKeyCopyAlpha)
+make_neon_edge_caller(Blit32to565Key_neon, neon_key32to565, 4, 2, BlitNtoNKey)
+
+make_neon_edge_caller(Blit_RGB888_RGB565_neon, neon_RGB888toRGB565, 4, 2, Blit_RGB888_RGB565)
+make_neon_edge_caller(Blit_BGR888_RGB565_neon, neon_BGR888toRGB565, 4, 2, BlitNtoN)
+make_neon_edge_caller(Blit_RGB565_XRGB8888_neon, neon_RGB565toXRGB8888, 2, 4, BlitNtoN)
+make_neon_edge_caller(Blit_RGB555_RGB565_neon, neon_RGB555toRGB565, 2, 2, BlitNtoN)
+make_neon_edge_caller(Blit_RGB565_RGB555_neon, neon_RGB565toRGB555, 2, 2, BlitNtoN)
+
+#endif /* __ARM_NEON__ */
+
 /* Normal N to N optimized blitters */
 struct blit_table {
 	Uint32 srcR, srcG, srcB;
@@ -2324,6 +2395,14 @@ static const struct blit_table normal_blit_2[] = {
       2, NULL, Blit_RGB565_32Altivec, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
     { 0x00007C00,0x000003E0,0x0000001F, 4, 0x00000000,0x00000000,0x00000000,
       2, NULL, Blit_RGB555_32Altivec, NO_ALPHA | COPY_ALPHA | SET_ALPHA },
+#endif
+#ifdef __ARM_NEON__
+    { 0x0000F800,0x000007E0,0x0000001F, 4, 0x00FF0000,0x0000FF00,0x000000FF,
+      8, NULL, Blit_RGB565_XRGB8888_neon, NO_ALPHA },
+    { 0x0000F800,0x000007E0,0x0000001F, 2, 0x00007C00,0x000003E0,0x0000001F,
+      8, NULL, Blit_RGB565_RGB555_neon, NO_ALPHA },
+    { 0x00007C00,0x000003E0,0x0000001F, 2, 0x0000F800,0x000007E0,0x0000001F,
+      8, NULL, Blit_RGB555_RGB565_neon, NO_ALPHA },
 #endif
     { 0x0000F800,0x000007E0,0x0000001F, 4, 0x00FF0000,0x0000FF00,0x000000FF,
       0, NULL, Blit_RGB565_ARGB8888, SET_ALPHA },
@@ -2382,6 +2461,12 @@ static const struct blit_table normal_blit_4[] = {
     /* has-altivec */
     { 0x00000000,0x00000000,0x00000000, 2, 0x0000F800,0x000007E0,0x0000001F,
       2, NULL, Blit_RGB888_RGB565Altivec, NO_ALPHA },
+#endif
+#ifdef __ARM_NEON__
+    { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x0000F800,0x000007E0,0x0000001F,
+      8, NULL, Blit_RGB888_RGB565_neon, NO_ALPHA },
+    { 0x000000FF,0x0000FF00,0x00FF0000, 2, 0x0000F800,0x000007E0,0x0000001F,
+      8, NULL, Blit_BGR888_RGB565_neon, NO_ALPHA },
 #endif
     { 0x00FF0000,0x0000FF00,0x000000FF, 2, 0x0000F800,0x000007E0,0x0000001F,
       0, NULL, Blit_RGB888_RGB565, NO_ALPHA },
@@ -2390,12 +2475,12 @@ static const struct blit_table normal_blit_4[] = {
 #endif
 #ifdef __ARM_NEON__
     { 0x00FF0000,0x0000FF00,0x000000FF, 4, 0x00FF0000,0x0000FF00,0x000000FF,
-      0, NULL, BlitARGBtoXRGB_neon, NO_ALPHA | SET_ALPHA },
+      8, NULL, BlitARGBtoXRGB_neon, NO_ALPHA | SET_ALPHA },
     { 0x000000FF,0x0000FF00,0x00FF0000, 4, 0x00FF0000,0x0000FF00,0x000000FF,
-      0, NULL, BlitABGRtoXRGB_neon, NO_ALPHA | SET_ALPHA },
+      8, NULL, BlitABGRtoXRGB_neon, NO_ALPHA | SET_ALPHA },
     /* RGB->BGR is same as BGR->RGB */
     { 0x00FF0000,0x0000FF00,0x000000FF, 4, 0x000000FF,0x0000FF00,0x00FF0000,
-      0, NULL, BlitABGRtoXRGB_neon, NO_ALPHA | SET_ALPHA },
+      8, NULL, BlitABGRtoXRGB_neon, NO_ALPHA | SET_ALPHA },
 #endif
 	/* Default for 32-bit RGB source, used if no other blitter matches */
 	{ 0,0,0, 0, 0,0,0, 0, NULL, BlitNtoN, 0 }
@@ -2437,11 +2522,38 @@ SDL_loblit SDL_CalculateBlitN(SDL_Surface *surface, int blit_index)
 	       If a particular case turns out to be useful we'll add it. */
 
 	    if(srcfmt->BytesPerPixel == 2
-	       && surface->map->identity)
+	       && surface->map->identity) {
+#ifdef __ARM_NEON__
+		if(GetBlitFeatures() & SDL_BLIT_FEATURE_NEON)
+		    return Blit2to2Key_neon;
+#endif
 		return Blit2to2Key;
+	    }
 	    else if(dstfmt->BytesPerPixel == 1)
 		return BlitNto1Key;
 	    else {
+#ifdef __ARM_NEON__
+		if(GetBlitFeatures() & SDL_BLIT_FEATURE_NEON) {
+		    if(srcfmt->BytesPerPixel == 4 && dstfmt->BytesPerPixel == 4
+		       && srcfmt->Rmask == dstfmt->Rmask
+		       && srcfmt->Gmask == dstfmt->Gmask
+		       && srcfmt->Bmask == dstfmt->Bmask) {
+			if(!srcfmt->Amask || !dstfmt->Amask)
+			    return BlitNtoNKey_neon;
+			if(srcfmt->Amask == dstfmt->Amask)
+			    return BlitNtoNKeyCopyAlpha_neon;
+		    }
+		    if(srcfmt->BytesPerPixel == 4 && dstfmt->BytesPerPixel == 2
+		       && srcfmt->Rmask == 0x00FF0000
+		       && srcfmt->Gmask == 0x0000FF00
+		       && srcfmt->Bmask == 0x000000FF
+		       && dstfmt->Rmask == 0xF800
+		       && dstfmt->Gmask == 0x07E0
+		       && dstfmt->Bmask == 0x001F
+		       && !dstfmt->Amask)
+			return Blit32to565Key_neon;
+		}
+#endif
 #if SDL_ALTIVEC_BLITTERS
         if((srcfmt->BytesPerPixel == 4) && (dstfmt->BytesPerPixel == 4) && SDL_HasAltiVec()) {
             return Blit32to32KeyAltivec;
@@ -0,0 +1,297 @@
+/*
+    SDL - Simple DirectMedia Layer
+    Copyright (C) 1997-2009 Sam Lantinga
+
+    This library is free software; you can redistribute it and/or
+    modify it under the terms of the GNU Lesser General Public
+    License as published by the Free Software Foundation; either
+    version 2.1 of the License, or (at your option) any later version.
+
+    This library is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+    Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public
+    License along with this library; if not, write to the Free Software
+    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+
+    Sam Lantinga
+    slouken@libsdl.org
+*/
+#include "SDL_config.h"
+
+/* Big software blits and fills can be split into bands of rows that
+   are done in parallel by a pool of threads.  This is off unless the
+   SDL_BLIT_THREADS environment variable sets the number of threads to
+   use (counting the one that blits) before SDL_Init().  Only blits
+   writing at least SDL_BLIT_THREADS_MIN bytes (256 KiB by default)
+   are split.
+
+   Each band is done by the same blitter that would do the whole rect
+   and they don't overlap, so the result is exactly the same whatever
+   the number of threads.  The calling thread works on bands too and
+   returns only when all of them are done, unless they are started with
+   SDL_StartBlitBands() which leaves them to the pool until
+   SDL_FinishBlitBands().
+*/
+
+#include "SDL_video.h"
+#include "SDL_thread.h"
+#include "SDL_blit.h"
+
+#define MAX_BLIT_THREADS	16
+#define DEFAULT_MIN_BYTES	(256*1024)
+#define MIN_BAND_ROWS		8
+
+#if SDL_THREADS_DISABLED
+
+int SDL_BlitThreadsInit(void)
+{
+	return(0);
+}
+
+void SDL_BlitThreadsQuit(void)
+{
+}
+
+int SDL_BlitBands(int rows, int bytes)
+{
+	return(1);
+}
+
+void SDL_RunBlitBands(SDL_bandfunc func, void *arg, int bands)
+{
+	int band;
+
+	for ( band = 0; band < bands; ++band ) {
+		func(arg, band, bands);
+	}
+}
+
+int SDL_StartBlitBands(SDL_bandfunc func, void *arg, int bands)
+{
+	SDL_RunBlitBands(func, arg, bands);
+	return(0);
+}
+
+void SDL_FinishBlitBands(void)
+{
+}
+
+#else
+
+static struct {
+	SDL_Thread *threads[MAX_BLIT_THREADS];
+	int count;		/* not counting the caller */
+	int min_bytes;
+	SDL_mutex *lock;
+	SDL_cond *work;
+	SDL_cond *done;
+	SDL_bandfunc func;
+	void *arg;
+	int bands, next_band, pending;
+	int busy;
+	int quit;
+} pool;
+
+/* Grab the next band, -1 if none left; lock must be held */
+static int SDL_TakeBand(void)
+{
+	if ( pool.next_band >= pool.bands ) {
+		return(-1);
+	}
+	return(pool.next_band++);
+}
+
+static int SDLCALL SDL_BlitThread(void *unused)
+{
+	SDL_bandfunc func;
+	void *arg;
+	int band, bands;
+
+	SDL_mutexP(pool.lock);
+	for ( ;; ) {
+		while ( (band = SDL_TakeBand()) < 0 && !pool.quit ) {
+			SDL_CondWait(pool.work, pool.lock);
+		}
+		if ( band < 0 ) {
+			break;
+		}
+
+		func = pool.func;
+		arg = pool.arg;
+		bands = pool.bands;
+		SDL_mutexV(pool.lock);
+		func(arg, band, bands);
+		SDL_mutexP(pool.lock);
+
+		if ( --pool.pending == 0 ) {
+			SDL_CondSignal(pool.done);
+		}
+	}
+	SDL_mutexV(pool.lock);
+
+	return(0);
+}
+
+int SDL_BlitThreadsInit(void)
+{
+	const char *env;
+	int i, count;
+
+	if ( pool.lock ) {
+		return(0);
+	}
+	env = SDL_getenv("SDL_BLIT_THREADS");
+	count = env ? SDL_atoi(env) - 1 : 0;
+	if ( count <= 0 ) {
+		return(0);
+	}
+	if ( count > MAX_BLIT_THREADS ) {
+		count = MAX_BLIT_THREADS;
+	}
+	pool.min_bytes = DEFAULT_MIN_BYTES;
+	env = SDL_getenv("SDL_BLIT_THREADS_MIN");
+	if ( env ) {
+		pool.min_bytes = SDL_atoi(env);
+	}
+
+	/* Not having threads is not an error, blits just aren't split */
+	pool.lock = SDL_CreateMutex();
+	pool.work = SDL_CreateCond();
+	pool.done = SDL_CreateCond();
+	if ( !pool.lock || !pool.work || !pool.done ) {
+		SDL_BlitThreadsQuit();
+		return(-1);
+	}
+	for ( i = 0; i < count; ++i ) {
+		pool.threads[i] = SDL_CreateThread(SDL_BlitThread, NULL);
+		if ( pool.threads[i] == NULL ) {
+			break;
+		}
+	}
+	pool.count = i;
+	if ( pool.count == 0 ) {
+		SDL_BlitThreadsQuit();
+		return(-1);
+	}
+	return(0);
+}
+
+void SDL_BlitThreadsQuit(void)
+{
+	int i;
+
+	if ( pool.lock ) {
+		SDL_mutexP(pool.lock);
+		pool.quit = 1;
+		SDL_CondBroadcast(pool.work);
+		SDL_mutexV(pool.lock);
+	}
+	for ( i = 0; i < pool.count; ++i ) {
+		SDL_WaitThread(pool.threads[i], NULL);
+	}
+	if ( pool.done ) {
+		SDL_DestroyCond(pool.done);
+	}
+	if ( pool.work ) {
+		SDL_DestroyCond(pool.work);
+	}
+	if ( pool.lock ) {
+		SDL_DestroyMutex(pool.lock);
+	}
+	SDL_memset(&pool, 0, sizeof(pool));
+}
+
+/* How many bands to split a blit of 'rows' rows writing 'bytes' into */
+int SDL_BlitBands(int rows, int bytes)
+{
+	int bands;
+
+	if ( pool.count == 0 || bytes < pool.min_bytes ) {
+		return(1);
+	}
+	bands = pool.count + 1;
+	if ( bands > rows / MIN_BAND_ROWS ) {
+		bands = rows / MIN_BAND_ROWS;
+	}
+	return(bands > 1 ? bands : 1);
+}
+
+/* Hands the bands to the pool and returns without waiting for them, 1 if
+   SDL_FinishBlitBands() has to be called before touching anything they
+   use.  If there are no threads or they are busy with another job the
+   bands are all done here and 0 is returned.
+*/
+int SDL_StartBlitBands(SDL_bandfunc func, void *arg, int bands)
+{
+	int band;
+
+	if ( pool.count > 0 ) {
+		SDL_mutexP(pool.lock);
+		if ( ! pool.busy ) {
+			pool.busy = 1;
+			pool.func = func;
+			pool.arg = arg;
+			pool.bands = bands;
+			pool.next_band = 0;
+			pool.pending = bands;
+			SDL_CondBroadcast(pool.work);
+			SDL_mutexV(pool.lock);
+			return(1);
+		}
+		/* another thread is using the pool, do it all here */
+		SDL_mutexV(pool.lock);
+	}
+	for ( band = 0; band < bands; ++band ) {
+		func(arg, band, bands);
+	}
+	return(0);
+}
+
+/* Helps with the bands left of the started job and waits for the rest */
+void SDL_FinishBlitBands(void)
+{
+	SDL_bandfunc func;
+	void *arg;
+	int band, bands;
+
+	if ( ! pool.lock ) {
+		/* SDL_BlitThreadsQuit() has the threads do all the bands */
+		return;
+	}
+	SDL_mutexP(pool.lock);
+	func = pool.func;
+	arg = pool.arg;
+	bands = pool.bands;
+	while ( (band = SDL_TakeBand()) >= 0 ) {
+		SDL_mutexV(pool.lock);
+		func(arg, band, bands);
+		SDL_mutexP(pool.lock);
+		pool.pending--;
+	}
+	while ( pool.pending > 0 ) {
+		SDL_CondWait(pool.done, pool.lock);
+	}
+	pool.bands = 0;
+	pool.busy = 0;
+	SDL_mutexV(pool.lock);
+}
+
+void SDL_RunBlitBands(SDL_bandfunc func, void *arg, int bands)
+{
+	int band;
+
+	if ( pool.count == 0 || bands <= 1 ) {
+		for ( band = 0; band < bands; ++band ) {
+			func(arg, band, bands);
+		}
+		return;
+	}
+	if ( SDL_StartBlitBands(func, arg, bands) ) {
+		SDL_FinishBlitBands();
+	}
+}
+
+#endif /* SDL_THREADS_DISABLED */
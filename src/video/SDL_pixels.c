@@ -24,6 +24,7 @@
 /* General (mostly internal) pixel/color manipulation routines for SDL */
 
 #include "SDL_endian.h"
+#include "SDL_mutex.h"
 #include "SDL_video.h"
 #include "SDL_sysvideo.h"
 #include "SDL_blit.h"
@@ -460,30 +461,251 @@ static Uint8 *Map1to1(SDL_Palette *src, SDL_Palette *dst, int *identical)
 	}
 	return(map);
 }
-/* Map from Palette to BitField */
-static Uint8 *Map1toN(SDL_PixelFormat *src, SDL_PixelFormat *dst)
+/* Palette to BitField tables are shared by all surfaces with the same
+   colors blitting to the same kind of destination, so palette swaps
+   back to an earlier palette and sprites loaded from the same file don't
+   each build their own.  SDL_Palette has no version count, tables are
+   found by a hash of the colors instead.  A few released tables are kept
+   around, so when a palette changes only the colors that differ have to
+   be mapped again.  The list is shared by all threads, it's only used
+   with SDL_palettemaps_lock held.
+ */
+#define SDL_PALETTEMAPS_KEPT	8
+
+typedef struct SDL_PaletteMap {
+	Uint32 hash;
+	int ncolors;
+	SDL_Color colors[256];
+	Uint8 BytesPerPixel;
+	Uint32 Rmask, Gmask, Bmask, Amask;
+	unsigned alpha;
+	int refcount;
+	Uint32 table[256];
+	struct SDL_PaletteMap *next;
+} SDL_PaletteMap;
+
+/* Most recently used or released first */
+static SDL_PaletteMap *SDL_palettemaps = NULL;
+static SDL_mutex *SDL_palettemaps_lock = NULL;
+
+static void SDL_LockPaletteMaps(void)
+{
+	if ( ! SDL_palettemaps_lock ) {
+		SDL_palettemaps_lock = SDL_CreateMutex();
+	}
+	if ( SDL_palettemaps_lock ) {
+		SDL_mutexP(SDL_palettemaps_lock);
+	}
+}
+
+static void SDL_UnlockPaletteMaps(void)
+{
+	if ( SDL_palettemaps_lock ) {
+		SDL_mutexV(SDL_palettemaps_lock);
+	}
+}
+
+static Uint32 SDL_PaletteHash(SDL_Palette *pal)
+{
+	Uint32 hash = 2166136261u;
+	int i;
+
+	for ( i=0; i<pal->ncolors; ++i ) {
+		hash = (hash ^ pal->colors[i].r) * 16777619u;
+		hash = (hash ^ pal->colors[i].g) * 16777619u;
+		hash = (hash ^ pal->colors[i].b) * 16777619u;
+	}
+	return(hash);
+}
+
+#define SAME_COLOR(x, y) \
+	((x).r == (y).r && (x).g == (y).g && (x).b == (y).b)
+
+static int SDL_SamePaletteMapFormat(SDL_PaletteMap *pm,
+				SDL_PixelFormat *dst, unsigned alpha)
+{
+	return(pm->BytesPerPixel == dst->BytesPerPixel &&
+	       pm->Rmask == dst->Rmask && pm->Gmask == dst->Gmask &&
+	       pm->Bmask == dst->Bmask && pm->Amask == dst->Amask &&
+	       pm->alpha == alpha);
+}
+
+static int SDL_SamePaletteMapColors(SDL_PaletteMap *pm, SDL_Palette *pal)
 {
-	Uint8 *map;
 	int i;
-	int  bpp;
+
+	if ( pm->ncolors != pal->ncolors ) {
+		return(0);
+	}
+	for ( i=0; i<pal->ncolors; ++i ) {
+		if ( ! SAME_COLOR(pm->colors[i], pal->colors[i]) ) {
+			return(0);
+		}
+	}
+	return(1);
+}
+
+/* Map the colors that differ from what the table was made for */
+static void SDL_UpdatePaletteMap(SDL_PaletteMap *pm, SDL_Palette *pal,
+				SDL_PixelFormat *dst, int all)
+{
+	Uint8 *map = (Uint8 *)pm->table;
+	int bpp = ((dst->BytesPerPixel == 3) ? 4 : dst->BytesPerPixel);
+	int i;
+
+	/* We memory copy to the pixel map so the endianness is preserved */
+	for ( i=0; i<pal->ncolors; ++i ) {
+		if ( all || i >= pm->ncolors ||
+		     ! SAME_COLOR(pm->colors[i], pal->colors[i]) ) {
+			ASSEMBLE_RGBA(&map[i*bpp], dst->BytesPerPixel, dst,
+				      pal->colors[i].r, pal->colors[i].g,
+				      pal->colors[i].b, pm->alpha);
+			pm->colors[i] = pal->colors[i];
+		}
+	}
+	pm->ncolors = pal->ncolors;
+}
+
+static void SDL_ReleasePaletteMap(SDL_PaletteMap *release)
+{
+	SDL_PaletteMap *pm, *prev;
+	int kept = 0;
+
+	SDL_LockPaletteMaps();
+	if ( --release->refcount == 0 && release != SDL_palettemaps ) {
+		/* The next update of this palette will most likely want it */
+		for ( pm = SDL_palettemaps; pm->next != release; pm = pm->next )
+			;
+		pm->next = release->next;
+		release->next = SDL_palettemaps;
+		SDL_palettemaps = release;
+	}
+
+	/* Free the least recently used ones that aren't needed any more */
+	prev = NULL;
+	pm = SDL_palettemaps;
+	while ( pm ) {
+		if ( pm->refcount == 0 && ++kept > SDL_PALETTEMAPS_KEPT ) {
+			if ( prev ) {
+				prev->next = pm->next;
+			} else {
+				SDL_palettemaps = pm->next;
+			}
+			SDL_free(pm);
+			pm = prev ? prev->next : SDL_palettemaps;
+			continue;
+		}
+		prev = pm;
+		pm = pm->next;
+	}
+	SDL_UnlockPaletteMaps();
+}
+
+/* Called on SDL_Quit(), tables still in use stay until they're released */
+void SDL_FreePaletteMaps(void)
+{
+	SDL_PaletteMap *pm, *prev, *next;
+
+	SDL_LockPaletteMaps();
+	prev = NULL;
+	for ( pm = SDL_palettemaps; pm; pm = next ) {
+		next = pm->next;
+		if ( pm->refcount == 0 ) {
+			if ( prev ) {
+				prev->next = next;
+			} else {
+				SDL_palettemaps = next;
+			}
+			SDL_free(pm);
+		} else {
+			prev = pm;
+		}
+	}
+	SDL_UnlockPaletteMaps();
+	if ( SDL_palettemaps_lock ) {
+		SDL_DestroyMutex(SDL_palettemaps_lock);
+		SDL_palettemaps_lock = NULL;
+	}
+}
+
+/* Map from Palette to BitField */
+static Uint8 *Map1toN(SDL_PixelFormat *src, SDL_PixelFormat *dst,
+				SDL_PaletteMap **shared)
+{
+	SDL_PaletteMap *pm, *prev, *found, *found_prev, *reuse, *reuse_prev;
 	unsigned alpha;
+	Uint32 hash;
 	SDL_Palette *pal = src->palette;
 
-	bpp = ((dst->BytesPerPixel == 3) ? 4 : dst->BytesPerPixel);
-	map = (Uint8 *)SDL_malloc(pal->ncolors*bpp);
-	if ( map == NULL ) {
-		SDL_OutOfMemory();
+	if ( pal->ncolors > 256 ) {
+		SDL_SetError("Too many colors in palette");
 		return(NULL);
 	}
-
 	alpha = dst->Amask ? src->alpha : 0;
-	/* We memory copy to the pixel map so the endianness is preserved */
-	for ( i=0; i<pal->ncolors; ++i ) {
-		ASSEMBLE_RGBA(&map[i*bpp], dst->BytesPerPixel, dst,
-			      pal->colors[i].r, pal->colors[i].g,
-			      pal->colors[i].b, alpha);
+	hash = SDL_PaletteHash(pal);
+
+	/* Look for a table of these colors, or the most recently released
+	   free one to update otherwise, likely this surface's old table */
+	SDL_LockPaletteMaps();
+	found = found_prev = reuse = reuse_prev = NULL;
+	for ( prev = NULL, pm = SDL_palettemaps; pm; prev = pm, pm = pm->next ) {
+		if ( ! SDL_SamePaletteMapFormat(pm, dst, alpha) ) {
+			continue;
+		}
+		if ( pm->hash == hash && SDL_SamePaletteMapColors(pm, pal) ) {
+			found = pm;
+			found_prev = prev;
+			break;
+		}
+		if ( pm->refcount == 0 && ! reuse ) {
+			reuse = pm;
+			reuse_prev = prev;
+		}
+	}
+	if ( ! found && reuse ) {
+		found = reuse;
+		found_prev = reuse_prev;
+		SDL_UpdatePaletteMap(found, pal, dst, 0);
+		found->hash = hash;
+	}
+
+	if ( found ) {
+		if ( found_prev ) {
+			found_prev->next = found->next;
+			found->next = SDL_palettemaps;
+			SDL_palettemaps = found;
+		}
+	} else {
+		found = (SDL_PaletteMap *)SDL_malloc(sizeof(*found));
+		if ( found == NULL ) {
+			SDL_UnlockPaletteMaps();
+			SDL_OutOfMemory();
+			return(NULL);
+		}
+		SDL_memset(found, 0, sizeof(*found));
+		found->BytesPerPixel = dst->BytesPerPixel;
+		found->Rmask = dst->Rmask;
+		found->Gmask = dst->Gmask;
+		found->Bmask = dst->Bmask;
+		found->Amask = dst->Amask;
+		found->alpha = alpha;
+		SDL_UpdatePaletteMap(found, pal, dst, 1);
+		found->hash = hash;
+		found->next = SDL_palettemaps;
+		SDL_palettemaps = found;
+	}
+	++found->refcount;
+	SDL_UnlockPaletteMaps();
+	*shared = found;
+	return((Uint8 *)found->table);
+}
+static void SDL_FreeMapTable(Uint8 *table, SDL_PaletteMap *palmap)
+{
+	if ( palmap ) {
+		SDL_ReleasePaletteMap(palmap);
+	} else if ( table ) {
+		SDL_free(table);
 	}
-	return(map);
 }
 /* Map from BitField to Dithered-Palette to Palette */
 static Uint8 *MapNto1(SDL_PixelFormat *src, SDL_PixelFormat *dst, int *identical)
@@ -527,17 +749,105 @@ SDL_BlitMap *SDL_AllocBlitMap(void)
 	/* It's ready to go */
 	return(map);
 }
+/* Drop the current mapping, keeping it in the cache if 'keep' is set */
+static void SDL_ClearMap(SDL_BlitMap *map, int keep)
+{
+	SDL_BlitMapEntry *entry;
+
+	/* RLE data is made for one destination, so those aren't kept */
+	if ( keep && map->dst && map->sw_blit &&
+	     map->sw_blit != SDL_RLEBlit && map->sw_blit != SDL_RLEAlphaBlit ) {
+		entry = &map->cache[SDL_BLITMAP_CACHE-1];
+		SDL_FreeMapTable(entry->table, entry->palmap);
+		SDL_memmove(&map->cache[1], &map->cache[0],
+		            (SDL_BLITMAP_CACHE-1) * sizeof(*entry));
+		entry = &map->cache[0];
+		entry->key = map->key;
+		entry->identity = map->identity;
+		entry->table = map->table;
+		entry->palmap = map->palmap;
+		entry->sw_blit = map->sw_blit;
+		entry->blit = map->sw_data->blit;
+		entry->aux_data = map->sw_data->aux_data;
+		map->table = NULL;
+		map->palmap = NULL;
+	}
+	map->dst = NULL;
+	map->format_version = (unsigned int)-1;
+	SDL_FreeMapTable(map->table, map->palmap);
+	map->table = NULL;
+	map->palmap = NULL;
+}
+
+static void SDL_SetMapKey(SDL_BlitMapKey *key, SDL_Surface *src, SDL_Surface *dst)
+{
+	SDL_PixelFormat *dstfmt = dst->format;
+
+	SDL_memset(key, 0, sizeof(*key));
+	/* palette tables and overlapping copies depend on the surface */
+	if ( dstfmt->palette || src == dst ) {
+		key->dst = dst;
+		key->format_version = dst->format_version;
+	}
+	key->BitsPerPixel = dstfmt->BitsPerPixel;
+	key->Rmask = dstfmt->Rmask;
+	key->Gmask = dstfmt->Gmask;
+	key->Bmask = dstfmt->Bmask;
+	key->Amask = dstfmt->Amask;
+	key->src_flags = src->flags & (SDL_HWSURFACE|SDL_SRCCOLORKEY|SDL_SRCALPHA);
+	key->dst_flags = dst->flags & SDL_HWSURFACE;
+}
+
+/* Make a cached mapping current again, returns 0 if there's none */
+static int SDL_FindMap(SDL_BlitMap *map, const SDL_BlitMapKey *key)
+{
+	SDL_BlitMapEntry *entry;
+	int i;
+
+	for ( i = 0; i < SDL_BLITMAP_CACHE; ++i ) {
+		entry = &map->cache[i];
+		if ( entry->sw_blit &&
+		     entry->key.dst == key->dst &&
+		     entry->key.format_version == key->format_version &&
+		     entry->key.BitsPerPixel == key->BitsPerPixel &&
+		     entry->key.Rmask == key->Rmask &&
+		     entry->key.Gmask == key->Gmask &&
+		     entry->key.Bmask == key->Bmask &&
+		     entry->key.Amask == key->Amask &&
+		     entry->key.src_flags == key->src_flags &&
+		     entry->key.dst_flags == key->dst_flags ) {
+			break;
+		}
+	}
+	if ( i == SDL_BLITMAP_CACHE ) {
+		return(0);
+	}
+
+	map->identity = entry->identity;
+	map->table = entry->table;
+	map->palmap = entry->palmap;
+	map->sw_blit = entry->sw_blit;
+	map->sw_data->blit = entry->blit;
+	map->sw_data->aux_data = entry->aux_data;
+	SDL_memmove(&map->cache[i], &map->cache[i+1],
+	            (SDL_BLITMAP_CACHE-1 - i) * sizeof(*entry));
+	SDL_memset(&map->cache[SDL_BLITMAP_CACHE-1], 0, sizeof(*entry));
+	return(1);
+}
+
+/* Called when the source surface changes, drops all mappings */
 void SDL_InvalidateMap(SDL_BlitMap *map)
 {
+	int i;
+
 	if ( ! map ) {
 		return;
 	}
-	map->dst = NULL;
-	map->format_version = (unsigned int)-1;
-	if ( map->table ) {
-		SDL_free(map->table);
-		map->table = NULL;
+	SDL_ClearMap(map, 0);
+	for ( i = 0; i < SDL_BLITMAP_CACHE; ++i ) {
+		SDL_FreeMapTable(map->cache[i].table, map->cache[i].palmap);
 	}
+	SDL_memset(map->cache, 0, sizeof(map->cache));
 }
 int SDL_MapSurface (SDL_Surface *src, SDL_Surface *dst)
 {
@@ -550,7 +860,17 @@ int SDL_MapSurface (SDL_Surface *src, SDL_Surface *dst)
 	if ( (src->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
 		SDL_UnRLESurface(src, 1);
 	}
-	SDL_InvalidateMap(map);
+	SDL_ClearMap(map, 1);
+
+	/* Reuse the mapping to a similar destination if there was one,
+	   RLE capable surfaces still need encoding for the new one */
+	SDL_SetMapKey(&map->key, src, dst);
+	if ( !(src->flags & SDL_RLEACCELOK) && SDL_FindMap(map, &map->key) ) {
+		map->dst = dst;
+		map->format_version = dst->format_version;
+		SDL_CalculateHWBlit(src);
+		return(0);
+	}
 
 	/* Figure out what kind of mapping we're doing */
 	map->identity = 0;
@@ -580,7 +900,7 @@ int SDL_MapSurface (SDL_Surface *src, SDL_Surface *dst)
 
 		    default:
 			/* Palette --> BitField */
-			map->table = Map1toN(srcfmt, dstfmt);
+			map->table = Map1toN(srcfmt, dstfmt, &map->palmap);
 			if ( map->table == NULL ) {
 				return(-1);
 			}
@@ -38,6 +38,7 @@ extern SDL_BlitMap *SDL_AllocBlitMap(void);
 extern void SDL_InvalidateMap(SDL_BlitMap *map);
 extern int SDL_MapSurface (SDL_Surface *src, SDL_Surface *dst);
 extern void SDL_FreeBlitMap(SDL_BlitMap *map);
+extern void SDL_FreePaletteMaps(void);
 
 /* Miscellaneous functions */
 extern Uint16 SDL_CalculatePitch(SDL_Surface *surface);
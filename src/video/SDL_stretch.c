@@ -194,7 +194,456 @@ void copy_row3(Uint8 *src, int src_w, Uint8 *dst, int dst_w)
 	}
 }
 
+/* Stretching with filtering and format conversion.
+
+   The sampled part of the source is converted to ARGB8888 with the
+   normal blitters, scaled with 16.16 fixed point step tables, then
+   written straight to ARGB8888 / XRGB8888 destinations or blitted to
+   the others a few rows at a time.  Bilinear filtering is done as a
+   vertical pass over source rows followed by a horizontal one, both
+   with 7 bit weights so that the SIMD row kernels give exactly the
+   same results as the C ones.
+*/
+
+#define STRETCH_STRIP	16	/* rows per blit to the destination */
+
+#define STRETCH_BLEND(a, b, w)	(((a) * (128 - (w)) + (b) * (w) + 64) >> 7)
+
+/* Where a destination pixel samples from: source pixel x, and when
+   filtering, the weight (0-127, in every byte) of pixel x + 1 */
+typedef struct {
+	Uint32 x;
+	Uint32 w;
+} SDL_StretchStep;
+
+static void SDL_StretchSteps(SDL_StretchStep *steps, int src_len, int dst_len,
+                             int first, int count, int filter)
+{
+	Uint32 inc, pos, p, w;
+	int i;
+
+	/* sample at pixel centers */
+	inc = ((Uint32)src_len << 16) / dst_len;
+	pos = inc / 2 + first * inc;
+	for ( i = 0; i < count; ++i, pos += inc ) {
+		p = pos;
+		w = 0;
+		if ( filter == SDL_STRETCH_BILINEAR ) {
+			p = (p < 0x8000) ? 0 : p - 0x8000;
+			w = (p >> 9) & 0x7f;
+		}
+		steps[i].x = p >> 16;
+		if ( (int)steps[i].x >= src_len - 1 ) {
+			steps[i].x = src_len - 1;
+			w = 0;
+		}
+		steps[i].w = w * 0x01010101;
+	}
+}
+
+static __inline__ Uint32 SDL_StretchBlend(Uint32 a, Uint32 b, int w)
+{
+	return (Uint32)STRETCH_BLEND(a & 0xff, b & 0xff, w) |
+	       (Uint32)STRETCH_BLEND((a >> 8) & 0xff, (b >> 8) & 0xff, w) << 8 |
+	       (Uint32)STRETCH_BLEND((a >> 16) & 0xff, (b >> 16) & 0xff, w) << 16 |
+	       (Uint32)STRETCH_BLEND(a >> 24, b >> 24, w) << 24;
+}
+
+static void SDL_StretchVBlendC(Uint32 *dst, const Uint32 *a, const Uint32 *b,
+                               int count, int w)
+{
+	int i;
+
+	for ( i = 0; i < count; ++i ) {
+		dst[i] = SDL_StretchBlend(a[i], b[i], w);
+	}
+}
+
+static void SDL_StretchHBlendC(Uint32 *dst, const Uint32 *src,
+                               const SDL_StretchStep *steps, int count)
+{
+	const Uint32 *p;
+	int i;
+
+	for ( i = 0; i < count; ++i ) {
+		p = src + steps[i].x;
+		dst[i] = SDL_StretchBlend(p[0], p[1], steps[i].w & 0xff);
+	}
+}
+
+static void SDL_StretchHNearest(Uint32 *dst, const Uint32 *src,
+                                const SDL_StretchStep *steps, int count)
+{
+	int i;
+
+	for ( i = 0; i < count; ++i ) {
+		dst[i] = src[steps[i].x];
+	}
+}
+
+#if defined(__ARM_NEON__)
+extern void neon_stretch_vblend(Uint32 *dst, const Uint32 *a, const Uint32 *b,
+                                int count, int w);
+extern void neon_stretch_hblend(Uint32 *dst, const Uint32 *src,
+                                const SDL_StretchStep *steps, int count);
+
+#define STRETCH_VBLEND_SIMD(d, a, b, n, w) \
+	neon_stretch_vblend(d, a, b, n, w)
+#define STRETCH_HBLEND_SIMD(d, s, steps, n) \
+	neon_stretch_hblend(d, s, steps, n)
+#define STRETCH_VBLEND_ALIGN	8
+#define STRETCH_HBLEND_ALIGN	4
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+/* blends 16 bit channels of a and b */
+static __inline__ __m128i SDL_StretchBlendSSE2(__m128i a, __m128i b,
+                                               __m128i wa, __m128i wb)
+{
+	a = _mm_add_epi16(_mm_mullo_epi16(a, wa), _mm_mullo_epi16(b, wb));
+	return _mm_srli_epi16(_mm_add_epi16(a, _mm_set1_epi16(64)), 7);
+}
+
+static void SDL_StretchVBlendSSE2(Uint32 *dst, const Uint32 *a,
+                                  const Uint32 *b, int count, int w)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i wa = _mm_set1_epi16(128 - w);
+	const __m128i wb = _mm_set1_epi16(w);
+	__m128i va, vb, lo, hi;
+	int i;
+
+	for ( i = 0; i < count; i += 4 ) {
+		va = _mm_loadu_si128((const __m128i *)(a + i));
+		vb = _mm_loadu_si128((const __m128i *)(b + i));
+		lo = SDL_StretchBlendSSE2(_mm_unpacklo_epi8(va, zero),
+		                          _mm_unpacklo_epi8(vb, zero), wa, wb);
+		hi = SDL_StretchBlendSSE2(_mm_unpackhi_epi8(va, zero),
+		                          _mm_unpackhi_epi8(vb, zero), wa, wb);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+}
+
+/* two destination pixels as 16 bit channels */
+static __inline__ __m128i SDL_StretchHPairSSE2(const Uint32 *src,
+                                               const SDL_StretchStep *steps)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i p, wb;
+	int w0 = steps[0].w & 0xff, w1 = steps[1].w & 0xff;
+
+	/* x pixels in the low half, x + 1 ones in the high */
+	p = _mm_unpacklo_epi32(
+		_mm_loadl_epi64((const __m128i *)(src + steps[0].x)),
+		_mm_loadl_epi64((const __m128i *)(src + steps[1].x)));
+	wb = _mm_set_epi16(w1, w1, w1, w1, w0, w0, w0, w0);
+	return SDL_StretchBlendSSE2(_mm_unpacklo_epi8(p, zero),
+	                            _mm_unpackhi_epi8(p, zero),
+	                            _mm_sub_epi16(_mm_set1_epi16(128), wb), wb);
+}
+
+static void SDL_StretchHBlendSSE2(Uint32 *dst, const Uint32 *src,
+                                  const SDL_StretchStep *steps, int count)
+{
+	__m128i lo, hi;
+	int i;
+
+	for ( i = 0; i < count; i += 4 ) {
+		lo = SDL_StretchHPairSSE2(src, steps + i);
+		hi = SDL_StretchHPairSSE2(src, steps + i + 2);
+		_mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(lo, hi));
+	}
+}
+
+#define STRETCH_VBLEND_SIMD(d, a, b, n, w) \
+	SDL_StretchVBlendSSE2(d, a, b, n, w)
+#define STRETCH_HBLEND_SIMD(d, s, steps, n) \
+	SDL_StretchHBlendSSE2(d, s, steps, n)
+#define STRETCH_VBLEND_ALIGN	4
+#define STRETCH_HBLEND_ALIGN	4
+#endif
+
+/* The SIMD kernels do whole groups, C does the rest */
+static void SDL_StretchVBlend(Uint32 *dst, const Uint32 *a, const Uint32 *b,
+                              int count, int w)
+{
+	int n = 0;
+
+#ifdef STRETCH_VBLEND_SIMD
+	n = count & ~(STRETCH_VBLEND_ALIGN-1);
+	if ( n > 0 ) {
+		STRETCH_VBLEND_SIMD(dst, a, b, n, w);
+	}
+#endif
+	SDL_StretchVBlendC(dst + n, a + n, b + n, count - n, w);
+}
+
+static void SDL_StretchHBlend(Uint32 *dst, const Uint32 *src,
+                              const SDL_StretchStep *steps, int count)
+{
+	int n = 0;
+
+#ifdef STRETCH_HBLEND_SIMD
+	n = count & ~(STRETCH_HBLEND_ALIGN-1);
+	if ( n > 0 ) {
+		STRETCH_HBLEND_SIMD(dst, src, steps, n);
+	}
+#endif
+	SDL_StretchHBlendC(dst + n, src, steps + n, count - n);
+}
+
+static Uint32 SDL_StretchGetPixel(SDL_PixelFormat *fmt, Uint8 *row, int x)
+{
+	Uint32 pixel;
+	int bits = fmt->BitsPerPixel;
+
+	if ( bits < 8 ) {
+		x *= bits;
+		return (row[x >> 3] >> (8 - bits - (x & 7))) & ((1 << bits) - 1);
+	}
+	if ( bits == 8 ) {
+		return row[x];
+	}
+	RETRIEVE_RGB_PIXEL(row + x * fmt->BytesPerPixel, fmt->BytesPerPixel, pixel);
+	return pixel;
+}
+
+/* Stretch srcrect to dstrect, writing only the cliprect part of it.
+   The rects must be non-empty and within the surfaces.  With 'blend'
+   the source colorkey and alpha are honored, otherwise it's a copy.
+*/
+static int SDL_StretchFiltered(SDL_Surface *src, SDL_Rect *srcrect,
+                               SDL_Surface *dst, SDL_Rect *dstrect,
+                               SDL_Rect *cliprect, int filter, int blend)
+{
+	SDL_PixelFormat *sfmt = src->format;
+	SDL_PixelFormat *dfmt = dst->format;
+	SDL_Surface *view = NULL, *conv = NULL, *strip = NULL;
+	SDL_StretchStep *xsteps, *ysteps;
+	SDL_Rect sr, dr;
+	Uint32 *buf = NULL, *vrow, *out, *rows;
+	Uint32 last_y = ~0;
+	const Uint32 *row;
+	int cw, ch, sx, sy, tw, th, pitch, extra;
+	int abits, keyed, direct, x, y, n, w, last_w = -1;
+	int retval = -1;
+
+	cw = cliprect->w;
+	ch = cliprect->h;
+	xsteps = (SDL_StretchStep *)SDL_malloc((cw + ch) * sizeof(*xsteps));
+	if ( xsteps == NULL ) {
+		SDL_OutOfMemory();
+		return(-1);
+	}
+	ysteps = xsteps + cw;
+	SDL_StretchSteps(xsteps, srcrect->w, dstrect->w,
+	                 cliprect->x - dstrect->x, cw, filter);
+	SDL_StretchSteps(ysteps, srcrect->h, dstrect->h,
+	                 cliprect->y - dstrect->y, ch, filter);
+
+	/* Only the source pixels that get sampled are converted */
+	extra = (filter == SDL_STRETCH_BILINEAR) ? 2 : 1;
+	sx = xsteps[0].x;
+	sy = ysteps[0].x;
+	tw = SDL_min((int)xsteps[cw-1].x + extra, srcrect->w) - sx;
+	th = SDL_min((int)ysteps[ch-1].x + extra, srcrect->h) - sy;
+	for ( x = 0; x < cw; ++x ) {
+		xsteps[x].x -= sx;
+	}
+	for ( y = 0; y < ch; ++y ) {
+		ysteps[y].x -= sy;
+	}
+
+	/* ARGB8888 and XRGB8888 destinations are written directly */
+	direct = !blend && dfmt->BytesPerPixel == 4 &&
+	         dfmt->Rmask == 0x00FF0000 && dfmt->Gmask == 0x0000FF00 &&
+	         dfmt->Bmask == 0x000000FF &&
+	         (dfmt->Amask == 0xFF000000 || dfmt->Amask == 0);
+
+	/* converted pixels, with an extra column so that the bilinear
+	   kernels can always read pixel x + 1, then a blended row and
+	   the strip for the destination blits */
+	pitch = tw + 1;
+	buf = (Uint32 *)SDL_malloc((pitch * (th + 1) +
+	                            cw * STRETCH_STRIP) * sizeof(Uint32));
+	if ( buf == NULL ) {
+		SDL_OutOfMemory();
+		goto done;
+	}
+	vrow = buf + pitch * th;
+	rows = vrow + pitch;
+
+	if ( SDL_LockSurface(src) < 0 ) {
+		goto done;
+	}
+	view = SDL_CreateRGBSurfaceFrom(src->pixels, src->w, src->h,
+	                                sfmt->BitsPerPixel, src->pitch,
+	                                sfmt->Rmask, sfmt->Gmask,
+	                                sfmt->Bmask, sfmt->Amask);
+	conv = SDL_CreateRGBSurfaceFrom(buf, tw, th, 32, pitch * 4,
+	                                0x00FF0000, 0x0000FF00,
+	                                0x000000FF, 0xFF000000);
+	if ( view == NULL || conv == NULL ) {
+		SDL_UnlockSurface(src);
+		goto done;
+	}
+	if ( sfmt->palette ) {
+		SDL_SetColors(view, sfmt->palette->colors, 0,
+		              sfmt->palette->ncolors);
+	}
+	SDL_SetAlpha(view, 0, SDL_ALPHA_OPAQUE);
+	sr.x = srcrect->x + sx;
+	sr.y = srcrect->y + sy;
+	sr.w = tw;
+	sr.h = th;
+	dr = sr;
+	dr.x = 0;
+	dr.y = 0;
+	if ( SDL_LowerBlit(view, &sr, conv, &dr) < 0 ) {
+		SDL_UnlockSurface(src);
+		goto done;
+	}
+
+	/* Fix up alpha the way a blit would use it, keyed pixels become
+	   transparent, then fill the extra column */
+	abits = -1;
+	/* like SDL_CalculateBlit(), per pixel alpha overrides the key */
+	keyed = blend && (src->flags & SDL_SRCCOLORKEY) &&
+	        !(sfmt->Amask && (src->flags & SDL_SRCALPHA));
+	if ( blend ) {
+		if ( !(src->flags & SDL_SRCALPHA) ) {
+			abits = SDL_ALPHA_OPAQUE;
+		} else if ( !sfmt->Amask ) {
+			abits = sfmt->alpha;
+		}
+	} else if ( direct && !dfmt->Amask ) {
+		abits = 0;
+	} else if ( !sfmt->Amask ) {
+		abits = SDL_ALPHA_OPAQUE;
+	}
+	for ( y = 0; y < th; ++y ) {
+		out = buf + y * pitch;
+		if ( abits >= 0 ) {
+			for ( x = 0; x < tw; ++x ) {
+				out[x] = (out[x] & 0x00FFFFFF) | ((Uint32)abits << 24);
+			}
+		}
+		if ( keyed ) {
+			Uint8 *srow = (Uint8 *)src->pixels +
+			              (sr.y + y) * src->pitch;
+			Uint32 rgbmask = ~sfmt->Amask;
+			Uint32 key = sfmt->colorkey & rgbmask;
+
+			for ( x = 0; x < tw; ++x ) {
+				Uint32 pixel = SDL_StretchGetPixel(sfmt, srow, sr.x + x);
+				if ( (pixel & rgbmask) == key ) {
+					out[x] = 0;
+				}
+			}
+		}
+		out[tw] = out[tw-1];
+	}
+	SDL_UnlockSurface(src);
+
+	if ( direct ) {
+		if ( SDL_LockSurface(dst) < 0 ) {
+			goto done;
+		}
+	} else {
+		strip = SDL_CreateRGBSurfaceFrom(rows, cw, STRETCH_STRIP, 32, cw * 4,
+		                                 0x00FF0000, 0x0000FF00,
+		                                 0x000000FF, 0xFF000000);
+		if ( strip == NULL ) {
+			goto done;
+		}
+		SDL_SetAlpha(strip, blend ? SDL_SRCALPHA : 0, SDL_ALPHA_OPAQUE);
+		if ( blend && sfmt->Amask ) {
+			/* filtering premultiplied colors is fine as is */
+			strip->flags |= (src->flags & SDL_PREMULALPHA);
+		}
+	}
+
+	retval = 0;
+	for ( y = 0, n = 0; y < ch; ++y ) {
+		row = buf + ysteps[y].x * pitch;
+		w = ysteps[y].w & 0xff;
+		if ( w ) {
+			/* upscaling blends the same rows many times */
+			if ( ysteps[y].x != last_y || w != last_w ) {
+				SDL_StretchVBlend(vrow, row, row + pitch, pitch, w);
+				last_y = ysteps[y].x;
+				last_w = w;
+			}
+			row = vrow;
+		}
+
+		if ( direct ) {
+			out = (Uint32 *)((Uint8 *)dst->pixels +
+			                 (cliprect->y + y) * dst->pitch) + cliprect->x;
+		} else {
+			out = rows + n * cw;
+		}
+		if ( filter == SDL_STRETCH_BILINEAR ) {
+			SDL_StretchHBlend(out, row, xsteps, cw);
+		} else {
+			SDL_StretchHNearest(out, row, xsteps, cw);
+		}
+
+		if ( !direct && (++n == STRETCH_STRIP || y == ch - 1) ) {
+			sr.x = 0;
+			sr.y = 0;
+			sr.w = cw;
+			sr.h = n;
+			dr.x = cliprect->x;
+			dr.y = cliprect->y + y + 1 - n;
+			dr.w = cw;
+			dr.h = n;
+			if ( SDL_LowerBlit(strip, &sr, dst, &dr) < 0 ) {
+				retval = -1;
+				break;
+			}
+			n = 0;
+		}
+	}
+	if ( direct ) {
+		SDL_UnlockSurface(dst);
+	}
+
+done:
+	if ( strip ) {
+		SDL_FreeSurface(strip);
+	}
+	if ( conv ) {
+		SDL_FreeSurface(conv);
+	}
+	if ( view ) {
+		SDL_FreeSurface(view);
+	}
+	SDL_free(buf);
+	SDL_free(xsteps);
+	return(retval);
+}
+
+/* Whether pixels can be copied from one format to the other as is */
+static int SDL_StretchSameFormat(SDL_PixelFormat *a, SDL_PixelFormat *b)
+{
+	if ( a->BitsPerPixel != b->BitsPerPixel ) {
+		return(0);
+	}
+	if ( a->palette || b->palette ) {
+		/* same test as for an identity blit map */
+		return(a->palette && b->palette &&
+		       a->palette->ncolors <= b->palette->ncolors &&
+		       SDL_memcmp(a->palette->colors, b->palette->colors,
+		                  a->palette->ncolors*sizeof(SDL_Color)) == 0);
+	}
+	return(a->Rmask == b->Rmask && a->Gmask == b->Gmask &&
+	       a->Bmask == b->Bmask);
+}
+
 /* Perform a stretch blit between two surfaces of the same format.
+   Surfaces of different formats are converted, without blending.
    NOTE:  This function is not safe to call from multiple threads!
 */
 int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
@@ -218,11 +667,6 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 #endif /* USE_ASM_STRETCH */
 	const int bpp = dst->format->BytesPerPixel;
 
-	if ( src->format->BitsPerPixel != dst->format->BitsPerPixel ) {
-		SDL_SetError("Only works with same format surfaces");
-		return(-1);
-	}
-
 	/* Verify the blit rectangles */
 	if ( srcrect ) {
 		if ( (srcrect->x < 0) || (srcrect->y < 0) ||
@@ -253,6 +697,16 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 		dstrect = &full_dst;
 	}
 
+	/* Different formats go through the converting stretcher */
+	if ( !SDL_StretchSameFormat(src->format, dst->format) ) {
+		if ( (srcrect->w == 0) || (srcrect->h == 0) ||
+		     (dstrect->w == 0) || (dstrect->h == 0) ) {
+			return(0);
+		}
+		return(SDL_StretchFiltered(src, srcrect, dst, dstrect, dstrect,
+		                           SDL_STRETCH_NEAREST, 0));
+	}
+
 	/* Lock the destination if it's in hardware */
 	dst_locked = 0;
 	if ( SDL_MUSTLOCK(dst) ) {
@@ -356,3 +810,78 @@ int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
 	return(0);
 }
 
+
+int SDL_StretchBlit(SDL_Surface *src, SDL_Rect *srcrect,
+                    SDL_Surface *dst, SDL_Rect *dstrect, int filter)
+{
+	SDL_Rect full_src;
+	SDL_Rect full_dst;
+	SDL_Rect clip;
+	int x0, y0, x1, y1;
+	int blend;
+	int retval = 0;
+
+	if ( ! src || ! dst ) {
+		SDL_SetError("SDL_StretchBlit: passed a NULL surface");
+		return(-1);
+	}
+	if ( src->locked || dst->locked ) {
+		SDL_SetError("Surfaces must not be locked during blit");
+		return(-1);
+	}
+	if ( (filter != SDL_STRETCH_NEAREST) &&
+	     (filter != SDL_STRETCH_BILINEAR) ) {
+		SDL_SetError("Unknown stretch filter");
+		return(-1);
+	}
+
+	if ( srcrect ) {
+		if ( (srcrect->x < 0) || (srcrect->y < 0) ||
+		     ((srcrect->x+srcrect->w) > src->w) ||
+		     ((srcrect->y+srcrect->h) > src->h) ) {
+			SDL_SetError("Invalid source blit rectangle");
+			return(-1);
+		}
+		full_src = *srcrect;
+	} else {
+		full_src.x = 0;
+		full_src.y = 0;
+		full_src.w = src->w;
+		full_src.h = src->h;
+	}
+	if ( dstrect ) {
+		full_dst = *dstrect;
+	} else {
+		full_dst.x = 0;
+		full_dst.y = 0;
+		full_dst.w = dst->w;
+		full_dst.h = dst->h;
+	}
+
+	/* clip the destination rectangle against the clip rectangle */
+	x0 = SDL_max(full_dst.x, dst->clip_rect.x);
+	y0 = SDL_max(full_dst.y, dst->clip_rect.y);
+	x1 = SDL_min(full_dst.x + full_dst.w,
+	             dst->clip_rect.x + dst->clip_rect.w);
+	y1 = SDL_min(full_dst.y + full_dst.h,
+	             dst->clip_rect.y + dst->clip_rect.h);
+	if ( (full_src.w == 0) || (full_src.h == 0) ) {
+		x1 = x0;
+	}
+	clip.x = x0;
+	clip.y = y0;
+	clip.w = (x1 > x0) ? x1 - x0 : 0;
+	clip.h = (y1 > y0) ? y1 - y0 : 0;
+
+	if ( clip.w && clip.h ) {
+		blend = (src->flags & (SDL_SRCALPHA|SDL_SRCCOLORKEY)) != 0;
+		retval = SDL_StretchFiltered(src, &full_src, dst, &full_dst,
+		                             &clip, filter, blend);
+	} else {
+		clip.w = clip.h = 0;
+	}
+	if ( dstrect ) {
+		*dstrect = clip;
+	}
+	return(retval);
+}
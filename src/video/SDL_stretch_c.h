@@ -22,6 +22,7 @@
 #include "SDL_config.h"
 
 /* Perform a stretch blit between two surfaces of the same format.
+   Surfaces of different formats are converted, without blending.
    NOTE:  This function is not safe to call from multiple threads!
 */
 extern int SDL_SoftStretch(SDL_Surface *src, SDL_Rect *srcrect,
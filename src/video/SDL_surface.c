@@ -106,6 +106,7 @@ SDL_Surface * SDL_CreateRGBSurface (Uint32 flags,
 	}
 	if ( Amask ) {
 		surface->flags |= SDL_SRCALPHA;
+		surface->flags |= (flags & SDL_PREMULALPHA);
 	}
 	surface->w = width;
 	surface->h = height;
@@ -533,73 +534,122 @@ int SDL_UpperBlit (SDL_Surface *src, SDL_Rect *srcrect,
 	return 0;
 }
 
-static int SDL_FillRect1(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+/* Sub-byte pixels are packed MSB first, like the 1bpp and 4bpp blitters
+ * expect; 'pattern' is the color repeated over a whole byte */
+static void SDL_FillBits(Uint8 *row, int pitch, int bitx, int bitw, int h,
+			 Uint8 pattern)
 {
-	/* FIXME: We have to worry about packing order.. *sigh* */
-	SDL_SetError("1-bpp rect fill not yet implemented");
-	return -1;
+	int first = bitx >> 3;
+	int last = (bitx + bitw - 1) >> 3;
+	Uint8 lmask = 0xff >> (bitx & 7);
+	Uint8 rmask = 0xff << (7 - ((bitx + bitw - 1) & 7));
+
+	if ( bitw <= 0 || h <= 0 ) {
+		return;
+	}
+	if ( first == last ) {
+		lmask &= rmask;
+	}
+	for ( ; h; --h, row += pitch ) {
+		row[first] = (row[first] & ~lmask) | (pattern & lmask);
+		if ( first != last ) {
+			SDL_memset(row + first + 1, pattern, last - first - 1);
+			row[last] = (row[last] & ~rmask) | (pattern & rmask);
+		}
+	}
 }
 
-static int SDL_FillRect4(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+static void SDL_FillRect1(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 {
-	/* FIXME: We have to worry about packing order.. *sigh* */
-	SDL_SetError("4-bpp rect fill not yet implemented");
-	return -1;
+	Uint8 *row = (Uint8 *)dst->pixels + dstrect->y*dst->pitch;
+
+	SDL_FillBits(row, dst->pitch, dstrect->x, dstrect->w, dstrect->h,
+		     (color & 1) ? 0xff : 0x00);
 }
 
-/* 
- * This function performs a fast fill of the given rectangle with 'color'
- */
-int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+static void SDL_FillRect4(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 {
-	SDL_VideoDevice *video = current_video;
-	SDL_VideoDevice *this  = current_video;
-	int x, y;
-	Uint8 *row;
+	Uint8 *row = (Uint8 *)dst->pixels + dstrect->y*dst->pitch;
 
-	/* This function doesn't work on surfaces < 8 bpp */
-	if ( dst->format->BitsPerPixel < 8 ) {
-		switch(dst->format->BitsPerPixel) {
-		    case 1:
-			return SDL_FillRect1(dst, dstrect, color);
-			break;
-		    case 4:
-			return SDL_FillRect4(dst, dstrect, color);
-			break;
-		    default:
-			SDL_SetError("Fill rect on unsupported surface format");
-			return(-1);
-			break;
-		}
-	}
+	SDL_FillBits(row, dst->pitch, dstrect->x*4, dstrect->w*4, dstrect->h,
+		     (color & 0x0f) * 0x11);
+}
 
-	/* If 'dstrect' == NULL, then fill the whole surface */
-	if ( dstrect ) {
-		/* Perform clipping */
-		if ( !SDL_IntersectRect(dstrect, &dst->clip_rect, dstrect) ) {
-			return(0);
+#ifdef __ARM_NEON__
+extern void neon_fill_aligned(void *dst, Uint32 pattern, int bytes);
+
+/* 16 byte aligned middle goes to NEON, rows that continue into each
+ * other (rect as wide as the pitch) are done as one span */
+static void SDL_FillRectNEON(Uint8 *row, int pitch, int w_bytes, int h,
+			     int bpp, Uint32 pattern)
+{
+	Uint8 *p;
+	int n, body;
+
+	if ( w_bytes == pitch ) {
+		w_bytes *= h;
+		h = 1;
+	}
+	for ( ; h; --h, row += pitch ) {
+		p = row;
+		n = w_bytes;
+		if ( n >= 64 ) {
+			for ( ; (uintptr_t)p & 15; p += bpp, n -= bpp ) {
+				if ( bpp == 4 )
+					*(Uint32 *)p = pattern;
+				else if ( bpp == 2 )
+					*(Uint16 *)p = (Uint16)pattern;
+				else
+					*p = (Uint8)pattern;
+			}
+			body = n & ~15;
+			neon_fill_aligned(p, pattern, body);
+			p += body;
+			n -= body;
+		}
+		for ( ; n > 0; p += bpp, n -= bpp ) {
+			if ( bpp == 4 )
+				*(Uint32 *)p = pattern;
+			else if ( bpp == 2 )
+				*(Uint16 *)p = (Uint16)pattern;
+			else
+				*p = (Uint8)pattern;
 		}
-	} else {
-		dstrect = &dst->clip_rect;
 	}
+}
+#endif /* __ARM_NEON__ */
 
-	/* Check for hardware acceleration */
-	if ( ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
-					video->info.blit_fill ) {
-		SDL_Rect hw_rect;
-		if ( dst == SDL_VideoSurface ) {
-			hw_rect = *dstrect;
-			hw_rect.x += current_video->offset_x;
-			hw_rect.y += current_video->offset_y;
-			dstrect = &hw_rect;
-		}
-		return(video->FillHWRect(this, dst, dstrect, color));
+/* Software fill of an already clipped rectangle, surface locked */
+static void SDL_FillRectSW(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+{
+	int x, y;
+	Uint8 *row;
+
+	switch (dst->format->BitsPerPixel) {
+	    case 1:
+		SDL_FillRect1(dst, dstrect, color);
+		return;
+	    case 4:
+		SDL_FillRect4(dst, dstrect, color);
+		return;
 	}
 
-	/* Perform software fill */
-	if ( SDL_LockSurface(dst) != 0 ) {
-		return(-1);
+#ifdef __ARM_NEON__
+	row = (Uint8 *)dst->pixels+dstrect->y*dst->pitch+
+			dstrect->x*dst->format->BytesPerPixel;
+	x = dst->format->BytesPerPixel;
+	if ( x != 3 && !(((uintptr_t)row | dst->pitch) & (x - 1)) ) {
+		Uint32 pattern = color;
+		if ( x == 1 )
+			pattern = (color & 0xff) * 0x01010101;
+		else if ( x == 2 )
+			pattern = (color & 0xffff) * 0x00010001;
+		SDL_FillRectNEON(row, dst->pitch, dstrect->w*x, dstrect->h,
+				 x, pattern);
+		return;
 	}
+#endif
+
 	row = (Uint8 *)dst->pixels+dstrect->y*dst->pitch+
 			dstrect->x*dst->format->BytesPerPixel;
 	if ( dst->format->palette || (color == 0) ) {
@@ -724,12 +774,144 @@ int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
 			break;
 		}
 	}
+}
+
+static int SDL_FillRectCheck(SDL_Surface *dst)
+{
+	switch (dst->format->BitsPerPixel) {
+	    case 1:
+	    case 4:
+		return(0);
+	}
+	/* Other formats below 8 bpp are not handled */
+	if ( dst->format->BitsPerPixel < 8 ) {
+		SDL_SetError("Fill rect on unsupported surface format");
+		return(-1);
+	}
+	return(0);
+}
+
+/* Big fills are split into bands of rows, see SDL_blit_threads.c */
+typedef struct {
+	SDL_Surface *dst;
+	SDL_Rect *rect;
+	Uint32 color;
+} SDL_FillBandJob;
+
+static void SDL_FillRectBand(void *arg, int band, int bands)
+{
+	SDL_FillBandJob *job = (SDL_FillBandJob *)arg;
+	SDL_Rect rect = *job->rect;
+	int y0 = job->rect->h * band / bands;
+	int y1 = job->rect->h * (band + 1) / bands;
+
+	rect.y += y0;
+	rect.h = y1 - y0;
+	SDL_FillRectSW(job->dst, &rect, job->color);
+}
+
+static void SDL_FillRectBands(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+{
+	SDL_FillBandJob job;
+	int bands;
+
+	bands = SDL_BlitBands(dstrect->h,
+	          dstrect->h * (dstrect->w * dst->format->BitsPerPixel / 8));
+	if ( bands > 1 ) {
+		job.dst = dst;
+		job.rect = dstrect;
+		job.color = color;
+		SDL_RunBlitBands(SDL_FillRectBand, &job, bands);
+	} else {
+		SDL_FillRectSW(dst, dstrect, color);
+	}
+}
+
+/* 
+ * This function performs a fast fill of the given rectangle with 'color'
+ */
+int SDL_FillRect(SDL_Surface *dst, SDL_Rect *dstrect, Uint32 color)
+{
+	SDL_VideoDevice *video = current_video;
+	SDL_VideoDevice *this  = current_video;
+
+	if ( SDL_FillRectCheck(dst) < 0 ) {
+		return(-1);
+	}
+
+	/* If 'dstrect' == NULL, then fill the whole surface */
+	if ( dstrect ) {
+		/* Perform clipping */
+		if ( !SDL_IntersectRect(dstrect, &dst->clip_rect, dstrect) ) {
+			return(0);
+		}
+	} else {
+		dstrect = &dst->clip_rect;
+		if ( dstrect->w == 0 || dstrect->h == 0 ) {
+			return(0);
+		}
+	}
+
+	/* Check for hardware acceleration */
+	if ( ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
+					video->info.blit_fill ) {
+		SDL_Rect hw_rect;
+		if ( dst == SDL_VideoSurface ) {
+			hw_rect = *dstrect;
+			hw_rect.x += current_video->offset_x;
+			hw_rect.y += current_video->offset_y;
+			dstrect = &hw_rect;
+		}
+		return(video->FillHWRect(this, dst, dstrect, color));
+	}
+
+	/* Perform software fill */
+	if ( SDL_LockSurface(dst) != 0 ) {
+		return(-1);
+	}
+	SDL_FillRectBands(dst, dstrect, color);
 	SDL_UnlockSurface(dst);
 
 	/* We're done! */
 	return(0);
 }
 
+/*
+ * Fills a list of rectangles, locking the surface only once
+ */
+int SDL_FillRects(SDL_Surface *dst, SDL_Rect *rects, int count, Uint32 color)
+{
+	int i;
+
+	if ( SDL_FillRectCheck(dst) < 0 ) {
+		return(-1);
+	}
+
+	/* Hardware fills go one by one anyway */
+	if ( ((dst->flags & SDL_HWSURFACE) == SDL_HWSURFACE) &&
+					current_video->info.blit_fill ) {
+		for ( i = 0; i < count; ++i ) {
+			if ( SDL_FillRect(dst, &rects[i], color) < 0 ) {
+				return(-1);
+			}
+		}
+		return(0);
+	}
+
+	if ( SDL_LockSurface(dst) != 0 ) {
+		return(-1);
+	}
+	for ( i = 0; i < count; ++i ) {
+		if ( !SDL_IntersectRect(&rects[i], &dst->clip_rect, &rects[i]) ) {
+			continue;
+		}
+		SDL_FillRectBands(dst, &rects[i], color);
+	}
+	SDL_UnlockSurface(dst);
+
+	return(0);
+}
+
 /*
  * Lock a surface to directly access the pixels
  */
@@ -750,6 +932,10 @@ int SDL_LockSurface (SDL_Surface *surface)
 		}
 		/* This needs to be done here in case pixels changes value */
 		surface->pixels = (Uint8 *)surface->pixels + surface->offset;
+	} else if ( surface->map->sw_data->rle_readonly ) {
+		/* Locked read-only before, the RLE data won't stay valid */
+		SDL_UnRLESurface(surface, 1);
+		surface->flags |= SDL_RLEACCEL;	/* save accel'd state */
 	}
 
 	/* Increment the surface lock count, for recursive locks */
@@ -758,6 +944,28 @@ int SDL_LockSurface (SDL_Surface *surface)
 	/* Ready to go.. */
 	return(0);
 }
+/*
+ * Lock a surface for reading the pixels only, RLE encoded surfaces
+ * keep their encoding
+ */
+int SDL_LockSurfaceReadOnly (SDL_Surface *surface)
+{
+	if ( !(surface->flags & SDL_RLEACCEL) ||
+	     (surface->flags & (SDL_HWSURFACE|SDL_ASYNCBLIT)) ) {
+		return(SDL_LockSurface(surface));
+	}
+	if ( ! surface->locked ) {
+		if ( SDL_RLELockReadOnly(surface) < 0 ) {
+			return(-1);
+		}
+		surface->pixels = (Uint8 *)surface->pixels + surface->offset;
+	}
+
+	/* Increment the surface lock count, for recursive locks */
+	++surface->locked;
+
+	return(0);
+}
 /*
  * Unlock a previously locked surface
  */
@@ -779,10 +987,52 @@ void SDL_UnlockSurface (SDL_Surface *surface)
 	} else {
 		/* Update RLE encoded surface with new data */
 		if ( (surface->flags & SDL_RLEACCEL) == SDL_RLEACCEL ) {
-		        surface->flags &= ~SDL_RLEACCEL; /* stop lying */
-			SDL_RLESurface(surface);
+			if ( surface->map->sw_data->rle_readonly ) {
+				SDL_RLEUnlockReadOnly(surface);
+			} else {
+				surface->flags &= ~SDL_RLEACCEL; /* stop lying */
+				SDL_RLESurface(surface);
+			}
+		}
+	}
+}
+
+/*
+ * Multiply the colors of a surface with an alpha channel by alpha, or
+ * divide them by it again
+ */
+static int SDL_PremultiplySurface(SDL_Surface *surface, int premul)
+{
+	SDL_PixelFormat *fmt = surface->format;
+	int bpp = fmt->BytesPerPixel;
+	int x, y;
+
+	if ( SDL_LockSurface(surface) < 0 ) {
+		return(-1);
+	}
+	for ( y = 0; y < surface->h; ++y ) {
+		Uint8 *buf = (Uint8 *)surface->pixels + y * surface->pitch;
+		for ( x = 0; x < surface->w; ++x ) {
+			Uint32 Pixel;
+			Uint8 r, g, b, a;
+
+			RETRIEVE_RGB_PIXEL(buf, bpp, Pixel);
+			SDL_GetRGBA(Pixel, fmt, &r, &g, &b, &a);
+			if ( premul ) {
+				r = (r * a + 127) / 255;
+				g = (g * a + 127) / 255;
+				b = (b * a + 127) / 255;
+			} else if ( a ) {
+				r = SDL_min((r * 255 + a / 2) / a, 255);
+				g = SDL_min((g * 255 + a / 2) / a, 255);
+				b = SDL_min((b * 255 + a / 2) / a, 255);
+			}
+			ASSEMBLE_RGBA(buf, bpp, fmt, r, g, b, a);
+			buf += bpp;
 		}
 	}
+	SDL_UnlockSurface(surface);
+	return(0);
 }
 
 /* 
@@ -865,6 +1115,17 @@ SDL_Surface * SDL_ConvertSurface (SDL_Surface *surface,
 	bounds.h = surface->h;
 	SDL_LowerBlit(surface, &bounds, convert, &bounds);
 
+	/* Change between straight and premultiplied alpha */
+	if ( ((convert->flags ^ surface_flags) & SDL_PREMULALPHA) &&
+	     convert->format->Amask && surface->format->Amask ) {
+		if ( SDL_PremultiplySurface(convert,
+		                    convert->flags & SDL_PREMULALPHA) < 0 ) {
+			/* the source is still restored below */
+			SDL_FreeSurface(convert);
+			convert = NULL;
+		}
+	}
+
 	/* Clean up the original surface, and update converted surface */
 	if ( convert != NULL ) {
 		SDL_SetClipRect(convert, &surface->clip_rect);
@@ -141,6 +141,7 @@ SDL_VideoDevice *current_video = NULL;
 int SDL_VideoInit(const char *driver_name, Uint32 flags);
 void SDL_VideoQuit(void);
 void SDL_GL_UpdateRectsLock(SDL_VideoDevice* this, int numrects, SDL_Rect* rects);
+extern void SDL_FinishAllYUV_SW(void);
 
 static SDL_GrabMode SDL_WM_GrabInputOff(void);
 #if SDL_VIDEO_OPENGL
@@ -599,6 +600,9 @@ SDL_Surface * SDL_SetVideoMode (int width, int height, int bpp, Uint32 flags)
 	}
 	this = video = current_video;
 
+	/* Asynchronous overlay displays still write to the old screen */
+	SDL_FinishAllYUV_SW();
+
 	/* Default to the current width and height */
 	if ( width == 0 ) {
 		width = video->info.current_w;
@@ -938,6 +942,7 @@ SDL_Surface * SDL_DisplayFormat (SDL_Surface *surface)
 #else
 	flags |= surface->flags & (SDL_SRCCOLORKEY|SDL_SRCALPHA|SDL_RLEACCELOK);
 #endif
+	flags |= surface->flags & SDL_PREMULALPHA;
 	return(SDL_ConvertSurface(surface, SDL_PublicSurface->format, flags));
 }
 
@@ -945,7 +950,8 @@ SDL_Surface * SDL_DisplayFormat (SDL_Surface *surface)
  * Convert a surface into a format that's suitable for blitting to
  * the screen, but including an alpha channel.
  */
-SDL_Surface *SDL_DisplayFormatAlpha(SDL_Surface *surface)
+static SDL_Surface *SDL_DisplayFormatWithAlpha(SDL_Surface *surface,
+                                               Uint32 premul)
 {
 	SDL_PixelFormat *vf;
 	SDL_PixelFormat *format;
@@ -993,11 +999,26 @@ SDL_Surface *SDL_DisplayFormatAlpha(SDL_Surface *surface)
 	format = SDL_AllocFormat(32, rmask, gmask, bmask, amask);
 	flags = SDL_PublicSurface->flags & SDL_HWSURFACE;
 	flags |= surface->flags & (SDL_SRCALPHA | SDL_RLEACCELOK);
+	flags |= premul;
 	converted = SDL_ConvertSurface(surface, format, flags);
 	SDL_FreeFormat(format);
 	return(converted);
 }
 
+SDL_Surface *SDL_DisplayFormatAlpha(SDL_Surface *surface)
+{
+	return(SDL_DisplayFormatWithAlpha(surface,
+	                                  surface->flags & SDL_PREMULALPHA));
+}
+
+/*
+ * The same, with the colors premultiplied by alpha
+ */
+SDL_Surface *SDL_DisplayFormatPremulAlpha(SDL_Surface *surface)
+{
+	return(SDL_DisplayFormatWithAlpha(surface, SDL_PREMULALPHA));
+}
+
 /*
  * Update a specific portion of the physical screen
  */
@@ -1342,6 +1363,9 @@ void SDL_VideoQuit (void)
 		/* Halt event processing before doing anything else */
 		SDL_StopEventLoop();
 
+		/* Overlay displays may still be writing to the screen */
+		SDL_FinishAllYUV_SW();
+
 		/* Clean up allocated window manager items */
 		if ( SDL_PublicSurface ) {
 			SDL_PublicSurface = NULL;
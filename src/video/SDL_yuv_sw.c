@@ -85,9 +85,9 @@
 
 #include "SDL_video.h"
 #include "SDL_cpuinfo.h"
-#include "SDL_stretch_c.h"
 #include "SDL_yuvfuncs.h"
 #include "SDL_yuv_sw_c.h"
+#include "SDL_blit.h"
 
 /* The functions used to manipulate software video overlays */
 static struct private_yuvhwfuncs sw_yuvfuncs = {
@@ -97,9 +97,18 @@ static struct private_yuvhwfuncs sw_yuvfuncs = {
 	SDL_FreeYUV_SW
 };
 
+/* Fixed point (14 bit) YUV -> RGB coefficients of the colortab, the SIMD
+   converters (also the ones in SDL_blit_neon.S) use the same math:
+   r = y + (cr * YUV_CR_R >> 14), g = y + (cr * YUV_CR_G >> 14) +
+   (cb * YUV_CB_G >> 14), b = y + (cb * YUV_CB_B >> 14), clamped to 0..255,
+   with cr and cb in -128..127 */
+#define YUV_CR_R	22960	/*  (0.419/0.299) * 16384 */
+#define YUV_CR_G	(-11692)/* -(0.299/0.419) * 16384 */
+#define YUV_CB_G	(-5643)	/* -(0.114/0.331) * 16384 */
+#define YUV_CB_B	29056	/*  (0.587/0.331) * 16384 */
+
 /* RGB conversion lookup tables */
 struct private_yuvhwdata {
-	SDL_Surface *stretch;
 	SDL_Surface *display;
 	Uint8 *pixels;
 	int *colortab;
@@ -113,6 +122,32 @@ struct private_yuvhwdata {
                           unsigned char *cb, unsigned char *out,
                           int rows, int cols, int mod );
 
+	/* Converts one row, for scaling and the SIMD converters */
+	void (*DisplayRow)(struct private_yuvhwdata *swdata, Uint8 *out,
+	                   const Uint8 *lum, const Uint8 *cr,
+	                   const Uint8 *cb, int count);
+	int simd;		/* DisplayRow is faster than Display1X */
+	int lum_step;		/* lum bytes per pixel */
+	int chroma_step;	/* cr/cb bytes per pixel pair */
+	Uint8 *row;		/* a converted source row per band when scaling */
+	int nrows;
+	int *steps;		/* source columns and rows when scaling */
+	int nsteps;
+
+	/* The display in progress, split in bands between the blit threads */
+	struct {
+		int mode;
+		SDL_Overlay *overlay;
+		Uint8 *lum, *Cr, *Cb;
+		SDL_Rect src, dst;
+		Uint8 *dstp;
+		int pitch;
+		int mod;
+	} job;
+	int async;		/* return before the bands are done */
+	int pending;		/* the bands are still running */
+	struct private_yuvhwdata *next_pending;
+
 	/* These are just so we don't have to allocate them separately */
 	Uint16 pitches[3];
 	Uint8 *planes[3];
@@ -764,6 +799,8 @@ static void Color16DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int cb_b;
     int cols_2 = cols / 2;
 
+    mod = next_row + (mod/2);
+
     y = rows;
     while( y-- )
     {
@@ -791,7 +828,7 @@ static void Color16DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
             row++;
 
         }
-        row += next_row;
+        row += mod;
     }
 }
 
@@ -808,6 +845,8 @@ static void Color24DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
+
+    mod = next_row + (mod*3);
     y = rows;
     while( y-- )
     {
@@ -847,7 +886,7 @@ static void Color24DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
             row += 2*3;
 
         }
-        row += next_row;
+        row += mod;
     }
 }
 
@@ -863,7 +902,8 @@ static void Color32DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
     int crb_g;
     int cb_b;
     int cols_2 = cols / 2;
-    mod+=mod;
+
+    mod = next_row + mod;
     y = rows;
     while( y-- )
     {
@@ -895,9 +935,395 @@ static void Color32DitherYUY2Mod2X( int *colortab, Uint32 *rgb_2_pix,
 
         }
 
-        row += next_row;
+        row += mod;
+    }
+}
+
+/*
+ * One row of 'count' pixels for the scaling path and the edges of the SIMD
+ * converters.  lum moves by lum_step per pixel and cr/cb by chroma_step per
+ * pixel pair, so the same code does the planar and the packed formats.
+ * The results are the same as with the converters above.
+ */
+#define YUV_ROW_CHROMA()                                        \
+    cr_r   = 0*768+256 + colortab[ *cr + 0*256 ];               \
+    crb_g  = 1*768+256 + colortab[ *cr + 1*256 ]                \
+                       + colortab[ *cb + 2*256 ];               \
+    cb_b   = 2*768+256 + colortab[ *cb + 3*256 ];               \
+    cr += cstep; cb += cstep;
+
+#define YUV_ROW_PIXEL(L)                                        \
+    (rgb_2_pix[ (L) + cr_r ] |                                  \
+     rgb_2_pix[ (L) + crb_g ] |                                 \
+     rgb_2_pix[ (L) + cb_b ])
+
+static void Color16Row( struct private_yuvhwdata *swdata, Uint8 *out,
+                        const Uint8 *lum, const Uint8 *cr,
+                        const Uint8 *cb, int count )
+{
+    int *colortab = swdata->colortab;
+    Uint32 *rgb_2_pix = swdata->rgb_2_pix;
+    const int lstep = swdata->lum_step;
+    const int cstep = swdata->chroma_step;
+    unsigned short* row = (unsigned short*) out;
+    int x;
+    int cr_r;
+    int crb_g;
+    int cb_b;
+
+    for ( x = count / 2; x > 0; --x )
+    {
+        YUV_ROW_CHROMA();
+        *row++ = (unsigned short)YUV_ROW_PIXEL(lum[0]);
+        *row++ = (unsigned short)YUV_ROW_PIXEL(lum[lstep]);
+        lum += 2*lstep;
+    }
+    if ( count & 1 )
+    {
+        YUV_ROW_CHROMA();
+        *row = (unsigned short)YUV_ROW_PIXEL(lum[0]);
+    }
+}
+
+static void Color24Row( struct private_yuvhwdata *swdata, Uint8 *out,
+                        const Uint8 *lum, const Uint8 *cr,
+                        const Uint8 *cb, int count )
+{
+    int *colortab = swdata->colortab;
+    Uint32 *rgb_2_pix = swdata->rgb_2_pix;
+    const int lstep = swdata->lum_step;
+    const int cstep = swdata->chroma_step;
+    unsigned int value;
+    int x;
+    int cr_r;
+    int crb_g;
+    int cb_b;
+
+    for ( x = count / 2; x > 0; --x )
+    {
+        YUV_ROW_CHROMA();
+        value = YUV_ROW_PIXEL(lum[0]);
+        *out++ = (value      ) & 0xFF;
+        *out++ = (value >>  8) & 0xFF;
+        *out++ = (value >> 16) & 0xFF;
+        value = YUV_ROW_PIXEL(lum[lstep]);
+        *out++ = (value      ) & 0xFF;
+        *out++ = (value >>  8) & 0xFF;
+        *out++ = (value >> 16) & 0xFF;
+        lum += 2*lstep;
+    }
+    if ( count & 1 )
+    {
+        YUV_ROW_CHROMA();
+        value = YUV_ROW_PIXEL(lum[0]);
+        *out++ = (value      ) & 0xFF;
+        *out++ = (value >>  8) & 0xFF;
+        *out++ = (value >> 16) & 0xFF;
+    }
+}
+
+static void Color32Row( struct private_yuvhwdata *swdata, Uint8 *out,
+                        const Uint8 *lum, const Uint8 *cr,
+                        const Uint8 *cb, int count )
+{
+    int *colortab = swdata->colortab;
+    Uint32 *rgb_2_pix = swdata->rgb_2_pix;
+    const int lstep = swdata->lum_step;
+    const int cstep = swdata->chroma_step;
+    unsigned int* row = (unsigned int*) out;
+    int x;
+    int cr_r;
+    int crb_g;
+    int cb_b;
+
+    for ( x = count / 2; x > 0; --x )
+    {
+        YUV_ROW_CHROMA();
+        *row++ = YUV_ROW_PIXEL(lum[0]);
+        *row++ = YUV_ROW_PIXEL(lum[lstep]);
+        lum += 2*lstep;
     }
+    if ( count & 1 )
+    {
+        YUV_ROW_CHROMA();
+        *row = YUV_ROW_PIXEL(lum[0]);
+    }
+}
+
+/*
+ * SIMD row converters for RGB565, XRGB8888 and XBGR8888 displays, 16
+ * pixels at a time, all with the same arguments as the C rows (the packed
+ * formats find their pixels from the lum/cr/cb pointers).
+ */
+#if defined(__ARM_NEON__)
+#define YUV_SIMD_KERNEL(name) \
+extern void neon_##name(Uint8 *dst, const Uint8 *lum, const Uint8 *cr, \
+                        const Uint8 *cb, int count);
+#define YUV_SIMD(name)	neon_##name
+
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+
+enum { YUV_OUT_565, YUV_OUT_XRGB8888, YUV_OUT_XBGR8888 };
+
+static __inline__ __m128i SDL_YUV565SSE2(__m128i r, __m128i g, __m128i b)
+{
+	r = _mm_slli_epi16(_mm_srli_epi16(r, 3), 11);
+	g = _mm_slli_epi16(_mm_srli_epi16(g, 2), 5);
+	return _mm_or_si128(_mm_or_si128(r, g), _mm_srli_epi16(b, 3));
+}
+
+/* Converts 8 pixel pairs, ye/yo being the even and odd lum and u/v the
+   cb/cr - 128 of each pair as 16 bit lanes, returns the next dst */
+static __inline__ Uint8 *SDL_YUVStoreSSE2(Uint8 *dst, __m128i ye, __m128i yo,
+                                          __m128i u, __m128i v, int out)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i r, g, b, t, lo, hi;
+
+	/* mulhi of x << 2 is x * k >> 14 */
+	u = _mm_slli_epi16(u, 2);
+	v = _mm_slli_epi16(v, 2);
+	r = _mm_mulhi_epi16(v, _mm_set1_epi16(YUV_CR_R));
+	g = _mm_add_epi16(_mm_mulhi_epi16(v, _mm_set1_epi16(YUV_CR_G)),
+	                  _mm_mulhi_epi16(u, _mm_set1_epi16(YUV_CB_G)));
+	b = _mm_mulhi_epi16(u, _mm_set1_epi16(YUV_CB_B));
+	if ( out == YUV_OUT_XRGB8888 ) {
+		t = r; r = b; b = t;
+	}
+
+	/* clamped to bytes, even pixels in the low half, then in order */
+	r = _mm_packus_epi16(_mm_add_epi16(ye, r), _mm_add_epi16(yo, r));
+	g = _mm_packus_epi16(_mm_add_epi16(ye, g), _mm_add_epi16(yo, g));
+	b = _mm_packus_epi16(_mm_add_epi16(ye, b), _mm_add_epi16(yo, b));
+	r = _mm_unpacklo_epi8(r, _mm_srli_si128(r, 8));
+	g = _mm_unpacklo_epi8(g, _mm_srli_si128(g, 8));
+	b = _mm_unpacklo_epi8(b, _mm_srli_si128(b, 8));
+
+	if ( out == YUV_OUT_565 ) {
+		_mm_storeu_si128((__m128i *)dst, SDL_YUV565SSE2(
+			_mm_unpacklo_epi8(r, zero), _mm_unpacklo_epi8(g, zero),
+			_mm_unpacklo_epi8(b, zero)));
+		_mm_storeu_si128((__m128i *)(dst + 16), SDL_YUV565SSE2(
+			_mm_unpackhi_epi8(r, zero), _mm_unpackhi_epi8(g, zero),
+			_mm_unpackhi_epi8(b, zero)));
+		return dst + 32;
+	}
+
+	/* bytes in r, g, b, 0 order */
+	lo = _mm_unpacklo_epi8(r, g);
+	hi = _mm_unpackhi_epi8(r, g);
+	t = _mm_unpacklo_epi8(b, zero);
+	b = _mm_unpackhi_epi8(b, zero);
+	_mm_storeu_si128((__m128i *)dst, _mm_unpacklo_epi16(lo, t));
+	_mm_storeu_si128((__m128i *)(dst + 16), _mm_unpackhi_epi16(lo, t));
+	_mm_storeu_si128((__m128i *)(dst + 32), _mm_unpacklo_epi16(hi, b));
+	_mm_storeu_si128((__m128i *)(dst + 48), _mm_unpackhi_epi16(hi, b));
+	return dst + 64;
+}
+
+static __inline__ void SDL_YUVPlanarSSE2(Uint8 *dst, const Uint8 *lum,
+                                         const Uint8 *cr, const Uint8 *cb,
+                                         int count, int out)
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i bias = _mm_set1_epi16(128);
+	const __m128i mask = _mm_set1_epi16(0xff);
+	__m128i y, u, v;
+	int i;
+
+	for ( i = 0; i < count; i += 16 ) {
+		y = _mm_loadu_si128((const __m128i *)(lum + i));
+		u = _mm_loadl_epi64((const __m128i *)(cb + i/2));
+		v = _mm_loadl_epi64((const __m128i *)(cr + i/2));
+		dst = SDL_YUVStoreSSE2(dst, _mm_and_si128(y, mask),
+		                       _mm_srli_epi16(y, 8),
+		                       _mm_sub_epi16(_mm_unpacklo_epi8(u, zero), bias),
+		                       _mm_sub_epi16(_mm_unpacklo_epi8(v, zero), bias),
+		                       out);
+	}
+}
+
+/* byte k of the 8 pixel pairs in a0 and a1 as 16 bit lanes */
+static __inline__ __m128i SDL_YUVByteSSE2(__m128i a0, __m128i a1, int k)
+{
+	const __m128i mask = _mm_set1_epi32(0xff);
+
+	return _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(a0, 8*k), mask),
+	                       _mm_and_si128(_mm_srli_epi32(a1, 8*k), mask));
+}
+
+/* y0, u, y1, v are the byte positions in the pixel pairs */
+static __inline__ void SDL_YUVPackedSSE2(Uint8 *dst, const Uint8 *src,
+                                         int count, int y0, int u,
+                                         int y1, int v, int out)
+{
+	const __m128i bias = _mm_set1_epi16(128);
+	__m128i a0, a1;
+	int i;
+
+	for ( i = 0; i < count; i += 16 ) {
+		a0 = _mm_loadu_si128((const __m128i *)(src + i*2));
+		a1 = _mm_loadu_si128((const __m128i *)(src + i*2 + 16));
+		dst = SDL_YUVStoreSSE2(dst, SDL_YUVByteSSE2(a0, a1, y0),
+		                       SDL_YUVByteSSE2(a0, a1, y1),
+		                       _mm_sub_epi16(SDL_YUVByteSSE2(a0, a1, u), bias),
+		                       _mm_sub_epi16(SDL_YUVByteSSE2(a0, a1, v), bias),
+		                       out);
+	}
+}
+
+/* NV12/NV21 and P010 have the lum plane and a plane of chroma pairs, uv
+   being the first one of each pair.  P010 takes the top bytes of its 16
+   bit samples (deep), the pointers to them are moved back to whole ones */
+static __inline__ void SDL_YUVSemiPlanarSSE2(Uint8 *dst, const Uint8 *lum,
+                                             const Uint8 *uv, int count,
+                                             int vfirst, int deep, int out)
+{
+	const __m128i bias = _mm_set1_epi16(128);
+	const __m128i mask = _mm_set1_epi16(0xff);
+	__m128i y, c, u, v;
+	int i;
+
+	if ( deep ) {
+		--lum;
+		--uv;
+	}
+	for ( i = 0; i < count; i += 16 ) {
+		if ( deep ) {
+			y = _mm_packus_epi16(
+			    _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(lum + i*2)), 8),
+			    _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(lum + i*2 + 16)), 8));
+			c = _mm_packus_epi16(
+			    _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(uv + i*2)), 8),
+			    _mm_srli_epi16(_mm_loadu_si128((const __m128i *)(uv + i*2 + 16)), 8));
+		} else {
+			y = _mm_loadu_si128((const __m128i *)(lum + i));
+			c = _mm_loadu_si128((const __m128i *)(uv + i));
+		}
+		if ( vfirst ) {
+			v = _mm_and_si128(c, mask);
+			u = _mm_srli_epi16(c, 8);
+		} else {
+			u = _mm_and_si128(c, mask);
+			v = _mm_srli_epi16(c, 8);
+		}
+		dst = SDL_YUVStoreSSE2(dst, _mm_and_si128(y, mask),
+		                       _mm_srli_epi16(y, 8),
+		                       _mm_sub_epi16(u, bias),
+		                       _mm_sub_epi16(v, bias), out);
+	}
+}
+
+#define YUV_SSE2_PLANAR(name, out)					\
+static void SDL_##name##SSE2(Uint8 *dst, const Uint8 *lum,		\
+                             const Uint8 *cr, const Uint8 *cb, int count) \
+{									\
+	SDL_YUVPlanarSSE2(dst, lum, cr, cb, count, out);		\
+}
+#define YUV_SSE2_PACKED(name, src, y0, u, y1, v, out)			\
+static void SDL_##name##SSE2(Uint8 *dst, const Uint8 *lum,		\
+                             const Uint8 *cr, const Uint8 *cb, int count) \
+{									\
+	SDL_YUVPackedSSE2(dst, src, count, y0, u, y1, v, out);		\
+}
+#define YUV_SSE2_SEMIPLANAR(name, uv, vfirst, deep, out)		\
+static void SDL_##name##SSE2(Uint8 *dst, const Uint8 *lum,		\
+                             const Uint8 *cr, const Uint8 *cb, int count) \
+{									\
+	SDL_YUVSemiPlanarSSE2(dst, lum, uv, count, vfirst, deep, out);	\
 }
+YUV_SSE2_PLANAR(YV12to565, YUV_OUT_565)
+YUV_SSE2_PLANAR(YV12toXRGB8888, YUV_OUT_XRGB8888)
+YUV_SSE2_PLANAR(YV12toXBGR8888, YUV_OUT_XBGR8888)
+YUV_SSE2_PACKED(YUY2to565, lum, 0, 1, 2, 3, YUV_OUT_565)
+YUV_SSE2_PACKED(YUY2toXRGB8888, lum, 0, 1, 2, 3, YUV_OUT_XRGB8888)
+YUV_SSE2_PACKED(YUY2toXBGR8888, lum, 0, 1, 2, 3, YUV_OUT_XBGR8888)
+YUV_SSE2_PACKED(UYVYto565, cb, 1, 0, 3, 2, YUV_OUT_565)
+YUV_SSE2_PACKED(UYVYtoXRGB8888, cb, 1, 0, 3, 2, YUV_OUT_XRGB8888)
+YUV_SSE2_PACKED(UYVYtoXBGR8888, cb, 1, 0, 3, 2, YUV_OUT_XBGR8888)
+YUV_SSE2_PACKED(YVYUto565, lum, 0, 3, 2, 1, YUV_OUT_565)
+YUV_SSE2_PACKED(YVYUtoXRGB8888, lum, 0, 3, 2, 1, YUV_OUT_XRGB8888)
+YUV_SSE2_PACKED(YVYUtoXBGR8888, lum, 0, 3, 2, 1, YUV_OUT_XBGR8888)
+YUV_SSE2_SEMIPLANAR(NV12to565, cb, 0, 0, YUV_OUT_565)
+YUV_SSE2_SEMIPLANAR(NV12toXRGB8888, cb, 0, 0, YUV_OUT_XRGB8888)
+YUV_SSE2_SEMIPLANAR(NV12toXBGR8888, cb, 0, 0, YUV_OUT_XBGR8888)
+YUV_SSE2_SEMIPLANAR(NV21to565, cr, 1, 0, YUV_OUT_565)
+YUV_SSE2_SEMIPLANAR(NV21toXRGB8888, cr, 1, 0, YUV_OUT_XRGB8888)
+YUV_SSE2_SEMIPLANAR(NV21toXBGR8888, cr, 1, 0, YUV_OUT_XBGR8888)
+YUV_SSE2_SEMIPLANAR(P010to565, cb, 0, 1, YUV_OUT_565)
+YUV_SSE2_SEMIPLANAR(P010toXRGB8888, cb, 0, 1, YUV_OUT_XRGB8888)
+YUV_SSE2_SEMIPLANAR(P010toXBGR8888, cb, 0, 1, YUV_OUT_XBGR8888)
+
+#define YUV_SIMD_KERNEL(name)
+#define YUV_SIMD(name)	SDL_##name##SSE2
+#endif
+
+#ifdef YUV_SIMD
+/* The kernels do groups of 16 pixels, the C rows the rest */
+#define DEFINE_YUV_SIMD_ROW(name, bpp, crow)				\
+YUV_SIMD_KERNEL(name)							\
+static void ColorRow##name(struct private_yuvhwdata *swdata, Uint8 *out, \
+                           const Uint8 *lum, const Uint8 *cr,		\
+                           const Uint8 *cb, int count)			\
+{									\
+	int n = count & ~15;						\
+									\
+	if ( n > 0 ) {							\
+		YUV_SIMD(name)(out, lum, cr, cb, n);			\
+	}								\
+	crow(swdata, out + n*bpp, lum + n*swdata->lum_step,		\
+	     cr + n/2*swdata->chroma_step,				\
+	     cb + n/2*swdata->chroma_step, count - n);			\
+}
+DEFINE_YUV_SIMD_ROW(YV12to565, 2, Color16Row)
+DEFINE_YUV_SIMD_ROW(YV12toXRGB8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(YV12toXBGR8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(YUY2to565, 2, Color16Row)
+DEFINE_YUV_SIMD_ROW(YUY2toXRGB8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(YUY2toXBGR8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(UYVYto565, 2, Color16Row)
+DEFINE_YUV_SIMD_ROW(UYVYtoXRGB8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(UYVYtoXBGR8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(YVYUto565, 2, Color16Row)
+DEFINE_YUV_SIMD_ROW(YVYUtoXRGB8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(YVYUtoXBGR8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(NV12to565, 2, Color16Row)
+DEFINE_YUV_SIMD_ROW(NV12toXRGB8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(NV12toXBGR8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(NV21to565, 2, Color16Row)
+DEFINE_YUV_SIMD_ROW(NV21toXRGB8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(NV21toXBGR8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(P010to565, 2, Color16Row)
+DEFINE_YUV_SIMD_ROW(P010toXRGB8888, 4, Color32Row)
+DEFINE_YUV_SIMD_ROW(P010toXBGR8888, 4, Color32Row)
+
+/* [planar, YUY2, UYVY, YVYU, NV12, NV21, P010]
+   [RGB565, XRGB8888, XBGR8888] */
+static void (*const yuv_simd_rows[7][3])(struct private_yuvhwdata *swdata,
+                                         Uint8 *out, const Uint8 *lum,
+                                         const Uint8 *cr, const Uint8 *cb,
+                                         int count) = {
+	{ ColorRowYV12to565, ColorRowYV12toXRGB8888, ColorRowYV12toXBGR8888 },
+	{ ColorRowYUY2to565, ColorRowYUY2toXRGB8888, ColorRowYUY2toXBGR8888 },
+	{ ColorRowUYVYto565, ColorRowUYVYtoXRGB8888, ColorRowUYVYtoXBGR8888 },
+	{ ColorRowYVYUto565, ColorRowYVYUtoXRGB8888, ColorRowYVYUtoXBGR8888 },
+	{ ColorRowNV12to565, ColorRowNV12toXRGB8888, ColorRowNV12toXBGR8888 },
+	{ ColorRowNV21to565, ColorRowNV21toXRGB8888, ColorRowNV21toXBGR8888 },
+	{ ColorRowP010to565, ColorRowP010toXRGB8888, ColorRowP010toXBGR8888 },
+};
+
+/* Like the blitters, the NEON converters can be turned off through
+   SDL_NEON_BLIT_FEATURES for comparing them against the C ones */
+static int SDL_YUVHasSIMD(void)
+{
+#ifdef __ARM_NEON__
+	return (SDL_GetNeonBlitFeatures() & SDL_BLIT_FEATURE_NEON) != 0;
+#else
+	return 1;
+#endif
+}
+#endif /* YUV_SIMD */
 
 /*
  * How many 1 bits are there in the Uint32.
@@ -937,6 +1363,7 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	int i;
 	int CR, CB;
 	Uint32 Rmask, Gmask, Bmask;
+	const char *async;
 
 	/* Only RGB packed pixel conversion supported */
 	if ( (display->format->BytesPerPixel != 2) &&
@@ -953,6 +1380,9 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	    case SDL_YUY2_OVERLAY:
 	    case SDL_UYVY_OVERLAY:
 	    case SDL_YVYU_OVERLAY:
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+	    case SDL_P010_OVERLAY:
 		break;
 	    default:
 		SDL_SetError("Unsupported YUV format");
@@ -983,9 +1413,27 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		SDL_FreeYUVOverlay(overlay);
 		return(NULL);
 	}
-	swdata->stretch = NULL;
 	swdata->display = display;
-	swdata->pixels = (Uint8 *) SDL_malloc(width*height*2);
+	async = SDL_getenv("SDL_VIDEO_YUV_ASYNC");
+	swdata->async = (async && SDL_atoi(async) > 0);
+	swdata->pending = 0;
+	swdata->row = (Uint8 *) SDL_malloc(width*4);
+	swdata->nrows = 1;
+	swdata->steps = NULL;
+	swdata->nsteps = 0;
+	switch (format) {
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+		/* the chroma plane has a row for each pair of lines */
+		swdata->pixels = (Uint8 *) SDL_malloc(width*(height+(height+1)/2));
+		break;
+	    case SDL_P010_OVERLAY:
+		swdata->pixels = (Uint8 *) SDL_malloc(width*2*(height+(height+1)/2));
+		break;
+	    default:
+		swdata->pixels = (Uint8 *) SDL_malloc(width*height*2);
+		break;
+	}
 	swdata->colortab = (int *)SDL_malloc(4*256*sizeof(int));
 	Cr_r_tab = &swdata->colortab[0*256];
 	Cr_g_tab = &swdata->colortab[1*256];
@@ -995,7 +1443,8 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	r_2_pix_alloc = &swdata->rgb_2_pix[0*768];
 	g_2_pix_alloc = &swdata->rgb_2_pix[1*768];
 	b_2_pix_alloc = &swdata->rgb_2_pix[2*768];
-	if ( ! swdata->pixels || ! swdata->colortab || ! swdata->rgb_2_pix ) {
+	if ( ! swdata->pixels || ! swdata->colortab || ! swdata->rgb_2_pix ||
+	     ! swdata->row ) {
 		SDL_OutOfMemory();
 		SDL_FreeYUVOverlay(overlay);
 		return(NULL);
@@ -1007,10 +1456,10 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 		   would be done here.  See the Berkeley mpeg_play sources.
 		*/
 		CB = CR = (i-128);
-		Cr_r_tab[i] = (int) ( (0.419/0.299) * CR);
-		Cr_g_tab[i] = (int) (-(0.299/0.419) * CR);
-		Cb_g_tab[i] = (int) (-(0.114/0.331) * CB); 
-		Cb_b_tab[i] = (int) ( (0.587/0.331) * CB);
+		Cr_r_tab[i] = (CR * YUV_CR_R) >> 14;
+		Cr_g_tab[i] = (CR * YUV_CR_G) >> 14;
+		Cb_g_tab[i] = (CB * YUV_CB_G) >> 14;
+		Cb_b_tab[i] = (CB * YUV_CB_B) >> 14;
 	}
 
 	/* 
@@ -1117,11 +1566,80 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 			swdata->Display2X = Color32DitherYUY2Mod2X;
 		}
 		break;
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+	    case SDL_P010_OVERLAY:
+		/* These only have the row converters */
+		swdata->Display1X = NULL;
+		swdata->Display2X = NULL;
+		break;
 	    default:
 		/* We should never get here (caught above) */
 		break;
 	}
 
+	/* The row converter, for scaling and in place of the above if
+	   there is a faster SIMD one for this display */
+	switch (display->format->BytesPerPixel) {
+	    case 2:
+		swdata->DisplayRow = Color16Row;
+		break;
+	    case 3:
+		swdata->DisplayRow = Color24Row;
+		break;
+	    default:
+		swdata->DisplayRow = Color32Row;
+		break;
+	}
+	switch (format) {
+	    case SDL_YV12_OVERLAY:
+	    case SDL_IYUV_OVERLAY:
+		swdata->lum_step = 1;
+		swdata->chroma_step = 1;
+		i = 0;
+		break;
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+		swdata->lum_step = 1;
+		swdata->chroma_step = 2;
+		i = (format == SDL_NV12_OVERLAY) ? 4 : 5;
+		break;
+	    case SDL_P010_OVERLAY:
+		/* only the top 8 bits of the samples are used */
+		swdata->lum_step = 2;
+		swdata->chroma_step = 4;
+		i = 6;
+		break;
+	    default:
+		swdata->lum_step = 2;
+		swdata->chroma_step = 4;
+		i = (format == SDL_YUY2_OVERLAY) ? 1 :
+		    (format == SDL_UYVY_OVERLAY) ? 2 : 3;
+		break;
+	}
+	swdata->simd = 0;
+#ifdef YUV_SIMD
+	if ( SDL_YUVHasSIMD() ) {
+		int out = -1;
+
+		if ( display->format->BytesPerPixel == 2 &&
+		     Rmask == 0xF800 && Gmask == 0x07E0 && Bmask == 0x001F ) {
+			out = 0;
+		} else if ( display->format->BytesPerPixel == 4 &&
+		            Gmask == 0x0000FF00 ) {
+			if ( Rmask == 0x00FF0000 && Bmask == 0x000000FF ) {
+				out = 1;
+			} else if ( Rmask == 0x000000FF && Bmask == 0x00FF0000 ) {
+				out = 2;
+			}
+		}
+		if ( out >= 0 ) {
+			swdata->DisplayRow = yuv_simd_rows[i][out];
+			swdata->simd = 1;
+		}
+	}
+#endif
+
 	/* Find the pitch and offset values for the overlay */
 	overlay->pitches = swdata->pitches;
 	overlay->pixels = swdata->planes;
@@ -1135,7 +1653,7 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	        overlay->pixels[1] = overlay->pixels[0] +
 		                     overlay->pitches[0] * overlay->h;
 	        overlay->pixels[2] = overlay->pixels[1] +
-		                     overlay->pitches[1] * overlay->h / 2;
+		                     overlay->pitches[1] * ((overlay->h + 1) / 2);
 		overlay->planes = 3;
 		break;
 	    case SDL_YUY2_OVERLAY:
@@ -1145,6 +1663,19 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	        overlay->pixels[0] = swdata->pixels;
 		overlay->planes = 1;
 		break;
+	    case SDL_NV12_OVERLAY:
+	    case SDL_NV21_OVERLAY:
+	    case SDL_P010_OVERLAY:
+		overlay->pitches[0] = overlay->w;
+		if ( format == SDL_P010_OVERLAY ) {
+			overlay->pitches[0] *= 2;
+		}
+		overlay->pitches[1] = overlay->pitches[0];
+	        overlay->pixels[0] = swdata->pixels;
+	        overlay->pixels[1] = overlay->pixels[0] +
+		                     overlay->pitches[0] * overlay->h;
+		overlay->planes = 2;
+		break;
 	    default:
 		/* We should never get here (caught above) */
 		break;
@@ -1154,8 +1685,43 @@ SDL_Overlay *SDL_CreateYUV_SW(_THIS, int width, int height, Uint32 format, SDL_S
 	return(overlay);
 }
 
+/* Overlays with a display still running, their bands write to the
+   display surface and keep it locked */
+static struct private_yuvhwdata *SDL_yuv_pending = NULL;
+
+/* Waits for the display started last to be done and shows it */
+static void SDL_FinishYUV_SW(struct private_yuvhwdata *swdata)
+{
+	struct private_yuvhwdata **prev;
+
+	if ( ! swdata->pending ) {
+		return;
+	}
+	SDL_FinishBlitBands();
+	swdata->pending = 0;
+	for ( prev = &SDL_yuv_pending; *prev; prev = &(*prev)->next_pending ) {
+		if ( *prev == swdata ) {
+			*prev = swdata->next_pending;
+			break;
+		}
+	}
+	if ( SDL_MUSTLOCK(swdata->display) ) {
+		SDL_UnlockSurface(swdata->display);
+	}
+	SDL_UpdateRects(swdata->display, 1, &swdata->job.dst);
+}
+
+/* Called before the display surfaces go away */
+void SDL_FinishAllYUV_SW(void)
+{
+	while ( SDL_yuv_pending ) {
+		SDL_FinishYUV_SW(SDL_yuv_pending);
+	}
+}
+
 int SDL_LockYUV_SW(_THIS, SDL_Overlay *overlay)
 {
+	SDL_FinishYUV_SW(overlay->hwdata);
 	return(0);
 }
 
@@ -1164,51 +1730,213 @@ void SDL_UnlockYUV_SW(_THIS, SDL_Overlay *overlay)
 	return;
 }
 
+/* Source positions for each destination position, stepping the same
+   way as SDL_SoftStretch() */
+static void SDL_YUVSteps(int *steps, int src_len, int dst_len, int first)
+{
+	int i, pos, inc, cur;
+
+	pos = 0x10000;
+	inc = (src_len << 16) / dst_len;
+	cur = first - 1;
+	for ( i = 0; i < dst_len; ++i ) {
+		while ( pos >= 0x10000 ) {
+			++cur;
+			pos -= 0x10000;
+		}
+		steps[i] = cur;
+		pos += inc;
+	}
+}
+
+static void SDL_YUVScaleRow(Uint8 *out, const Uint8 *row, const int *xsteps,
+                            int count, int bpp)
+{
+	const Uint8 *p;
+	int i;
+
+	switch (bpp) {
+	    case 2:
+		for ( i = 0; i < count; ++i ) {
+			((Uint16 *)out)[i] = ((const Uint16 *)row)[xsteps[i]];
+		}
+		break;
+	    case 3:
+		for ( i = 0; i < count; ++i ) {
+			p = row + xsteps[i] * 3;
+			*out++ = p[0];
+			*out++ = p[1];
+			*out++ = p[2];
+		}
+		break;
+	    default:
+		for ( i = 0; i < count; ++i ) {
+			((Uint32 *)out)[i] = ((const Uint32 *)row)[xsteps[i]];
+		}
+		break;
+	}
+}
+
+/* Converts rows y0 to y1 of the job's dst straight from its src part of
+   the overlay, scaling it with the same nearest neighbour steps as
+   SDL_SoftStretch().  Each source row that is used is converted once into
+   'row' and scaled from there, or right into the display when it isn't
+   scaled horizontally.
+*/
+static void SDL_DisplayYUVRows(struct private_yuvhwdata *swdata,
+                               int y0, int y1, Uint8 *row)
+{
+	SDL_Overlay *overlay = swdata->job.overlay;
+	SDL_Rect *src = &swdata->job.src;
+	SDL_Rect *dst = &swdata->job.dst;
+	const int bpp = swdata->display->format->BytesPerPixel;
+	const int pitch = swdata->job.pitch;
+	int *xsteps = swdata->steps;
+	int *ysteps = swdata->steps + dst->w;
+	Uint8 *lum, *Cr, *Cb, *dstp;
+	int x0, count, direct, cpitch, cshift;
+	int y, sy, c, last;
+
+	/* pixel pairs share the chroma, so start at an even one */
+	x0 = src->x & ~1;
+	count = src->x + src->w - x0;
+	lum = swdata->job.lum + x0 * swdata->lum_step;
+	Cr = swdata->job.Cr + (x0 / 2) * swdata->chroma_step;
+	Cb = swdata->job.Cb + (x0 / 2) * swdata->chroma_step;
+	direct = (src->w == dst->w) && (x0 == src->x);
+
+	if ( overlay->planes > 1 ) {
+		cpitch = overlay->pitches[1];
+		cshift = 1;
+	} else {
+		cpitch = overlay->pitches[0];
+		cshift = 0;
+	}
+
+	last = -1;
+	dstp = swdata->job.dstp + y0 * pitch;
+	for ( y = y0; y < y1; ++y, dstp += pitch ) {
+		sy = ysteps[y];
+		c = (sy >> cshift) * cpitch;
+		if ( direct ) {
+			/* converting again beats reading the display back */
+			swdata->DisplayRow(swdata, dstp,
+			                   lum + sy * overlay->pitches[0],
+			                   Cr + c, Cb + c, count);
+			continue;
+		}
+		if ( sy != last ) {
+			swdata->DisplayRow(swdata, row,
+			                   lum + sy * overlay->pitches[0],
+			                   Cr + c, Cb + c, count);
+			last = sy;
+		}
+		SDL_YUVScaleRow(dstp, row, xsteps, dst->w, bpp);
+	}
+}
+
+#define YUV_JOB_ROWS	0
+#define YUV_JOB_1X	1
+#define YUV_JOB_2X	2
+
+/* Does one band of the display job.  Display1X and Display2X do pairs of
+   rows sharing the chroma of planar overlays, so the bands are split on
+   those. */
+static void SDL_DisplayYUVBand(void *arg, int band, int bands)
+{
+	struct private_yuvhwdata *swdata = (struct private_yuvhwdata *)arg;
+	SDL_Overlay *overlay = swdata->job.overlay;
+	int pairs, y0, y1, c;
+	Uint8 *out;
+
+	if ( swdata->job.mode == YUV_JOB_ROWS ) {
+		y0 = (swdata->job.dst.h * band) / bands;
+		y1 = (swdata->job.dst.h * (band + 1)) / bands;
+		SDL_DisplayYUVRows(swdata, y0, y1,
+		                   swdata->row + band * overlay->w * 4);
+		return;
+	}
+
+	pairs = (overlay->h + 1) / 2;
+	y0 = 2 * ((pairs * band) / bands);
+	y1 = 2 * ((pairs * (band + 1)) / bands);
+	if ( y1 > overlay->h ) {
+		y1 = overlay->h;
+	}
+	if ( overlay->planes > 1 ) {
+		c = (y0 / 2) * overlay->pitches[1];
+	} else {
+		c = y0 * overlay->pitches[0];
+	}
+	if ( swdata->job.mode == YUV_JOB_2X ) {
+		out = swdata->job.dstp + 2 * y0 * swdata->job.pitch;
+		swdata->Display2X(swdata->colortab, swdata->rgb_2_pix,
+		                  swdata->job.lum + y0 * overlay->pitches[0],
+		                  swdata->job.Cr + c, swdata->job.Cb + c,
+		                  out, y1 - y0, overlay->w, swdata->job.mod);
+	} else {
+		out = swdata->job.dstp + y0 * swdata->job.pitch;
+		swdata->Display1X(swdata->colortab, swdata->rgb_2_pix,
+		                  swdata->job.lum + y0 * overlay->pitches[0],
+		                  swdata->job.Cr + c, swdata->job.Cb + c,
+		                  out, y1 - y0, overlay->w, swdata->job.mod);
+	}
+}
+
 int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 {
 	struct private_yuvhwdata *swdata;
-	int stretch;
+	int scale;
 	int scale_2x;
+	int rows;
+	int bands;
 	SDL_Surface *display;
 	Uint8 *lum, *Cr, *Cb;
-	Uint8 *dstp;
 	int mod;
 
 	swdata = overlay->hwdata;
-	stretch = 0;
+	SDL_FinishYUV_SW(swdata);
+	display = swdata->display;
+	scale = 0;
 	scale_2x = 0;
 	if ( src->x || src->y || src->w < overlay->w || src->h < overlay->h ) {
-		/* The source rectangle has been clipped.
-		   Using a scratch surface is easier than adding clipped
-		   source support to all the blitters, plus that would
-		   slow them down in the general unclipped case.
-		*/
-		stretch = 1;
+		/* The source rectangle has been clipped, only the row
+		   converters handle that */
+		scale = 1;
 	} else if ( (src->w != dst->w) || (src->h != dst->h) ) {
 		if ( (dst->w == 2*src->w) &&
 		     (dst->h == 2*src->h) ) {
 			scale_2x = 1;
 		} else {
-			stretch = 1;
+			scale = 1;
 		}
 	}
-	if ( stretch ) {
-		if ( ! swdata->stretch ) {
-			display = swdata->display;
-			swdata->stretch = SDL_CreateRGBSurface(
-				SDL_SWSURFACE,
-				overlay->w, overlay->h,
-				display->format->BitsPerPixel,
-				display->format->Rmask,
-				display->format->Gmask,
-				display->format->Bmask, 0);
-			if ( ! swdata->stretch ) {
+	/* The planar Display1X and Display2X can't do a last single row */
+	rows = scale || swdata->simd || ! swdata->Display1X ||
+	       ((overlay->h & 1) && overlay->planes > 1);
+	bands = SDL_BlitBands(dst->h,
+	                      dst->h * dst->w * display->format->BytesPerPixel);
+	if ( rows ) {
+		if ( dst->w + dst->h > swdata->nsteps ) {
+			int *steps = (int *)SDL_realloc(swdata->steps,
+			                 (dst->w + dst->h) * sizeof(int));
+			if ( ! steps ) {
+				SDL_OutOfMemory();
 				return(-1);
 			}
+			swdata->steps = steps;
+			swdata->nsteps = dst->w + dst->h;
+		}
+		if ( bands > swdata->nrows ) {
+			Uint8 *row = (Uint8 *)SDL_realloc(swdata->row,
+			                 bands * overlay->w * 4);
+			if ( ! row ) {
+				SDL_OutOfMemory();
+				return(-1);
+			}
+			swdata->row = row;
+			swdata->nrows = bands;
 		}
-		display = swdata->stretch;
-	} else {
-		display = swdata->display;
 	}
 	switch (overlay->format) {
 	    case SDL_YV12_OVERLAY:
@@ -1236,6 +1964,22 @@ int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 		Cr = lum + 1;
 		Cb = lum + 3;
 		break;
+	    case SDL_NV12_OVERLAY:
+		lum = overlay->pixels[0];
+		Cb = overlay->pixels[1];
+		Cr = Cb + 1;
+		break;
+	    case SDL_NV21_OVERLAY:
+		lum = overlay->pixels[0];
+		Cr = overlay->pixels[1];
+		Cb = Cr + 1;
+		break;
+	    case SDL_P010_OVERLAY:
+		/* the top byte of each little endian sample */
+		lum = overlay->pixels[0] + 1;
+		Cb = overlay->pixels[1] + 1;
+		Cr = Cb + 2;
+		break;
 	    default:
 		SDL_SetError("Unsupported YUV format in blit");
 		return(-1);
@@ -1245,31 +1989,47 @@ int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst)
 			return(-1);
 		}
 	}
-	if ( stretch ) {
-		dstp = (Uint8 *)swdata->stretch->pixels;
-	} else {
-		dstp = (Uint8 *)display->pixels
-			+ dst->x * display->format->BytesPerPixel
-			+ dst->y * display->pitch;
-	}
 	mod = (display->pitch / display->format->BytesPerPixel);
 
-	if ( scale_2x ) {
-		mod -= (overlay->w * 2);
-		swdata->Display2X(swdata->colortab, swdata->rgb_2_pix,
-		                  lum, Cr, Cb, dstp, overlay->h, overlay->w, mod);
+	swdata->job.overlay = overlay;
+	swdata->job.lum = lum;
+	swdata->job.Cr = Cr;
+	swdata->job.Cb = Cb;
+	swdata->job.src = *src;
+	swdata->job.dst = *dst;
+	swdata->job.dstp = (Uint8 *)display->pixels
+		+ dst->x * display->format->BytesPerPixel
+		+ dst->y * display->pitch;
+	swdata->job.pitch = display->pitch;
+	if ( rows ) {
+		swdata->job.mode = YUV_JOB_ROWS;
+		if ( (src->w != dst->w) || (src->x & 1) ) {
+			SDL_YUVSteps(swdata->steps, src->w, dst->w,
+			             src->x & 1);
+		}
+		SDL_YUVSteps(swdata->steps + dst->w, src->h, dst->h, src->y);
+	} else if ( scale_2x ) {
+		swdata->job.mode = YUV_JOB_2X;
+		swdata->job.mod = mod - overlay->w * 2;
 	} else {
-		mod -= overlay->w;
-		swdata->Display1X(swdata->colortab, swdata->rgb_2_pix,
-		                  lum, Cr, Cb, dstp, overlay->h, overlay->w, mod);
+		swdata->job.mode = YUV_JOB_1X;
+		swdata->job.mod = mod - overlay->w;
+	}
+
+	/* The display stays locked until the bands are done */
+	if ( swdata->async &&
+	     SDL_StartBlitBands(SDL_DisplayYUVBand, swdata, bands) ) {
+		swdata->pending = 1;
+		swdata->next_pending = SDL_yuv_pending;
+		SDL_yuv_pending = swdata;
+		return(0);
+	}
+	if ( ! swdata->async ) {
+		SDL_RunBlitBands(SDL_DisplayYUVBand, swdata, bands);
 	}
 	if ( SDL_MUSTLOCK(display) ) {
 		SDL_UnlockSurface(display);
 	}
-	if ( stretch ) {
-		display = swdata->display;
-		SDL_SoftStretch(swdata->stretch, src, display, dst);
-	}
 	SDL_UpdateRects(display, 1, dst);
 
 	return(0);
@@ -1281,8 +2041,12 @@ void SDL_FreeYUV_SW(_THIS, SDL_Overlay *overlay)
 
 	swdata = overlay->hwdata;
 	if ( swdata ) {
-		if ( swdata->stretch ) {
-			SDL_FreeSurface(swdata->stretch);
+		SDL_FinishYUV_SW(swdata);
+		if ( swdata->row ) {
+			SDL_free(swdata->row);
+		}
+		if ( swdata->steps ) {
+			SDL_free(swdata->steps);
 		}
 		if ( swdata->pixels ) {
 			SDL_free(swdata->pixels);
@@ -35,3 +35,5 @@ extern void SDL_UnlockYUV_SW(_THIS, SDL_Overlay *overlay);
 extern int SDL_DisplayYUV_SW(_THIS, SDL_Overlay *overlay, SDL_Rect *src, SDL_Rect *dst);
 
 extern void SDL_FreeYUV_SW(_THIS, SDL_Overlay *overlay);
+
+extern void SDL_FinishAllYUV_SW(void);
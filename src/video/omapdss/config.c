@@ -38,6 +38,17 @@ static int check_token(char **p_, const char *token)
 	return ret;
 }
 
+static int parse_accel(const char *p)
+{
+	if (strncasecmp(p, "cpu", 3) == 0)
+		return OSDL_ACCEL_CPU;
+	if (strncasecmp(p, "sdma", 4) == 0)
+		return OSDL_ACCEL_SDMA;
+	if (strncasecmp(p, "none", 4) != 0 && *p != '0')
+		err("config: unknown accel \"%s\", using none", p);
+	return OSDL_ACCEL_NONE;
+}
+
 static int check_token_eq(char **p_, const char *token)
 {
 	char *p = *p_;
@@ -54,6 +65,10 @@ void omapsdl_config(struct SDL_PrivateVideoData *pdata)
 	char buff[256];
 	FILE *f;
 
+	pdata->cfg_vram_surfaces_kb = 2048;
+	pdata->cfg_clut_bpp = 16;
+	pdata->cfg_stats = -1;
+
 	f = fopen("omapsdl.cfg", "r");
 	if (f == NULL)
 		return;
@@ -103,6 +118,26 @@ void omapsdl_config(struct SDL_PrivateVideoData *pdata)
 			pdata->cfg_ts_force_tslib = !!strtol(p, NULL, 0);
 			continue;
 		}
+		else if (check_token_eq(&p, "async_flip")) {
+			pdata->cfg_async_flip = !!strtol(p, NULL, 0);
+			continue;
+		}
+		else if (check_token_eq(&p, "accel")) {
+			pdata->cfg_accel = parse_accel(p);
+			continue;
+		}
+		else if (check_token_eq(&p, "vram_surfaces")) {
+			pdata->cfg_vram_surfaces_kb = strtol(p, NULL, 0);
+			continue;
+		}
+		else if (check_token_eq(&p, "clut_depth")) {
+			pdata->cfg_clut_bpp = strtol(p, NULL, 0);
+			continue;
+		}
+		else if (check_token_eq(&p, "threads")) {
+			pdata->cfg_threads = strtol(p, NULL, 0);
+			continue;
+		}
 
 bad:
 		err("config: failed to parse: %s", line);
@@ -129,6 +164,24 @@ void omapsdl_config_from_env(struct SDL_PrivateVideoData *pdata)
 	tmp = getenv("SDL_OMAP_TS_FORCE_TSLIB");
 	if (tmp != NULL)
 		pdata->cfg_ts_force_tslib = !!strtol(tmp, NULL, 0);
+	tmp = getenv("SDL_OMAP_ASYNC_FLIP");
+	if (tmp != NULL)
+		pdata->cfg_async_flip = !!strtol(tmp, NULL, 0);
+	tmp = getenv("SDL_OMAP_ACCEL");
+	if (tmp != NULL)
+		pdata->cfg_accel = parse_accel(tmp);
+	tmp = getenv("SDL_OMAP_VRAM_SURFACES");
+	if (tmp != NULL)
+		pdata->cfg_vram_surfaces_kb = strtol(tmp, NULL, 0);
+	tmp = getenv("SDL_OMAP_CLUT_DEPTH");
+	if (tmp != NULL)
+		pdata->cfg_clut_bpp = strtol(tmp, NULL, 0);
+	tmp = getenv("SDL_OMAP_THREADS");
+	if (tmp != NULL)
+		pdata->cfg_threads = strtol(tmp, NULL, 0);
+	tmp = getenv("SDL_OMAP_STATS");
+	if (tmp != NULL)
+		pdata->cfg_stats = strtol(tmp, NULL, 0);
 	tmp = getenv("SDL_OMAP_BORDER_CUT");
 	if (tmp != NULL) {
 		int l, r, t, b;
@@ -17,10 +17,13 @@
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <time.h>
+#include <pthread.h>
 #include <linux/fb.h>
 #include <linux/matroxfb.h>
 
 #include "fbdev.h"
+#include "memfb.h"
 
 #define PFX "fbdev: "
 
@@ -42,8 +45,117 @@ struct vout_fbdev {
 	size_t	mem_saved_size;
 	unsigned long vsync_ioctl;
 	int	vsync_arg;
+	/* async flip state, buffers are indexes or -1 */
+	pthread_t flip_thread;
+	pthread_mutex_t flip_mutex;
+	pthread_cond_t flip_cond;
+	int	async_running;
+	int	async_resume;
+	int	async_quit;
+	int	buf_display;	/* scanned out, never written */
+	int	buf_pending;	/* panned, waiting for vsync */
+	int	buf_ready;	/* complete, waiting for the thread */
+	unsigned int flips_queued, flips_dropped, flips_waited;
+	/* flip -> vsync latency reporting */
+	void	(*latency_cb)(void *arg, unsigned int us);
+	void	*latency_arg;
+	struct	timespec ready_time;
 };
 
+static unsigned int vout_fbdev_us_since(const struct timespec *t0)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (t.tv_sec - t0->tv_sec) * 1000000
+		+ (t.tv_nsec - t0->tv_nsec) / 1000;
+}
+
+static void vout_fbdev_pan(struct vout_fbdev *fbdev, int buf)
+{
+	fbdev->fbvar_new.yoffset = 
+		(fbdev->top_border + fbdev->fbvar_new.yres + fbdev->bottom_border) * buf +
+		fbdev->top_border;
+
+	memfb_ioctl(fbdev->fd, FBIOPAN_DISPLAY, &fbdev->fbvar_new);
+}
+
+/* Pans to each ready buffer and waits for the vsync that latches it,
+ * so that the app never has to block in wait_vsync itself. */
+static void *vout_fbdev_flip_thread(void *arg)
+{
+	struct vout_fbdev *fbdev = arg;
+	void (*latency_cb)(void *arg, unsigned int us);
+	struct timespec ready_time;
+	int buf;
+
+	pthread_mutex_lock(&fbdev->flip_mutex);
+	while (1) {
+		while (fbdev->buf_ready < 0 && !fbdev->async_quit)
+			pthread_cond_wait(&fbdev->flip_cond, &fbdev->flip_mutex);
+		if (fbdev->async_quit)
+			break;
+
+		buf = fbdev->buf_ready;
+		fbdev->buf_ready = -1;
+		fbdev->buf_pending = buf;
+		latency_cb = fbdev->latency_cb;
+		ready_time = fbdev->ready_time;
+		pthread_mutex_unlock(&fbdev->flip_mutex);
+
+		vout_fbdev_pan(fbdev, buf);
+		vout_fbdev_wait_vsync(fbdev);
+		if (latency_cb != NULL)
+			latency_cb(fbdev->latency_arg,
+				vout_fbdev_us_since(&ready_time));
+
+		pthread_mutex_lock(&fbdev->flip_mutex);
+		fbdev->buf_display = buf;
+		fbdev->buf_pending = -1;
+		pthread_cond_broadcast(&fbdev->flip_cond);
+	}
+	pthread_mutex_unlock(&fbdev->flip_mutex);
+
+	return NULL;
+}
+
+static void *vout_fbdev_flip_async(struct vout_fbdev *fbdev)
+{
+	int i, waited = 0;
+
+	pthread_mutex_lock(&fbdev->flip_mutex);
+
+	if (fbdev->buf_ready >= 0)
+		/* previous frame never made it to the screen */
+		fbdev->flips_dropped++;
+	fbdev->buf_ready = fbdev->buffer_write;
+	fbdev->flips_queued++;
+	if (fbdev->latency_cb != NULL)
+		clock_gettime(CLOCK_MONOTONIC, &fbdev->ready_time);
+	pthread_cond_broadcast(&fbdev->flip_cond);
+
+	/* hand out anything not displayed or queued for display,
+	 * only blocks if the app is more than a frame ahead of vsync */
+	while (1) {
+		for (i = 0; i < fbdev->buffer_count; i++)
+			if (i != fbdev->buf_display && i != fbdev->buf_pending
+			    && i != fbdev->buf_ready)
+				break;
+		if (i < fbdev->buffer_count)
+			break;
+
+		if (!waited)
+			fbdev->flips_waited++;
+		waited = 1;
+		pthread_cond_wait(&fbdev->flip_cond, &fbdev->flip_mutex);
+	}
+	fbdev->buffer_write = i;
+
+	pthread_mutex_unlock(&fbdev->flip_mutex);
+
+	return (char *)fbdev->mem + fbdev->fb_size * i;
+}
+
 void *vout_fbdev_flip(struct vout_fbdev *fbdev)
 {
 	int draw_buf;
@@ -51,24 +163,104 @@ void *vout_fbdev_flip(struct vout_fbdev *fbdev)
 	if (fbdev->buffer_count < 2)
 		return fbdev->mem;
 
+	if (fbdev->async_running)
+		return vout_fbdev_flip_async(fbdev);
+
 	draw_buf = fbdev->buffer_write;
 	fbdev->buffer_write++;
 	if (fbdev->buffer_write >= fbdev->buffer_count)
 		fbdev->buffer_write = 0;
 
-	fbdev->fbvar_new.yoffset = 
-		(fbdev->top_border + fbdev->fbvar_new.yres + fbdev->bottom_border) * draw_buf +
-		fbdev->top_border;
+	vout_fbdev_pan(fbdev, draw_buf);
 
-	ioctl(fbdev->fd, FBIOPAN_DISPLAY, &fbdev->fbvar_new);
+	pthread_mutex_lock(&fbdev->flip_mutex);
+	fbdev->buf_display = draw_buf;
+	pthread_mutex_unlock(&fbdev->flip_mutex);
 
 	return (char *)fbdev->mem + fbdev->fb_size * fbdev->buffer_write;
 }
 
+int vout_fbdev_async_start(struct vout_fbdev *fbdev)
+{
+	int ret;
+
+	if (fbdev->async_running)
+		return 0;
+
+	if (fbdev->buffer_count < 3 || fbdev->vsync_ioctl == 0) {
+		fprintf(stderr, PFX "async flip needs 3 buffers and vsync, "
+			"have %d buffers, vsync %s\n", fbdev->buffer_count,
+			fbdev->vsync_ioctl ? "ok" : "missing");
+		return -1;
+	}
+
+	if (fbdev->buf_display < 0 || fbdev->buf_display == fbdev->buffer_write) {
+		fbdev->buf_display = fbdev->buffer_write - 1;
+		if (fbdev->buf_display < 0)
+			fbdev->buf_display = fbdev->buffer_count - 1;
+	}
+	fbdev->buf_pending = fbdev->buf_ready = -1;
+	fbdev->async_quit = 0;
+
+	ret = pthread_create(&fbdev->flip_thread, NULL,
+		vout_fbdev_flip_thread, fbdev);
+	if (ret != 0) {
+		fprintf(stderr, PFX "failed to create flip thread: %d\n", ret);
+		return -1;
+	}
+
+	fbdev->async_running = 1;
+	return 0;
+}
+
+void vout_fbdev_async_stop(struct vout_fbdev *fbdev)
+{
+	if (!fbdev->async_running)
+		return;
+
+	pthread_mutex_lock(&fbdev->flip_mutex);
+	fbdev->async_quit = 1;
+	pthread_cond_broadcast(&fbdev->flip_cond);
+	pthread_mutex_unlock(&fbdev->flip_mutex);
+	pthread_join(fbdev->flip_thread, NULL);
+
+	/* show whatever was completed last,
+	 * app keeps drawing to buffer_write */
+	if (fbdev->buf_ready >= 0)
+		vout_fbdev_pan(fbdev, fbdev->buf_ready);
+
+	pthread_mutex_lock(&fbdev->flip_mutex);
+	if (fbdev->buf_ready >= 0)
+		fbdev->buf_display = fbdev->buf_ready;
+	fbdev->buf_pending = fbdev->buf_ready = -1;
+	fbdev->async_running = 0;
+	pthread_mutex_unlock(&fbdev->flip_mutex);
+}
+
+void vout_fbdev_get_flip_stats(struct vout_fbdev *fbdev, unsigned int *queued,
+	unsigned int *dropped, unsigned int *waited)
+{
+	pthread_mutex_lock(&fbdev->flip_mutex);
+	*queued = fbdev->flips_queued;
+	*dropped = fbdev->flips_dropped;
+	*waited = fbdev->flips_waited;
+	pthread_mutex_unlock(&fbdev->flip_mutex);
+}
+
+/* async mode only, called from the flip thread once the frame is shown */
+void vout_fbdev_set_latency_cb(struct vout_fbdev *fbdev,
+	void (*cb)(void *arg, unsigned int us), void *arg)
+{
+	pthread_mutex_lock(&fbdev->flip_mutex);
+	fbdev->latency_cb = cb;
+	fbdev->latency_arg = arg;
+	pthread_mutex_unlock(&fbdev->flip_mutex);
+}
+
 void vout_fbdev_wait_vsync(struct vout_fbdev *fbdev)
 {
 	if (fbdev->vsync_ioctl != 0)
-		ioctl(fbdev->fd, fbdev->vsync_ioctl, &fbdev->vsync_arg);
+		memfb_ioctl(fbdev->fd, fbdev->vsync_ioctl, &fbdev->vsync_arg);
 }
 
 /* it is recommended to call vout_fbdev_clear() before this */
@@ -80,8 +272,11 @@ void *vout_fbdev_resize(struct vout_fbdev *fbdev, int w, int h, int bpp,
 	size_t mem_size;
 	int ret;
 
+	// the thread would pan with stale geometry
+	vout_fbdev_async_stop(fbdev);
+
 	// unblank to be sure the mode is really accepted
-	ioctl(fbdev->fd, FBIOBLANK, FB_BLANK_UNBLANK);
+	memfb_ioctl(fbdev->fd, FBIOBLANK, FB_BLANK_UNBLANK);
 
 	if (fbdev->fbvar_new.bits_per_pixel != bpp ||
 			fbdev->fbvar_new.xres != w ||
@@ -105,15 +300,16 @@ void *vout_fbdev_resize(struct vout_fbdev *fbdev, int w, int h, int bpp,
 		fbdev->fbvar_new.nonstd = 0; // can set YUV here on omapfb
 		fbdev->buffer_count = buffer_cnt;
 		fbdev->buffer_write = buffer_cnt > 1 ? 1 : 0;
+		fbdev->buf_display = -1;
 
 		// seems to help a bit to avoid glitches
 		vout_fbdev_wait_vsync(fbdev);
 
-		ret = ioctl(fbdev->fd, FBIOPUT_VSCREENINFO, &fbdev->fbvar_new);
+		ret = memfb_ioctl(fbdev->fd, FBIOPUT_VSCREENINFO, &fbdev->fbvar_new);
 		if (ret == -1) {
 			// retry with no multibuffering
 			fbdev->fbvar_new.yres_virtual = h_total;
-			ret = ioctl(fbdev->fd, FBIOPUT_VSCREENINFO, &fbdev->fbvar_new);
+			ret = memfb_ioctl(fbdev->fd, FBIOPUT_VSCREENINFO, &fbdev->fbvar_new);
 			if (ret == -1) {
 				perror(PFX "FBIOPUT_VSCREENINFO ioctl");
 				return NULL;
@@ -181,13 +377,27 @@ int vout_fbdev_get_fd(struct vout_fbdev *fbdev)
 	return fbdev->fd;
 }
 
+void *vout_fbdev_get_mem(struct vout_fbdev *fbdev, size_t *size)
+{
+	*size = fbdev->mem_size;
+	return fbdev->mem;
+}
+
+/* the buffer being scanned out, flips record it in buf_display
+ * (the flip thread does in async mode, so it's read under its lock) */
 void *vout_fbdev_get_active_mem(struct vout_fbdev *fbdev)
 {
 	int i;
 
-	i = fbdev->buffer_write - 1;
-	if (i < 0)
-		i = fbdev->buffer_count - 1;
+	pthread_mutex_lock(&fbdev->flip_mutex);
+	i = fbdev->buf_display;
+	if (i < 0) {
+		/* nothing flipped since the mode was set */
+		i = fbdev->buffer_write - 1;
+		if (i < 0)
+			i = fbdev->buffer_count - 1;
+	}
+	pthread_mutex_unlock(&fbdev->flip_mutex);
 
 	return (char *)fbdev->mem + fbdev->fb_size * i;
 }
@@ -203,14 +413,18 @@ struct vout_fbdev *vout_fbdev_init(const char *fbdev_name, int *w, int *h, int b
 	if (fbdev == NULL)
 		return NULL;
 
-	fbdev->fd = open(fbdev_name, O_RDWR);
+	pthread_mutex_init(&fbdev->flip_mutex, NULL);
+	pthread_cond_init(&fbdev->flip_cond, NULL);
+	fbdev->buf_display = -1;
+
+	fbdev->fd = memfb_open(fbdev_name, O_RDWR);
 	if (fbdev->fd == -1) {
 		fprintf(stderr, PFX "%s: ", fbdev_name);
 		perror("open");
 		goto fail_open;
 	}
 
-	ret = ioctl(fbdev->fd, FBIOGET_VSCREENINFO, &fbdev->fbvar_old);
+	ret = memfb_ioctl(fbdev->fd, FBIOGET_VSCREENINFO, &fbdev->fbvar_old);
 	if (ret == -1) {
 		perror(PFX "FBIOGET_VSCREENINFO ioctl");
 		goto fail;
@@ -240,12 +454,12 @@ struct vout_fbdev *vout_fbdev_init(const char *fbdev_name, int *w, int *h, int b
 	// screen was unblanked by vout_fbdev_resize(), so vsync should work
 	// first try pandora's adaptive vsync hack, then the default one
 	ret = 0;
-	ret = ioctl(fbdev->fd, OMAPFB_WAITFORVSYNC_FRAME, &ret);
+	ret = memfb_ioctl(fbdev->fd, OMAPFB_WAITFORVSYNC_FRAME, &ret);
 	if (ret == 0)
 		fbdev->vsync_ioctl = OMAPFB_WAITFORVSYNC_FRAME;
 	if (ret != 0) {
 		ret = 0;
-		ret = ioctl(fbdev->fd, FBIO_WAITFORVSYNC, &ret);
+		ret = memfb_ioctl(fbdev->fd, FBIO_WAITFORVSYNC, &ret);
 		if (ret == 0)
 			fbdev->vsync_ioctl = FBIO_WAITFORVSYNC;
 	}
@@ -255,7 +469,7 @@ struct vout_fbdev *vout_fbdev_init(const char *fbdev_name, int *w, int *h, int b
 	if (fbdev->buffer_count > 1) {
 		fbdev->buffer_write = 0;
 		fbdev->fbvar_new.yoffset = fbdev->fbvar_new.yres * (fbdev->buffer_count - 1);
-		ret = ioctl(fbdev->fd, FBIOPAN_DISPLAY, &fbdev->fbvar_new);
+		ret = memfb_ioctl(fbdev->fd, FBIOPAN_DISPLAY, &fbdev->fbvar_new);
 		if (ret != 0) {
 			fbdev->buffer_count = 1;
 			fprintf(stderr, PFX "Warning: can't pan display, doublebuffering disabled\n");
@@ -266,15 +480,17 @@ struct vout_fbdev *vout_fbdev_init(const char *fbdev_name, int *w, int *h, int b
 	return fbdev;
 
 fail:
-	close(fbdev->fd);
+	memfb_close(fbdev->fd);
 fail_open:
+	pthread_cond_destroy(&fbdev->flip_cond);
+	pthread_mutex_destroy(&fbdev->flip_mutex);
 	free(fbdev);
 	return NULL;
 }
 
 static void vout_fbdev_release(struct vout_fbdev *fbdev)
 {
-	ioctl(fbdev->fd, FBIOPUT_VSCREENINFO, &fbdev->fbvar_old);
+	memfb_ioctl(fbdev->fd, FBIOPUT_VSCREENINFO, &fbdev->fbvar_old);
 	if (fbdev->mem != MAP_FAILED)
 		munmap(fbdev->mem, fbdev->mem_size);
 	fbdev->mem = NULL;
@@ -289,6 +505,9 @@ int vout_fbdev_save(struct vout_fbdev *fbdev)
 		return -1;
 	}
 
+	fbdev->async_resume = fbdev->async_running;
+	vout_fbdev_async_stop(fbdev);
+
 	if (fbdev->mem_saved_size < fbdev->mem_size) {
 		tmp = realloc(fbdev->mem_saved, fbdev->mem_size);
 		if (tmp == NULL)
@@ -318,21 +537,30 @@ int vout_fbdev_restore(struct vout_fbdev *fbdev)
 	}
 	memcpy(fbdev->mem, fbdev->mem_saved, fbdev->mem_size);
 
-	ret = ioctl(fbdev->fd, FBIOPUT_VSCREENINFO, &fbdev->fbvar_new);
+	ret = memfb_ioctl(fbdev->fd, FBIOPUT_VSCREENINFO, &fbdev->fbvar_new);
 	if (ret == -1) {
 		perror(PFX "restore: FBIOPUT_VSCREENINFO");
 		return -1;
 	}
 
+	if (fbdev->async_resume) {
+		vout_fbdev_pan(fbdev, fbdev->buf_display);
+		vout_fbdev_async_start(fbdev);
+		fbdev->async_resume = 0;
+	}
+
 	return 0;
 }
 
 void vout_fbdev_finish(struct vout_fbdev *fbdev)
 {
+	vout_fbdev_async_stop(fbdev);
 	vout_fbdev_release(fbdev);
 	if (fbdev->fd >= 0)
-		close(fbdev->fd);
+		memfb_close(fbdev->fd);
 	fbdev->fd = -1;
+	pthread_cond_destroy(&fbdev->flip_cond);
+	pthread_mutex_destroy(&fbdev->flip_mutex);
 	free(fbdev);
 }
 
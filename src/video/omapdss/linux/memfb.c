@@ -0,0 +1,406 @@
+/*
+ * (C) Gražvydas "notaz" Ignotas, 2012
+ *
+ * This work is licensed under the terms of any of these licenses
+ * (at your option):
+ *  - GNU GPL, version 2 or later.
+ *  - GNU LGPL, version 2.1 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ * Memory-backed framebuffer, emulates just enough of fbdev and omapfb
+ * to run the driver on machines without DSS hardware.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#include <linux/fb.h>
+
+#include "../omapfb.h"
+#include "memfb.h"
+
+#define PFX "memfb: "
+
+#define MEMFB_VRAM_MAX	(32 * 1024 * 1024)
+#define MEMFB_MAX_DEVS	4
+#define MEMFB_MAX_FDS	16
+
+/* one per emulated fb/overlay, like a real device
+ * the state outlives the fds */
+struct memfb_dev {
+	int	id;
+	int	created;
+	int	users;
+	int	mem_fd;
+	struct	fb_var_screeninfo var;
+	struct	omapfb_plane_info pi;
+	struct	omapfb_mem_info mi;
+	/* simulated scanout */
+	unsigned long long pan_ns;
+	int	pan_pending;
+	unsigned int pan_yoffset;
+	unsigned int scan_yoffset;
+	unsigned int vsync_waits, pans, pans_latched;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	struct	memfb_dev devs[MEMFB_MAX_DEVS];
+	struct {
+		int fd;
+		struct memfb_dev *dev;
+	} fds[MEMFB_MAX_FDS];
+	/* all overlays share the display timing */
+	int	w, h;
+	unsigned long long t0_ns, period_ns;
+} memfb = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+static unsigned long long memfb_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+/* most recent simulated vblank at or before t */
+static unsigned long long memfb_last_vblank(unsigned long long t)
+{
+	return t - (t - memfb.t0_ns) % memfb.period_ns;
+}
+
+/* hardware latches the last pan done before vblank, emulate that */
+static void memfb_update_scanout(struct memfb_dev *dev, unsigned long long now)
+{
+	if (dev->pan_pending && dev->pan_ns < memfb_last_vblank(now)) {
+		dev->scan_yoffset = dev->pan_yoffset;
+		dev->pan_pending = 0;
+		dev->pans_latched++;
+	}
+}
+
+static struct memfb_dev *memfb_lookup(int fd)
+{
+	int i;
+
+	if (fd < 0)
+		return NULL;
+	for (i = 0; i < MEMFB_MAX_FDS; i++)
+		if (memfb.fds[i].dev != NULL && memfb.fds[i].fd == fd)
+			return memfb.fds[i].dev;
+
+	return NULL;
+}
+
+static int memfb_create(struct memfb_dev *dev, const char *params)
+{
+	char name[] = "/tmp/omapsdl-memfb-XXXXXX";
+	int w = 800, h = 480, hz = 60;
+
+	/* display mode is set by whichever device is opened first */
+	if (memfb.period_ns == 0) {
+		if (*params == ':')
+			sscanf(params + 1, "%dx%d@%d", &w, &h, &hz);
+		if (w <= 0 || h <= 0 || hz <= 0) {
+			fprintf(stderr, PFX "bad mode in \"%s\"\n", params);
+			errno = EINVAL;
+			return -1;
+		}
+		memfb.w = w;
+		memfb.h = h;
+		memfb.t0_ns = memfb_now();
+		memfb.period_ns = 1000000000ull / hz;
+		printf(PFX "%dx%d@%dHz, %d KiB vram max\n",
+			w, h, hz, MEMFB_VRAM_MAX / 1024);
+	}
+
+	dev->mem_fd = mkstemp(name);
+	if (dev->mem_fd == -1) {
+		perror(PFX "mkstemp");
+		return -1;
+	}
+	unlink(name);
+
+	memset(&dev->var, 0, sizeof(dev->var));
+	dev->var.xres = dev->var.xres_virtual = memfb.w;
+	dev->var.yres = dev->var.yres_virtual = memfb.h;
+	dev->var.bits_per_pixel = 16;
+	/* no blanking, so that the refresh rate can be worked out */
+	dev->var.pixclock = memfb.period_ns * 1000 / ((unsigned long long)memfb.w * memfb.h);
+
+	memset(&dev->pi, 0, sizeof(dev->pi));
+	dev->pi.out_width = memfb.w;
+	dev->pi.out_height = memfb.h;
+
+	memset(&dev->mi, 0, sizeof(dev->mi));
+	dev->mi.size = memfb.w * memfb.h * 2;
+	if (ftruncate(dev->mem_fd, dev->mi.size) != 0) {
+		perror(PFX "ftruncate");
+		close(dev->mem_fd);
+		return -1;
+	}
+
+	dev->created = 1;
+	return 0;
+}
+
+int memfb_open(const char *name, int flags)
+{
+	struct memfb_dev *dev;
+	const char *p;
+	int i, id = 0, fd = -1;
+
+	if (strncmp(name, "mem", 3) != 0)
+		return open(name, flags);
+	p = name + 3;
+	if ('0' <= *p && *p <= '9')
+		id = *p++ - '0';
+	if ((*p != 0 && *p != ':') || id >= MEMFB_MAX_DEVS)
+		return open(name, flags);
+
+	pthread_mutex_lock(&memfb.lock);
+
+	for (i = 0; i < MEMFB_MAX_FDS; i++)
+		if (memfb.fds[i].dev == NULL)
+			break;
+	if (i == MEMFB_MAX_FDS) {
+		errno = EMFILE;
+		goto out;
+	}
+
+	dev = &memfb.devs[id];
+	if (!dev->created && memfb_create(dev, p) != 0)
+		goto out;
+	dev->id = id;
+
+	/* a real fd, so that mmap() works on it directly */
+	fd = dup(dev->mem_fd);
+	if (fd == -1)
+		goto out;
+
+	memfb.fds[i].fd = fd;
+	memfb.fds[i].dev = dev;
+	dev->users++;
+out:
+	pthread_mutex_unlock(&memfb.lock);
+	return fd;
+}
+
+int memfb_close(int fd)
+{
+	struct memfb_dev *dev;
+	int i;
+
+	pthread_mutex_lock(&memfb.lock);
+
+	dev = memfb_lookup(fd);
+	if (dev == NULL) {
+		pthread_mutex_unlock(&memfb.lock);
+		return close(fd);
+	}
+
+	for (i = 0; i < MEMFB_MAX_FDS; i++)
+		if (memfb.fds[i].dev != NULL && memfb.fds[i].fd == fd)
+			memfb.fds[i].dev = NULL;
+
+	if (--dev->users == 0 && (dev->vsync_waits | dev->pans)) {
+		memfb_update_scanout(dev, memfb_now());
+		printf(PFX "mem%d: %u vsync waits, %u pans, %u latched\n",
+			dev->id, dev->vsync_waits, dev->pans, dev->pans_latched);
+		dev->vsync_waits = dev->pans = dev->pans_latched = 0;
+	}
+
+	pthread_mutex_unlock(&memfb.lock);
+	return close(fd);
+}
+
+static int memfb_wait_vsync(struct memfb_dev *dev)
+{
+	unsigned long long next;
+	struct timespec ts;
+
+	pthread_mutex_lock(&memfb.lock);
+	next = memfb_last_vblank(memfb_now()) + memfb.period_ns;
+	dev->vsync_waits++;
+	pthread_mutex_unlock(&memfb.lock);
+
+	ts.tv_sec = next / 1000000000ull;
+	ts.tv_nsec = next % 1000000000ull;
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+
+	pthread_mutex_lock(&memfb.lock);
+	memfb_update_scanout(dev, memfb_now());
+	pthread_mutex_unlock(&memfb.lock);
+	return 0;
+}
+
+static int memfb_check_var(const struct fb_var_screeninfo *var)
+{
+	if (var->xres == 0 || var->yres == 0
+	    || var->xres_virtual < var->xres
+	    || var->xoffset + var->xres > var->xres_virtual
+	    || var->yoffset + var->yres > var->yres_virtual)
+		return -1;
+
+	switch (var->nonstd) {
+	case 0:
+		if (var->bits_per_pixel != 16 && var->bits_per_pixel != 24
+		    && var->bits_per_pixel != 32)
+			return -1;
+		break;
+	case OMAPFB_COLOR_YUV422:
+	case OMAPFB_COLOR_YUY422:
+		/* packed YUV, 2 pixels share chroma */
+		if (var->bits_per_pixel != 16 || (var->xres_virtual & 1))
+			return -1;
+		break;
+	default:
+		return -1;
+	}
+
+	return 0;
+}
+
+static int memfb_do_ioctl(struct memfb_dev *dev, unsigned long request, void *arg)
+{
+	struct fb_var_screeninfo *var;
+	struct fb_fix_screeninfo *fix;
+	struct omapfb_plane_info *pi;
+	struct omapfb_mem_info *mi;
+	size_t size;
+
+	switch (request) {
+	case FBIOGET_VSCREENINFO:
+		memcpy(arg, &dev->var, sizeof(dev->var));
+		return 0;
+
+	case FBIOPUT_VSCREENINFO:
+		var = arg;
+		if (memfb_check_var(var) != 0)
+			break;
+		size = (size_t)var->xres_virtual * var->yres_virtual
+			* var->bits_per_pixel / 8;
+		if (size > dev->mi.size)
+			break;
+		dev->var = *var;
+		dev->scan_yoffset = var->yoffset;
+		dev->pan_pending = 0;
+		return 0;
+
+	case FBIOGET_FSCREENINFO:
+		fix = arg;
+		memset(fix, 0, sizeof(*fix));
+		snprintf(fix->id, sizeof(fix->id), "memfb%d", dev->id);
+		fix->smem_len = dev->mi.size;
+		fix->type = FB_TYPE_PACKED_PIXELS;
+		fix->visual = FB_VISUAL_TRUECOLOR;
+		fix->line_length = dev->var.xres_virtual
+			* dev->var.bits_per_pixel / 8;
+		return 0;
+
+	case FBIOPAN_DISPLAY:
+		var = arg;
+		if (var->xoffset + dev->var.xres > dev->var.xres_virtual
+		    || var->yoffset + dev->var.yres > dev->var.yres_virtual)
+			break;
+		dev->var.xoffset = var->xoffset;
+		dev->var.yoffset = var->yoffset;
+		/* a pending pan not latched yet just gets replaced */
+		memfb_update_scanout(dev, memfb_now());
+		dev->pan_yoffset = var->yoffset;
+		dev->pan_ns = memfb_now();
+		dev->pan_pending = 1;
+		dev->pans++;
+		return 0;
+
+	case FBIOBLANK:
+		return 0;
+
+	case OMAPFB_QUERY_PLANE:
+		memcpy(arg, &dev->pi, sizeof(dev->pi));
+		return 0;
+
+	case OMAPFB_SETUP_PLANE:
+		pi = arg;
+		/* DSS scaler limits, roughly */
+		if (pi->enabled && (pi->out_width == 0 || pi->out_height == 0
+		    || pi->pos_x + pi->out_width > memfb.w
+		    || pi->pos_y + pi->out_height > memfb.h
+		    || pi->out_width * 4 < dev->var.xres
+		    || pi->out_height * 4 < dev->var.yres
+		    || pi->out_width > dev->var.xres * 8
+		    || pi->out_height > dev->var.yres * 8))
+			break;
+		dev->pi = *pi;
+		return 0;
+
+	case OMAPFB_QUERY_MEM:
+		memcpy(arg, &dev->mi, sizeof(dev->mi));
+		return 0;
+
+	case OMAPFB_SETUP_MEM:
+		mi = arg;
+		if (mi->size > MEMFB_VRAM_MAX) {
+			errno = ENOMEM;
+			return -1;
+		}
+		if (ftruncate(dev->mem_fd, mi->size) != 0)
+			return -1;
+		dev->mi = *mi;
+		return 0;
+
+	default:
+		errno = ENOTTY;
+		return -1;
+	}
+
+	errno = EINVAL;
+	return -1;
+}
+
+int memfb_ioctl(int fd, unsigned long request, ...)
+{
+	struct memfb_dev *dev;
+	void *arg = NULL;
+	int blank = 0;
+	va_list ap;
+	int ret;
+
+	/* FBIOBLANK takes an int, everything else here a pointer */
+	va_start(ap, request);
+	if (request == FBIOBLANK)
+		blank = va_arg(ap, int);
+	else
+		arg = va_arg(ap, void *);
+	va_end(ap);
+
+	pthread_mutex_lock(&memfb.lock);
+	dev = memfb_lookup(fd);
+	if (dev == NULL) {
+		pthread_mutex_unlock(&memfb.lock);
+		if (request == FBIOBLANK)
+			return ioctl(fd, request, blank);
+		return ioctl(fd, request, arg);
+	}
+
+	if (request == FBIO_WAITFORVSYNC || request == OMAPFB_WAITFORVSYNC) {
+		pthread_mutex_unlock(&memfb.lock);
+		return memfb_wait_vsync(dev);
+	}
+
+	ret = memfb_do_ioctl(dev, request, arg);
+	pthread_mutex_unlock(&memfb.lock);
+	return ret;
+}
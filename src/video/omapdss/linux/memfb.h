@@ -0,0 +1,9 @@
+/* Memory-backed stand-in for fbdev/omapfb devices.
+ * Device names of form "mem[N][:WxH[@hz]]" (N = 0..3, each one an
+ * overlay sharing the display) get a fake framebuffer backed by
+ * a temporary file with simulated vsync timing, anything else is passed
+ * through to the real open/ioctl/close calls. */
+
+int  memfb_open(const char *name, int flags);
+int  memfb_ioctl(int fd, unsigned long request, ...);
+int  memfb_close(int fd);
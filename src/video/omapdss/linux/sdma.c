@@ -0,0 +1,307 @@
+/*
+ * (C) Gražvydas "notaz" Ignotas, 2012
+ *
+ * This work is licensed under the terms of any of these licenses
+ * (at your option):
+ *  - GNU GPL, version 2 or later.
+ *  - GNU LGPL, version 2.1 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ * OMAP3 system DMA driven from userspace through /dev/mem, for copies
+ * and fills within VRAM (physically contiguous). There is no kernel
+ * interface for this, so one logical channel (31 by default, the kernel
+ * allocates from 0 up) is borrowed for the whole session. Needs root.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../osdl.h"
+
+#define PFX "sdma: "
+
+#define SDMA_BASE	0x48056000
+#define SDMA_SIZE	0x1000
+
+#define SDMA_REVISION	0x00
+#define SDMA_CH(ch, r)	(0x80 + 0x60 * (ch) + (r))
+#define CCR		0x00
+#define CLNK_CTRL	0x04
+#define CICR		0x08
+#define CSR		0x0c
+#define CSDP		0x10
+#define CEN		0x14
+#define CFN		0x18
+#define CSSA		0x1c
+#define CDSA		0x20
+#define CSEI		0x24
+#define CSFI		0x28
+#define CDEI		0x2c
+#define CDFI		0x30
+#define COLOR		0x44
+
+#define CCR_ENABLE		(1 << 7)
+#define CCR_RD_ACTIVE		(1 << 9)
+#define CCR_WR_ACTIVE		(1 << 10)
+#define CCR_SRC_AMODE_DIDX	(3 << 12)
+#define CCR_DST_AMODE_DIDX	(3 << 14)
+#define CCR_CONST_FILL		(1 << 16)
+
+#define CSDP_SRC_PACKED		(1 << 6)
+#define CSDP_SRC_BURST64	(3 << 7)
+#define CSDP_DST_PACKED		(1 << 13)
+#define CSDP_DST_BURST64	(3 << 14)
+#define CSDP_WRITE_POSTED	(1 << 16)
+
+#define SDMA_TIMEOUT_MS	500
+
+struct sdma {
+	int memfd;
+	volatile unsigned int *regs;
+	int ch;
+	int busy;
+};
+
+static inline unsigned int sdma_read(struct sdma *s, int reg)
+{
+	return s->regs[SDMA_CH(s->ch, reg) / 4];
+}
+
+static inline void sdma_write(struct sdma *s, int reg, unsigned int val)
+{
+	s->regs[SDMA_CH(s->ch, reg) / 4] = val;
+}
+
+/* CPU writes to write-combined VRAM must land before DMA reads it */
+static inline void sdma_barrier(void)
+{
+#if defined(__arm__) && defined(__ARM_ARCH_7A__)
+	asm volatile("dsb" ::: "memory");
+#else
+	__sync_synchronize();
+#endif
+}
+
+/* only Cortex-A8 based OMAPs have sDMA at this address */
+static int sdma_check_soc(void)
+{
+	char buf[256];
+	struct stat st;
+	int found = 0;
+	FILE *f;
+
+	if (stat("/sys/devices/platform/omapdss", &st) != 0)
+		return -1;
+
+	f = fopen("/proc/cpuinfo", "r");
+	if (f == NULL)
+		return -1;
+	while (fgets(buf, sizeof(buf), f) != NULL) {
+		if (strncmp(buf, "CPU part", 8) == 0 && strstr(buf, "0xc08")) {
+			found = 1;
+			break;
+		}
+	}
+	fclose(f);
+
+	return found ? 0 : -1;
+}
+
+static void *sdma_init(void)
+{
+	const char *tmp;
+	struct sdma *s;
+	void *regs;
+
+	if (sdma_check_soc() != 0) {
+		err(PFX "not an OMAP3");
+		return NULL;
+	}
+
+	s = calloc(1, sizeof(*s));
+	if (s == NULL)
+		return NULL;
+
+	s->ch = 31;
+	tmp = getenv("SDL_OMAP_SDMA_CHANNEL");
+	if (tmp != NULL)
+		s->ch = strtol(tmp, NULL, 0);
+	if (s->ch < 0 || s->ch > 31) {
+		err(PFX "bad channel %d", s->ch);
+		goto fail;
+	}
+
+	s->memfd = open("/dev/mem", O_RDWR | O_SYNC);
+	if (s->memfd == -1) {
+		err_perror(PFX "open /dev/mem");
+		goto fail;
+	}
+
+	regs = mmap(0, SDMA_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED,
+		s->memfd, SDMA_BASE);
+	if (regs == MAP_FAILED) {
+		err_perror(PFX "mmap");
+		goto fail_close;
+	}
+	s->regs = regs;
+
+	if ((s->regs[SDMA_REVISION / 4] & 0xff) != 0x40) {
+		err(PFX "unexpected revision %08x", s->regs[SDMA_REVISION / 4]);
+		goto fail_unmap;
+	}
+	if (sdma_read(s, CCR) & CCR_ENABLE) {
+		err(PFX "channel %d is in use", s->ch);
+		goto fail_unmap;
+	}
+
+	sdma_write(s, CICR, 0);
+	sdma_write(s, CLNK_CTRL, 0);
+	sdma_write(s, CSR, ~0);
+	return s;
+
+fail_unmap:
+	munmap(regs, SDMA_SIZE);
+fail_close:
+	close(s->memfd);
+fail:
+	free(s);
+	return NULL;
+}
+
+static void sdma_wait(struct sdma *s)
+{
+	struct timespec t0, t;
+	unsigned int i;
+
+	if (!s->busy)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for (i = 1; ; i++) {
+		if (!(sdma_read(s, CCR) & (CCR_ENABLE | CCR_RD_ACTIVE | CCR_WR_ACTIVE)))
+			break;
+		if ((i & 0xfff) == 0) {
+			clock_gettime(CLOCK_MONOTONIC, &t);
+			if ((t.tv_sec - t0.tv_sec) * 1000
+			    + (t.tv_nsec - t0.tv_nsec) / 1000000 > SDMA_TIMEOUT_MS) {
+				err(PFX "timeout, CCR %08x CSR %08x",
+					sdma_read(s, CCR), sdma_read(s, CSR));
+				sdma_write(s, CCR, 0);
+				break;
+			}
+		}
+	}
+
+	sdma_write(s, CSR, ~0);
+	s->busy = 0;
+}
+
+static void sdma_start(struct sdma *s, unsigned int ccr)
+{
+	sdma_barrier();
+	sdma_write(s, CCR, ccr);
+	sdma_write(s, CCR, ccr | CCR_ENABLE);
+	s->busy = 1;
+}
+
+/* widest element that keeps everything aligned */
+static int sdma_data_type(unsigned long v)
+{
+	if ((v & 3) == 0)
+		return 2;
+	if ((v & 1) == 0)
+		return 1;
+	return 0;
+}
+
+static int sdma_copy(void *priv, const struct osdl_accel_buf *dst,
+	const struct osdl_accel_buf *src, int w_bytes, int h)
+{
+	struct sdma *s = priv;
+	int dt, es;
+
+	if (dst->phys == 0 || src->phys == 0)
+		return -1;
+
+	dt = sdma_data_type(dst->phys | src->phys | w_bytes
+		| dst->pitch | src->pitch);
+	es = 1 << dt;
+
+	/* one transfer in flight, the channel is reprogrammed for the next */
+	sdma_wait(s);
+
+	sdma_write(s, CSDP, dt | CSDP_SRC_PACKED | CSDP_SRC_BURST64
+		| CSDP_DST_PACKED | CSDP_DST_BURST64 | CSDP_WRITE_POSTED);
+	sdma_write(s, CEN, w_bytes / es);
+	sdma_write(s, CFN, h);
+	sdma_write(s, CSSA, src->phys);
+	sdma_write(s, CDSA, dst->phys);
+	sdma_write(s, CSEI, 1);
+	sdma_write(s, CSFI, src->pitch - w_bytes + 1);
+	sdma_write(s, CDEI, 1);
+	sdma_write(s, CDFI, dst->pitch - w_bytes + 1);
+	sdma_start(s, CCR_SRC_AMODE_DIDX | CCR_DST_AMODE_DIDX);
+
+	return 0;
+}
+
+static int sdma_fill(void *priv, const struct osdl_accel_buf *dst,
+	int w, int h, int Bpp, unsigned int color)
+{
+	struct sdma *s = priv;
+	int dt;
+
+	if (dst->phys == 0 || Bpp == 3)
+		return -1;
+
+	dt = Bpp >> 1;
+	if (sdma_data_type(dst->phys | dst->pitch) < dt)
+		return -1;
+
+	sdma_wait(s);
+
+	sdma_write(s, CSDP, dt | CSDP_DST_PACKED | CSDP_DST_BURST64
+		| CSDP_WRITE_POSTED);
+	sdma_write(s, CEN, w);
+	sdma_write(s, CFN, h);
+	sdma_write(s, CSSA, dst->phys);
+	sdma_write(s, CDSA, dst->phys);
+	sdma_write(s, COLOR, color);
+	sdma_write(s, CDEI, 1);
+	sdma_write(s, CDFI, dst->pitch - w * Bpp + 1);
+	sdma_start(s, CCR_DST_AMODE_DIDX | CCR_CONST_FILL);
+
+	return 0;
+}
+
+static void sdma_sync(void *priv)
+{
+	sdma_wait(priv);
+}
+
+static void sdma_finish(void *priv)
+{
+	struct sdma *s = priv;
+
+	sdma_wait(s);
+	sdma_write(s, CCR, 0);
+	munmap((void *)s->regs, SDMA_SIZE);
+	close(s->memfd);
+	free(s);
+}
+
+const struct osdl_accel_ops sdma_accel_ops = {
+	"sdma",
+	sdma_init,
+	sdma_copy,
+	sdma_fill,
+	sdma_sync,
+	sdma_finish,
+};
@@ -26,6 +26,12 @@
 #endif
 
 struct x11reuse_context;
+struct osdl_yuv;
+struct osdl_vram;
+struct osdl_vram_block;
+struct osdl_accel;
+struct osdl_workers;
+struct osdl_stats;
 
 struct SDL_PrivateVideoData {
 	struct vout_fbdev *fbdev;
@@ -39,16 +45,48 @@ struct SDL_PrivateVideoData {
 	int border_l, border_r, border_t, border_b;
 	/* phys -> layer coord multipliers (16.16) */
 	int ts_xmul, ts_ymul;
+	/* UpdateRects damage map, one byte per tile */
+	unsigned char *dirty_map;
+	int dirty_cols, dirty_rows;
+	/* hardware YUV overlay, if one is created */
+	struct osdl_yuv *yuv;
+	/* spare VRAM after the framebuffers, for hw surfaces */
+	void *vram_mem;
+	size_t vram_size, vram_offs;
+	void *vram_saved;
+	struct osdl_vram *vram;
+	/* physical address of the framebuffer memory, 0 if unknown */
+	unsigned long fb_phys;
+	struct osdl_accel *accel;
+	/* 8bpp mode: app draws to clut_pixels, which get expanded
+	 * through the palette straight to the framebuffer */
+	void *clut_pixels;
+	void *clut_back;
+	int clut_bpp, clut_pitch;
+	unsigned short clut_lut16[256];
+	unsigned int clut_lut32[256];
+	/* extra threads for big copies */
+	struct osdl_workers *workers;
+	/* frame timing stats, NULL when not collecting */
+	struct osdl_stats *stats;
+	unsigned int vsync_period_us;
 	/* misc/config */
 	struct x11reuse_context *x11reuse_context;
 	unsigned int xenv_up:1;
 	unsigned int xenv_mouse:1;
 	unsigned int app_uses_flip:1;
+	unsigned int async_flip:1;
 	unsigned int cfg_force_vsync:1;
 	unsigned int cfg_force_doublebuf:1;
 	unsigned int cfg_force_directbuf:1;
 	unsigned int cfg_no_ts_translate:1;
 	unsigned int cfg_ts_force_tslib:1;
+	unsigned int cfg_async_flip:1;
+	int cfg_vram_surfaces_kb;
+	int cfg_accel;
+	int cfg_clut_bpp;
+	int cfg_threads;
+	int cfg_stats;
 	/* delayed icon surface */
 	struct SDL_Surface *delayed_icon;
 	void *delayed_icon_mask;
@@ -64,6 +102,98 @@ int   osdl_video_detect_screen(struct SDL_PrivateVideoData *pdata);
 int   osdl_video_pause(struct SDL_PrivateVideoData *pdata, int is_pause);
 int   osdl_video_get_window(void **display, int *screen, void **window);
 void  osdl_video_finish(struct SDL_PrivateVideoData *pdata);
+unsigned long osdl_video_phys_addr(struct SDL_PrivateVideoData *pdata,
+		const void *ptr);
+void  osdl_video_set_stats(struct SDL_PrivateVideoData *pdata,
+		struct osdl_stats *stats);
+
+struct osdl_yuv *osdl_yuv_create(struct SDL_PrivateVideoData *pdata,
+		int width, int height, int uyvy, void **pixels, int *pitch);
+int   osdl_yuv_display(struct SDL_PrivateVideoData *pdata, struct osdl_yuv *yuv,
+		int src_x, int src_y, int src_w, int src_h,
+		int out_x, int out_y, int out_w, int out_h);
+void  osdl_yuv_destroy(struct SDL_PrivateVideoData *pdata, struct osdl_yuv *yuv);
+
+struct osdl_vram *osdl_vram_init(void *base, size_t size,
+		void (*relocate)(void *owner, void *base));
+struct osdl_vram_block *osdl_vram_alloc(struct osdl_vram *vram, size_t size,
+		void *owner, void **base);
+void  osdl_vram_free(struct osdl_vram *vram, struct osdl_vram_block *block);
+void  osdl_vram_pin(struct osdl_vram_block *block, int pin);
+size_t osdl_vram_avail(struct osdl_vram *vram, size_t *total);
+void  osdl_vram_rebase(struct osdl_vram *vram, void *base);
+void  osdl_vram_finish(struct osdl_vram *vram,
+		void (*evict)(void *owner, void *base, size_t size));
+
+/* blit/fill offload */
+enum osdl_accel_type {
+	OSDL_ACCEL_NONE = 0,
+	OSDL_ACCEL_CPU,
+	OSDL_ACCEL_SDMA,
+};
+
+struct osdl_accel_buf {
+	void *virt;
+	unsigned long phys;	/* 0 if not physically contiguous */
+	int pitch;
+};
+
+struct osdl_accel_ops {
+	const char *name;
+	void *(*init)(void);
+	/* non-zero return means caller must do it with the CPU */
+	int  (*copy)(void *priv, const struct osdl_accel_buf *dst,
+		const struct osdl_accel_buf *src, int w_bytes, int h);
+	int  (*fill)(void *priv, const struct osdl_accel_buf *dst,
+		int w, int h, int Bpp, unsigned int color);
+	void (*sync)(void *priv);
+	void (*finish)(void *priv);
+};
+
+extern const struct osdl_accel_ops sdma_accel_ops;
+
+struct osdl_accel *osdl_accel_init(int type);
+int   osdl_accel_copy(struct osdl_accel *accel, const struct osdl_accel_buf *dst,
+		const struct osdl_accel_buf *src, int w_bytes, int h);
+int   osdl_accel_fill(struct osdl_accel *accel, const struct osdl_accel_buf *dst,
+		int w, int h, int Bpp, unsigned int color);
+void  osdl_accel_sync(struct osdl_accel *accel);
+void  osdl_accel_frame(struct osdl_accel *accel);
+unsigned int osdl_accel_frame_bytes(struct osdl_accel *accel);
+void  osdl_accel_finish(struct osdl_accel *accel);
+void  osdl_fill(void *dst, int pitch, int w, int h, int Bpp, unsigned int color);
+
+struct osdl_workers *osdl_workers_init(int count);
+int   osdl_workers_count(struct osdl_workers *w);
+void  osdl_workers_run(struct osdl_workers *w,
+		void (*func)(void *arg, int band, int bands), void *arg, int bands);
+void  osdl_workers_finish(struct osdl_workers *w);
+
+/* frame timing stats */
+#define OSDL_STATS_HIST 16	/* flip -> vsync latency, 2ms buckets */
+#define OSDL_STATS_LOG  32	/* recent frame timestamps */
+
+struct osdl_stats_info {
+	unsigned int frames;
+	unsigned int missed_vblanks;
+	unsigned int frame_us_last, frame_us_avg, frame_us_max;
+	unsigned int flip_us_avg, flip_us_max;
+	unsigned int copy_us_avg, copy_us_max;
+	unsigned int copy_bytes_last, copy_bytes_avg;
+	unsigned int latency_hist[OSDL_STATS_HIST];
+	unsigned long long frame_time_us[OSDL_STATS_LOG];	/* oldest first */
+};
+
+struct osdl_stats *osdl_stats_init(int dump_interval);
+void  osdl_stats_set_period(struct osdl_stats *stats, unsigned int period_us);
+unsigned long long osdl_stats_begin(struct osdl_stats *stats);
+void  osdl_stats_copy(struct osdl_stats *stats, unsigned long long t_begin,
+		unsigned int bytes);
+void  osdl_stats_flip(struct osdl_stats *stats, unsigned long long t_begin);
+void  osdl_stats_latency(struct osdl_stats *stats, unsigned int us);
+void  osdl_stats_frame(struct osdl_stats *stats);
+void  osdl_stats_get(struct osdl_stats *stats, struct osdl_stats_info *info);
+void  osdl_stats_finish(struct osdl_stats *stats);
 
 void omapsdl_input_init(void);
 void omapsdl_input_bind(const char *kname, const char *sdlname);
@@ -76,6 +206,22 @@ void omapsdl_input_finish(void);
 void omapsdl_config(struct SDL_PrivateVideoData *pdata);
 void omapsdl_config_from_env(struct SDL_PrivateVideoData *pdata);
 
+/* shadow -> framebuffer copy */
+#ifdef __ARM_NEON__
+void neon_fbcopy(void *dst, const void *src, size_t size);
+#define fbcopy neon_fbcopy
+#else
+#define fbcopy memcpy
+#endif
+
+/* 8bpp palette expansion, count is in pixels */
+#ifdef __ARM_NEON__
+void neon_clut8to16(void *dst, const void *src, const unsigned short *lut, int count);
+void neon_clut8to32(void *dst, const void *src, const unsigned int *lut, int count);
+#define clut8to16 neon_clut8to16
+#define clut8to32 neon_clut8to32
+#endif
+
 /* functions for standalone */
 void do_clut(void *dest, void *src, unsigned short *pal, int count);
 
@@ -0,0 +1,355 @@
+/*
+ * (C) Gražvydas "notaz" Ignotas, 2012
+ *
+ * This work is licensed under the terms of the GNU LGPL, version 2.1 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ * Blit/fill offload. Backends queue copies and fills and run them
+ * asynchronously, the caller must osdl_accel_sync() before touching
+ * affected memory with the CPU. The "cpu" backend does the work on a
+ * worker thread and is mostly there to test things without hardware.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "osdl.h"
+
+struct osdl_accel {
+	const struct osdl_accel_ops *ops;
+	void *priv;
+	int busy;
+	/* stats */
+	unsigned int frames, ops_done, ops_failed, syncs;
+	unsigned long long bytes_total;
+	unsigned int bytes_frame, bytes_last, bytes_peak;
+};
+
+void osdl_fill(void *dst, int pitch, int w, int h, int Bpp, unsigned int color)
+{
+	unsigned char *row = dst;
+	int x, y;
+
+	for (y = 0; y < h; y++, row += pitch) {
+		switch (Bpp) {
+		case 1:
+			memset(row, color, w);
+			break;
+		case 2: {
+			uint16_t *p = (uint16_t *)row;
+			uint32_t c32 = (color & 0xffff) | (color << 16);
+			x = w;
+			if (((uintptr_t)p & 2) && x > 0) {
+				*p++ = color;
+				x--;
+			}
+			for (; x >= 2; x -= 2, p += 2)
+				*(uint32_t *)p = c32;
+			if (x)
+				*p = color;
+			break;
+		}
+		case 3:
+			for (x = 0; x < w * 3; x += 3) {
+				row[x + 0] = color;
+				row[x + 1] = color >> 8;
+				row[x + 2] = color >> 16;
+			}
+			break;
+		case 4: {
+			uint32_t *p = (uint32_t *)row;
+			for (x = 0; x < w; x++)
+				p[x] = color;
+			break;
+		}
+		}
+	}
+}
+
+static void cpu_copy(const struct osdl_accel_buf *dst,
+	const struct osdl_accel_buf *src, int w_bytes, int h)
+{
+	char *d = dst->virt;
+	const char *s = src->virt;
+
+	if (dst->pitch == w_bytes && src->pitch == w_bytes) {
+		fbcopy(d, s, w_bytes * h);
+		return;
+	}
+
+	for (; h > 0; h--, d += dst->pitch, s += src->pitch)
+		fbcopy(d, s, w_bytes);
+}
+
+/* cpu backend */
+
+#define CPU_QUEUE_LEN 64
+
+struct cpu_op {
+	struct osdl_accel_buf dst, src;
+	int w, h, Bpp;
+	unsigned int color;
+	int is_fill;
+};
+
+struct cpu_accel {
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond_work;
+	pthread_cond_t cond_done;
+	struct cpu_op ops[CPU_QUEUE_LEN];
+	unsigned int head, tail;	/* tail is being worked on */
+	int quit;
+};
+
+static void *cpu_accel_thread(void *arg)
+{
+	struct cpu_accel *ca = arg;
+	struct cpu_op *op;
+
+	pthread_mutex_lock(&ca->mutex);
+	for (;;) {
+		while (ca->head == ca->tail && !ca->quit)
+			pthread_cond_wait(&ca->cond_work, &ca->mutex);
+		if (ca->head == ca->tail)
+			break;
+
+		op = &ca->ops[ca->tail % CPU_QUEUE_LEN];
+		pthread_mutex_unlock(&ca->mutex);
+
+		if (op->is_fill)
+			osdl_fill(op->dst.virt, op->dst.pitch, op->w, op->h,
+				op->Bpp, op->color);
+		else
+			cpu_copy(&op->dst, &op->src, op->w, op->h);
+
+		pthread_mutex_lock(&ca->mutex);
+		ca->tail++;
+		pthread_cond_broadcast(&ca->cond_done);
+	}
+	pthread_mutex_unlock(&ca->mutex);
+
+	return NULL;
+}
+
+static void *cpu_accel_init(void)
+{
+	struct cpu_accel *ca;
+	int ret;
+
+	ca = calloc(1, sizeof(*ca));
+	if (ca == NULL)
+		return NULL;
+
+	pthread_mutex_init(&ca->mutex, NULL);
+	pthread_cond_init(&ca->cond_work, NULL);
+	pthread_cond_init(&ca->cond_done, NULL);
+
+	ret = pthread_create(&ca->thread, NULL, cpu_accel_thread, ca);
+	if (ret != 0) {
+		err("accel: pthread_create: %d", ret);
+		free(ca);
+		return NULL;
+	}
+
+	return ca;
+}
+
+static void cpu_accel_queue(struct cpu_accel *ca, const struct cpu_op *op)
+{
+	pthread_mutex_lock(&ca->mutex);
+	while (ca->head - ca->tail >= CPU_QUEUE_LEN)
+		pthread_cond_wait(&ca->cond_done, &ca->mutex);
+	ca->ops[ca->head % CPU_QUEUE_LEN] = *op;
+	ca->head++;
+	pthread_cond_signal(&ca->cond_work);
+	pthread_mutex_unlock(&ca->mutex);
+}
+
+static int cpu_accel_copy(void *priv, const struct osdl_accel_buf *dst,
+	const struct osdl_accel_buf *src, int w_bytes, int h)
+{
+	struct cpu_op op;
+
+	memset(&op, 0, sizeof(op));
+	op.dst = *dst;
+	op.src = *src;
+	op.w = w_bytes;
+	op.h = h;
+	cpu_accel_queue(priv, &op);
+	return 0;
+}
+
+static int cpu_accel_fill(void *priv, const struct osdl_accel_buf *dst,
+	int w, int h, int Bpp, unsigned int color)
+{
+	struct cpu_op op;
+
+	memset(&op, 0, sizeof(op));
+	op.dst = *dst;
+	op.w = w;
+	op.h = h;
+	op.Bpp = Bpp;
+	op.color = color;
+	op.is_fill = 1;
+	cpu_accel_queue(priv, &op);
+	return 0;
+}
+
+static void cpu_accel_sync(void *priv)
+{
+	struct cpu_accel *ca = priv;
+
+	pthread_mutex_lock(&ca->mutex);
+	while (ca->head != ca->tail)
+		pthread_cond_wait(&ca->cond_done, &ca->mutex);
+	pthread_mutex_unlock(&ca->mutex);
+}
+
+static void cpu_accel_finish(void *priv)
+{
+	struct cpu_accel *ca = priv;
+
+	pthread_mutex_lock(&ca->mutex);
+	ca->quit = 1;
+	pthread_cond_signal(&ca->cond_work);
+	pthread_mutex_unlock(&ca->mutex);
+	pthread_join(ca->thread, NULL);
+
+	pthread_cond_destroy(&ca->cond_done);
+	pthread_cond_destroy(&ca->cond_work);
+	pthread_mutex_destroy(&ca->mutex);
+	free(ca);
+}
+
+static const struct osdl_accel_ops cpu_accel_ops = {
+	"cpu",
+	cpu_accel_init,
+	cpu_accel_copy,
+	cpu_accel_fill,
+	cpu_accel_sync,
+	cpu_accel_finish,
+};
+
+/* common */
+
+struct osdl_accel *osdl_accel_init(int type)
+{
+	const struct osdl_accel_ops *ops;
+	struct osdl_accel *accel;
+
+	switch (type) {
+	case OSDL_ACCEL_CPU:
+		ops = &cpu_accel_ops;
+		break;
+	case OSDL_ACCEL_SDMA:
+		ops = &sdma_accel_ops;
+		break;
+	default:
+		return NULL;
+	}
+
+	accel = calloc(1, sizeof(*accel));
+	if (accel == NULL)
+		return NULL;
+
+	accel->ops = ops;
+	accel->priv = ops->init();
+	if (accel->priv == NULL) {
+		err("accel: %s backend unavailable", ops->name);
+		free(accel);
+		return NULL;
+	}
+
+	log("accel: using %s backend", ops->name);
+	return accel;
+}
+
+int osdl_accel_copy(struct osdl_accel *accel, const struct osdl_accel_buf *dst,
+	const struct osdl_accel_buf *src, int w_bytes, int h)
+{
+	int ret;
+
+	if (accel == NULL || w_bytes <= 0 || h <= 0)
+		return -1;
+
+	ret = accel->ops->copy(accel->priv, dst, src, w_bytes, h);
+	if (ret != 0) {
+		accel->ops_failed++;
+		return ret;
+	}
+
+	accel->busy = 1;
+	accel->ops_done++;
+	accel->bytes_frame += w_bytes * h;
+	return 0;
+}
+
+int osdl_accel_fill(struct osdl_accel *accel, const struct osdl_accel_buf *dst,
+	int w, int h, int Bpp, unsigned int color)
+{
+	int ret;
+
+	if (accel == NULL || w <= 0 || h <= 0)
+		return -1;
+
+	ret = accel->ops->fill(accel->priv, dst, w, h, Bpp, color);
+	if (ret != 0) {
+		accel->ops_failed++;
+		return ret;
+	}
+
+	accel->busy = 1;
+	accel->ops_done++;
+	accel->bytes_frame += w * h * Bpp;
+	return 0;
+}
+
+void osdl_accel_sync(struct osdl_accel *accel)
+{
+	if (accel == NULL || !accel->busy)
+		return;
+
+	accel->ops->sync(accel->priv);
+	accel->busy = 0;
+	accel->syncs++;
+}
+
+/* frame boundary, for per-frame offload stats */
+void osdl_accel_frame(struct osdl_accel *accel)
+{
+	if (accel == NULL)
+		return;
+
+	accel->frames++;
+	accel->bytes_total += accel->bytes_frame;
+	accel->bytes_last = accel->bytes_frame;
+	if (accel->bytes_frame > accel->bytes_peak)
+		accel->bytes_peak = accel->bytes_frame;
+	accel->bytes_frame = 0;
+}
+
+unsigned int osdl_accel_frame_bytes(struct osdl_accel *accel)
+{
+	return accel != NULL ? accel->bytes_last : 0;
+}
+
+void osdl_accel_finish(struct osdl_accel *accel)
+{
+	if (accel == NULL)
+		return;
+
+	osdl_accel_sync(accel);
+	accel->ops->finish(accel->priv);
+
+	if (accel->frames)
+		log("accel %s: %u frames, %llu KiB/frame offloaded (peak %u), "
+			"%u ops, %u fallbacks, %u syncs", accel->ops->name,
+			accel->frames, accel->bytes_total / 1024 / accel->frames,
+			accel->bytes_peak / 1024, accel->ops_done,
+			accel->ops_failed, accel->syncs);
+	free(accel);
+}
@@ -10,6 +10,8 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
 #include <unistd.h>
 #include <time.h>
 #include <errno.h>
@@ -25,10 +27,24 @@
 
 #include "osdl.h"
 
+#define EVDEV_MAX_DEVS	32
+#define EVDEV_BATCH	64
+
+struct osdl_evdev {
+	int fd;
+	ino_t ino;
+	int num;	/* N of /dev/input/eventN, -1 for ts */
+	/* events read but not yet handed out, a callback can stop early */
+	struct input_event buf[EVDEV_BATCH];
+	int buf_pos, buf_cnt;
+};
+
 /* XXX: these should go to private data */
-static int osdl_evdev_devs[32];
+static struct osdl_evdev *osdl_evdev_devs[EVDEV_MAX_DEVS];
 static int osdl_evdev_dev_count;
-static int osdl_tslib_fd;
+static int osdl_epoll_fd = -1;
+static int osdl_inotify_fd = -1;
+static int osdl_tslib_fd = -1;
 static struct tsdev *osdl_tslib_dev;
 
 static short osdl_evdev_map[KEY_CNT] = {
@@ -447,125 +463,317 @@ bad_sdlkey:
 #define KEYBITS_BIT(keybits, x) (keybits[(x)/sizeof(keybits[0])/8] & \
 	(1 << ((x) & (sizeof(keybits[0])*8-1))))
 
-void omapsdl_input_init(void)
+static struct osdl_evdev *evdev_add(int fd, int num)
 {
-	long keybits[KEY_CNT / sizeof(long) / 8];
-	ino_t touchscreen_ino = (ino_t)-1;
+	struct osdl_evdev *dev;
+	struct epoll_event ee;
 	struct stat stat_buf;
+
+	if (osdl_evdev_dev_count >= EVDEV_MAX_DEVS) {
+		err("in_evdev: too many devices");
+		return NULL;
+	}
+
+	dev = calloc(1, sizeof(*dev));
+	if (dev == NULL)
+		return NULL;
+	dev->fd = fd;
+	dev->num = num;
+	dev->ino = (ino_t)-1;
+	if (fstat(fd, &stat_buf) == 0)
+		dev->ino = stat_buf.st_ino;
+
+	if (osdl_epoll_fd != -1) {
+		memset(&ee, 0, sizeof(ee));
+		ee.events = EPOLLIN;
+		ee.data.ptr = dev;
+		if (epoll_ctl(osdl_epoll_fd, EPOLL_CTL_ADD, fd, &ee) == -1) {
+			err_perror("in_evdev: epoll_ctl");
+			free(dev);
+			return NULL;
+		}
+	}
+
+	osdl_evdev_devs[osdl_evdev_dev_count++] = dev;
+	return dev;
+}
+
+static void evdev_remove(struct osdl_evdev *dev)
+{
 	int i;
 
-#if SDL_INPUT_TSLIB
-	/* start with touchscreen so that we can skip it later */
-	osdl_tslib_dev = ts_open(SDL_getenv("TSLIB_TSDEVICE"), 1);
-	if (ts_config(osdl_tslib_dev) < 0) {
-		ts_close(osdl_tslib_dev);
-		osdl_tslib_dev = NULL;
+	for (i = 0; i < osdl_evdev_dev_count; i++)
+		if (osdl_evdev_devs[i] == dev)
+			break;
+	if (i >= osdl_evdev_dev_count)
+		return;
+
+	osdl_evdev_dev_count--;
+	memmove(&osdl_evdev_devs[i], &osdl_evdev_devs[i + 1],
+		(osdl_evdev_dev_count - i) * sizeof(osdl_evdev_devs[0]));
+
+	if (osdl_epoll_fd != -1)
+		epoll_ctl(osdl_epoll_fd, EPOLL_CTL_DEL, dev->fd, NULL);
+	if (dev->fd != osdl_tslib_fd)
+		close(dev->fd);
+	free(dev);
+}
+
+/* opens /dev/input/eventN if it's a key device we don't have yet,
+ * returns -1 if the scan should stop */
+static int evdev_open(int num)
+{
+	long keybits[KEY_CNT / sizeof(long) / 8];
+	int support = 0, count = 0;
+	struct stat stat_buf;
+	int i, u, ret, fd;
+	char name[64];
+
+	snprintf(name, sizeof(name), "/dev/input/event%d", num);
+	fd = open(name, O_RDONLY|O_NONBLOCK);
+	if (fd == -1)
+		return errno == EACCES ? 0 : -1;	/* maybe we can access next one */
+
+	/* already open (as touchscreen or through hotplug) */
+	if (fstat(fd, &stat_buf) == -1)
+		err_perror("fstat");
+	else {
+		for (i = 0; i < osdl_evdev_dev_count; i++) {
+			if (osdl_evdev_devs[i]->ino != stat_buf.st_ino)
+				continue;
+			if (osdl_evdev_devs[i]->fd == osdl_tslib_fd)
+				log("skip %s as ts", name);
+			goto skip;
+		}
 	}
-	if (osdl_tslib_dev != NULL) {
-		osdl_tslib_fd = ts_fd(osdl_tslib_dev);
-		osdl_evdev_devs[osdl_evdev_dev_count++] = osdl_tslib_fd;
-		if (fstat(osdl_tslib_fd, &stat_buf) == -1)
-			err_perror("fstat ts");
-		else
-			touchscreen_ino = stat_buf.st_ino;
-		log("opened tslib touchscreen");
+
+	/* check supported events */
+	ret = ioctl(fd, EVIOCGBIT(0, sizeof(support)), &support);
+	if (ret == -1) {
+		err_perror("in_evdev: ioctl failed on %s", name);
+		goto skip;
 	}
-#endif
+
+	if (!(support & (1 << EV_KEY)))
+		goto skip;
 
 	/* the kernel might support and return less keys then we know about,
 	 * so make sure the buffer is clear. */
 	memset(keybits, 0, sizeof(keybits));
+	ret = ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keybits)), keybits);
+	if (ret == -1) {
+		err_perror("in_evdev: ioctl failed on %s", name);
+		goto skip;
+	}
 
-	for (i = 0;; i++)
-	{
-		int support = 0, count = 0;
-		int u, ret, fd;
-		char name[64];
-
-		snprintf(name, sizeof(name), "/dev/input/event%d", i);
-		fd = open(name, O_RDONLY|O_NONBLOCK);
-		if (fd == -1) {
-			if (errno == EACCES)
-				continue;	/* maybe we can access next one */
-			break;
+	/* check for interesting keys */
+	for (u = 0; u < KEY_CNT; u++) {
+		if (KEYBITS_BIT(keybits, u)) {
+			if (u != KEY_POWER && u != KEY_SLEEP && u != BTN_TOUCH)
+				count++;
 		}
+	}
 
-		/* touchscreen check */
-		if (touchscreen_ino != (dev_t)-1) {
-			if (fstat(fd, &stat_buf) == -1)
-				err_perror("fstat");
-			else if (touchscreen_ino == stat_buf.st_ino) {
-				log("skip %s as ts", name);
-				goto skip;
-			}
-		}
+	if (count == 0)
+		goto skip;
 
-		/* check supported events */
-		ret = ioctl(fd, EVIOCGBIT(0, sizeof(support)), &support);
-		if (ret == -1) {
-			err_perror("in_evdev: ioctl failed on %s", name);
-			goto skip;
-		}
+	if (evdev_add(fd, num) == NULL)
+		goto skip;
+	ioctl(fd, EVIOCGNAME(sizeof(name)), name);
+	log("in_evdev: found \"%s\" with %d events (type %08x)",
+		name, count, support);
+	return 1;
 
-		if (!(support & (1 << EV_KEY)))
-			goto skip;
+skip:
+	close(fd);
+	return 0;
+}
 
-		ret = ioctl(fd, EVIOCGBIT(EV_KEY, sizeof(keybits)), keybits);
-		if (ret == -1) {
-			err_perror("in_evdev: ioctl failed on %s", name);
-			goto skip;
+/* new nodes show up with IN_CREATE, but udev may only make them
+ * readable a bit later, so IN_ATTRIB is watched too */
+static void evdev_hotplug(void)
+{
+	char buf[1024] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ie;
+	int len, ofs, num;
+
+	while ((len = read(osdl_inotify_fd, buf, sizeof(buf))) > 0) {
+		for (ofs = 0; ofs < len; ofs += sizeof(*ie) + ie->len) {
+			ie = (const struct inotify_event *)(buf + ofs);
+			if (ie->len == 0 || (ie->mask & IN_ISDIR))
+				continue;
+			if (sscanf(ie->name, "event%d", &num) != 1)
+				continue;
+			if (ie->mask & (IN_CREATE | IN_ATTRIB))
+				evdev_open(num);
 		}
+	}
+}
 
-		/* check for interesting keys */
-		for (u = 0; u < KEY_CNT; u++) {
-			if (KEYBITS_BIT(keybits, u)) {
-				if (u != KEY_POWER && u != KEY_SLEEP && u != BTN_TOUCH)
-					count++;
-			}
-		}
+void omapsdl_input_init(void)
+{
+	int i;
 
-		if (count == 0)
-			goto skip;
+	osdl_epoll_fd = epoll_create(EVDEV_MAX_DEVS + 1);
+	if (osdl_epoll_fd == -1)
+		err_perror("in_evdev: epoll_create");
 
-		osdl_evdev_devs[osdl_evdev_dev_count++] = fd;
-		ioctl(fd, EVIOCGNAME(sizeof(name)), name);
-		log("in_evdev: found \"%s\" with %d events (type %08x)",
-			name, count, support);
-		continue;
+#if SDL_INPUT_TSLIB
+	/* start with touchscreen so that we can skip it later */
+	osdl_tslib_dev = ts_open(SDL_getenv("TSLIB_TSDEVICE"), 1);
+	if (ts_config(osdl_tslib_dev) < 0) {
+		ts_close(osdl_tslib_dev);
+		osdl_tslib_dev = NULL;
+	}
+	if (osdl_tslib_dev != NULL) {
+		osdl_tslib_fd = ts_fd(osdl_tslib_dev);
+		if (evdev_add(osdl_tslib_fd, -1) != NULL)
+			log("opened tslib touchscreen");
+	}
+#endif
 
-skip:
-		close(fd);
+	for (i = 0;; i++) {
+		if (evdev_open(i) < 0)
+			break;
 	}
 
 	log("found %d evdev device(s).", osdl_evdev_dev_count);
+
+	if (osdl_epoll_fd != -1) {
+		struct epoll_event ee;
+
+		osdl_inotify_fd = inotify_init();
+		if (osdl_inotify_fd != -1) {
+			fcntl(osdl_inotify_fd, F_SETFL, O_NONBLOCK);
+			memset(&ee, 0, sizeof(ee));
+			ee.events = EPOLLIN;
+			ee.data.ptr = NULL;
+			if (inotify_add_watch(osdl_inotify_fd, "/dev/input",
+			      IN_CREATE | IN_ATTRIB) == -1
+			    || epoll_ctl(osdl_epoll_fd, EPOLL_CTL_ADD,
+			      osdl_inotify_fd, &ee) == -1)
+			{
+				close(osdl_inotify_fd);
+				osdl_inotify_fd = -1;
+			}
+		}
+		if (osdl_inotify_fd == -1)
+			log("in_evdev: no hotplug");
+	}
 }
 
 void omapsdl_input_finish(void)
 {
-	int i;
+	while (osdl_evdev_dev_count > 0)
+		evdev_remove(osdl_evdev_devs[osdl_evdev_dev_count - 1]);
 
 #if SDL_INPUT_TSLIB
 	if (osdl_tslib_dev != NULL)
 		ts_close(osdl_tslib_dev);
 #endif
 	osdl_tslib_dev = NULL;
+	osdl_tslib_fd = -1;
+
+	if (osdl_inotify_fd != -1)
+		close(osdl_inotify_fd);
+	osdl_inotify_fd = -1;
+	if (osdl_epoll_fd != -1)
+		close(osdl_epoll_fd);
+	osdl_epoll_fd = -1;
+}
 
-	for (i = 0; i < osdl_evdev_dev_count; i++) {
-		if (osdl_evdev_devs[i] != osdl_tslib_fd)
-			close(osdl_evdev_devs[i]);
+/* hands out buffered events, reading more in batches;
+ * 0 when the device is drained, -2 if it went away */
+static int evdev_read(struct osdl_evdev *dev,
+		int (*key_cb)(void *cb_arg, int sdl_kc, int sdl_sc, int is_pressed),
+		void *cb_arg)
+{
+	const struct input_event *ev;
+	int ret, sdl_kc, more = 1;
+
+	while (1) {
+		if (dev->buf_pos >= dev->buf_cnt) {
+			if (!more)
+				return 0;
+			ret = read(dev->fd, dev->buf, sizeof(dev->buf));
+			if (ret < (int)sizeof(dev->buf[0])) {
+				if (ret == -1 && errno == EAGAIN)
+					return 0;
+				if (ret == -1 && errno == ENODEV)
+					return -2;
+				err_perror("in_evdev: read failed");
+				return -1;
+			}
+			dev->buf_cnt = ret / sizeof(dev->buf[0]);
+			dev->buf_pos = 0;
+			/* short read means the kernel queue is empty now */
+			more = ret == sizeof(dev->buf);
+		}
+
+		ev = &dev->buf[dev->buf_pos++];
+		if (ev->type != EV_KEY || key_cb == NULL)
+			continue; /* not key event or not needed */
+		if ((unsigned int)ev->value > 1)
+			continue; /* not key up/down */
+		if ((unsigned int)ev->code >= ARRAY_SIZE(osdl_evdev_map))
+			continue; /* keycode from future */
+		sdl_kc = osdl_evdev_map[ev->code];
+		if (sdl_kc == 0)
+			continue; /* not mapped */
+		/* scancode note: stock SDL doesn't do +8 in fbcon driver */
+		ret = key_cb(cb_arg, sdl_kc, ev->code + 8, ev->value);
+		if (ret != 0)
+			return ret;
 	}
-	osdl_evdev_dev_count = 0;
-	osdl_tslib_fd = 0;
 }
 
-int omapsdl_input_get_events(int timeout_ms,
+static int evdev_handle(struct osdl_evdev *dev,
 		int (*key_cb)(void *cb_arg, int sdl_kc, int sdl_sc, int is_pressed),
 		int (*ts_cb)(void *cb_arg, int x, int y, unsigned int pressure),
 		void *cb_arg)
+{
+	int ret;
+
+#if SDL_INPUT_TSLIB
+	if (dev->fd == osdl_tslib_fd && ts_cb != NULL) {
+		while (1) {
+			struct ts_sample tss;
+			ret = ts_read(osdl_tslib_dev, &tss, 1);
+			if (ret <= 0)
+				break;
+			ret = ts_cb(cb_arg, tss.x, tss.y, tss.pressure);
+			if (ret != 0)
+				return ret;
+		}
+		return 0;
+	}
+	/* else read below will consume the event, even if it's from ts */
+#endif
+
+	ret = evdev_read(dev, key_cb, cb_arg);
+	if (ret == -2) {
+		if (dev->num >= 0)
+			log("in_evdev: event%d removed", dev->num);
+		evdev_remove(dev);
+		ret = 0;
+	}
+	return ret;
+}
+
+static int evdev_ms_since(const struct timespec *t0)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (t.tv_sec - t0->tv_sec) * 1000
+		+ (t.tv_nsec - t0->tv_nsec) / 1000000;
+}
+
+/* select() fallback for when epoll is not there */
+static int evdev_wait_select(struct osdl_evdev **ready, int timeout_ms)
 {
 	struct timeval tv, *timeout = NULL;
-	struct input_event ev;
-	int i, fdmax = -1;
+	int i, n, ret, fdmax = -1;
 	fd_set fdset;
 
 	if (timeout_ms >= 0) {
@@ -576,69 +784,80 @@ int omapsdl_input_get_events(int timeout_ms,
 
 	FD_ZERO(&fdset);
 	for (i = 0; i < osdl_evdev_dev_count; i++) {
-		if (osdl_evdev_devs[i] > fdmax)
-			fdmax = osdl_evdev_devs[i];
-		FD_SET(osdl_evdev_devs[i], &fdset);
+		if (osdl_evdev_devs[i]->fd > fdmax)
+			fdmax = osdl_evdev_devs[i]->fd;
+		FD_SET(osdl_evdev_devs[i]->fd, &fdset);
+	}
+
+	ret = select(fdmax + 1, &fdset, NULL, NULL, timeout);
+	if (ret <= 0)
+		return ret;
+
+	for (i = n = 0; i < osdl_evdev_dev_count; i++)
+		if (FD_ISSET(osdl_evdev_devs[i]->fd, &fdset))
+			ready[n++] = osdl_evdev_devs[i];
+	return n;
+}
+
+int omapsdl_input_get_events(int timeout_ms,
+		int (*key_cb)(void *cb_arg, int sdl_kc, int sdl_sc, int is_pressed),
+		int (*ts_cb)(void *cb_arg, int x, int y, unsigned int pressure),
+		void *cb_arg)
+{
+	struct osdl_evdev *ready[EVDEV_MAX_DEVS + 1];
+	struct epoll_event ee[EVDEV_MAX_DEVS + 1];
+	struct timespec t0;
+	int i, n, ret, wait_ms;
+
+	/* leftovers from a callback that stopped us last time */
+	for (i = osdl_evdev_dev_count - 1; i >= 0; i--) {
+		struct osdl_evdev *dev = osdl_evdev_devs[i];
+		if (dev->buf_pos >= dev->buf_cnt)
+			continue;
+		ret = evdev_handle(dev, key_cb, ts_cb, cb_arg);
+		if (ret != 0)
+			return ret;
 	}
 
+	if (timeout_ms > 0)
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+
 	while (1)
 	{
-		int fd, ret, sdl_kc;
+		wait_ms = timeout_ms;
+		if (timeout_ms > 0) {
+			wait_ms = timeout_ms - evdev_ms_since(&t0);
+			if (wait_ms < 0)
+				wait_ms = 0;
+		}
+
+		if (osdl_epoll_fd != -1) {
+			n = epoll_wait(osdl_epoll_fd, ee, ARRAY_SIZE(ee), wait_ms);
+			for (i = 0; i < n; i++)
+				ready[i] = ee[i].data.ptr;
+		}
+		else
+			n = evdev_wait_select(ready, wait_ms);
 
-		ret = select(fdmax + 1, &fdset, NULL, NULL, timeout);
-		if (ret == -1)
+		if (n == -1)
 		{
-			err_perror("in_evdev: select failed");
+			if (errno == EINTR)
+				continue;
+			err_perror("in_evdev: wait failed");
 			return -1;
 		}
-		else if (ret == 0)
+		else if (n == 0)
 			return -1; /* timeout */
 
-		for (i = 0; i < osdl_evdev_dev_count; i++) {
-			if (!FD_ISSET(osdl_evdev_devs[i], &fdset))
-				continue;
-
-			fd = osdl_evdev_devs[i];
-#if SDL_INPUT_TSLIB
-			if (fd == osdl_tslib_fd && ts_cb != NULL) {
-				while (1) {
-					struct ts_sample tss;
-					ret = ts_read(osdl_tslib_dev, &tss, 1);
-					if (ret <= 0)
-						break;
-					ret = ts_cb(cb_arg, tss.x, tss.y, tss.pressure);
-					if (ret != 0)
-						return ret;
-				}
+		for (i = 0; i < n; i++) {
+			if (ready[i] == NULL) {
+				evdev_hotplug();
 				continue;
 			}
-			/* else read below will consume the event, even if it's from ts */
-#endif
 
-			while (1) {
-				ret = read(fd, &ev, sizeof(ev));
-				if (ret < (int)sizeof(ev)) {
-					if (errno != EAGAIN) {
-						err_perror("in_evdev: read failed");
-						return -1;
-					}
-					break;
-				}
-
-				if (ev.type != EV_KEY || key_cb == NULL)
-					continue; /* not key event or not needed */
-				if ((unsigned int)ev.value > 1)
-					continue; /* not key up/down */
-				if ((unsigned int)ev.code >= ARRAY_SIZE(osdl_evdev_map))
-					continue; /* keycode from future */
-				sdl_kc = osdl_evdev_map[ev.code];
-				if (sdl_kc == 0)
-					continue; /* not mapped */
-				/* scancode note: stock SDL doesn't do +8 in fbcon driver */
-				ret = key_cb(cb_arg, sdl_kc, ev.code + 8, ev.value);
-				if (ret != 0)
-					return ret;
-			}
+			ret = evdev_handle(ready[i], key_cb, ts_cb, cb_arg);
+			if (ret != 0)
+				return ret;
 		}
 	}
 }
@@ -0,0 +1,256 @@
+/*
+ * (C) Gražvydas "notaz" Ignotas, 2012
+ *
+ * This work is licensed under the terms of the GNU LGPL, version 2.1 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ * Frame timing stats. Everything is always compiled in, but only
+ * collected when a stats object exists (SDL_OMAP_STATS or the app asked),
+ * otherwise all hooks are a NULL check.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "osdl.h"
+
+#define LATENCY_BUCKET_US 2000
+
+struct stats_acc {
+	unsigned int frames, missed;
+	unsigned long long frame_us, flip_us, copy_us, bytes;
+	unsigned int frame_us_max, flip_us_max, copy_us_max;
+	unsigned int flips;
+	unsigned int latency_hist[OSDL_STATS_HIST];
+};
+
+struct osdl_stats {
+	unsigned int period_us;
+	int dump_interval;
+	unsigned long long t_frame, t_dump;
+	/* frame in progress */
+	unsigned int copy_us, copy_bytes;
+	unsigned int frame_us_last, copy_bytes_last;
+	/* since start and since last dump */
+	struct stats_acc total, interval;
+	unsigned long long log[OSDL_STATS_LOG];
+	unsigned int log_pos;
+	/* the latency histograms are updated from the async flip thread */
+	pthread_mutex_t hist_lock;
+};
+
+static unsigned long long stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+struct osdl_stats *osdl_stats_init(int dump_interval)
+{
+	struct osdl_stats *stats;
+
+	stats = calloc(1, sizeof(*stats));
+	if (stats == NULL)
+		return NULL;
+
+	pthread_mutex_init(&stats->hist_lock, NULL);
+	stats->period_us = 1000000 / 60;
+	stats->dump_interval = dump_interval;
+	stats->t_dump = stats_now();
+	return stats;
+}
+
+void osdl_stats_set_period(struct osdl_stats *stats, unsigned int period_us)
+{
+	if (stats != NULL && period_us != 0)
+		stats->period_us = period_us;
+}
+
+/* timestamp for the _copy/_flip calls, 0 when not collecting */
+unsigned long long osdl_stats_begin(struct osdl_stats *stats)
+{
+	return stats != NULL ? stats_now() : 0;
+}
+
+void osdl_stats_copy(struct osdl_stats *stats, unsigned long long t_begin,
+	unsigned int bytes)
+{
+	if (stats == NULL)
+		return;
+
+	stats->copy_us += stats_now() - t_begin;
+	stats->copy_bytes += bytes;
+}
+
+static void acc_flip(struct stats_acc *acc, unsigned int us)
+{
+	acc->flips++;
+	acc->flip_us += us;
+	if (us > acc->flip_us_max)
+		acc->flip_us_max = us;
+}
+
+void osdl_stats_flip(struct osdl_stats *stats, unsigned long long t_begin)
+{
+	unsigned int us;
+
+	if (stats == NULL)
+		return;
+
+	us = stats_now() - t_begin;
+	acc_flip(&stats->total, us);
+	acc_flip(&stats->interval, us);
+}
+
+/* may be called from the async flip thread */
+void osdl_stats_latency(struct osdl_stats *stats, unsigned int us)
+{
+	unsigned int b;
+
+	if (stats == NULL)
+		return;
+
+	b = us / LATENCY_BUCKET_US;
+	if (b >= OSDL_STATS_HIST)
+		b = OSDL_STATS_HIST - 1;
+	pthread_mutex_lock(&stats->hist_lock);
+	stats->total.latency_hist[b]++;
+	stats->interval.latency_hist[b]++;
+	pthread_mutex_unlock(&stats->hist_lock);
+}
+
+static void acc_frame(struct stats_acc *acc, struct osdl_stats *stats,
+	unsigned int frame_us, unsigned int missed)
+{
+	acc->frames++;
+	acc->missed += missed;
+	acc->frame_us += frame_us;
+	if (frame_us > acc->frame_us_max)
+		acc->frame_us_max = frame_us;
+	acc->copy_us += stats->copy_us;
+	if (stats->copy_us > acc->copy_us_max)
+		acc->copy_us_max = stats->copy_us;
+	acc->bytes += stats->copy_bytes;
+}
+
+static void stats_dump(struct osdl_stats *stats, unsigned long long now)
+{
+	struct stats_acc *acc = &stats->interval;
+	char hist[OSDL_STATS_HIST * 16];
+	unsigned int secs_x10, i;
+	int len = 0;
+
+	secs_x10 = (now - stats->t_dump) / 100000;
+	if (acc->frames == 0 || secs_x10 == 0)
+		return;
+
+	hist[0] = 0;
+	for (i = 0; i < OSDL_STATS_HIST; i++) {
+		if (acc->latency_hist[i] == 0)
+			continue;
+		len += snprintf(hist + len, sizeof(hist) - len, " %u%s:%u",
+			i * LATENCY_BUCKET_US / 1000,
+			i == OSDL_STATS_HIST - 1 ? "+" : "", acc->latency_hist[i]);
+	}
+
+	err("stats: %u.%u fps, frame %llu/%u us, flip %llu/%u us, "
+		"copy %llu/%u us, %llu KiB/frame, %u missed vblanks%s%s",
+		acc->frames * 10 / secs_x10, acc->frames * 100 / secs_x10 % 10,
+		acc->frame_us / acc->frames, acc->frame_us_max,
+		acc->flips ? acc->flip_us / acc->flips : 0, acc->flip_us_max,
+		acc->copy_us / acc->frames, acc->copy_us_max,
+		acc->bytes / 1024 / acc->frames, acc->missed,
+		len ? ", flip latency ms:" : "", hist);
+}
+
+/* called when the app submits a frame */
+void osdl_stats_frame(struct osdl_stats *stats)
+{
+	unsigned int frame_us = 0, missed = 0;
+	unsigned long long now;
+
+	if (stats == NULL)
+		return;
+
+	now = stats_now();
+	if (stats->t_frame != 0) {
+		frame_us = now - stats->t_frame;
+		/* vblanks that passed without a new frame */
+		missed = (frame_us + stats->period_us / 2) / stats->period_us;
+		if (missed > 0)
+			missed--;
+		acc_frame(&stats->total, stats, frame_us, missed);
+		acc_frame(&stats->interval, stats, frame_us, missed);
+		stats->frame_us_last = frame_us;
+		stats->copy_bytes_last = stats->copy_bytes;
+	}
+	stats->t_frame = now;
+	stats->copy_us = stats->copy_bytes = 0;
+
+	stats->log[stats->log_pos++ % OSDL_STATS_LOG] = now;
+
+	if (stats->dump_interval > 0
+	    && now - stats->t_dump >= stats->dump_interval * 1000000ull)
+	{
+		pthread_mutex_lock(&stats->hist_lock);
+		stats_dump(stats, now);
+		memset(&stats->interval, 0, sizeof(stats->interval));
+		pthread_mutex_unlock(&stats->hist_lock);
+		stats->t_dump = now;
+	}
+}
+
+void osdl_stats_get(struct osdl_stats *stats, struct osdl_stats_info *info)
+{
+	struct stats_acc *acc;
+	unsigned int i, n;
+
+	memset(info, 0, sizeof(*info));
+	if (stats == NULL)
+		return;
+
+	acc = &stats->total;
+	info->frames = acc->frames;
+	info->missed_vblanks = acc->missed;
+	info->frame_us_last = stats->frame_us_last;
+	info->frame_us_max = acc->frame_us_max;
+	info->flip_us_max = acc->flip_us_max;
+	info->copy_us_max = acc->copy_us_max;
+	info->copy_bytes_last = stats->copy_bytes_last;
+	if (acc->frames) {
+		info->frame_us_avg = acc->frame_us / acc->frames;
+		info->copy_us_avg = acc->copy_us / acc->frames;
+		info->copy_bytes_avg = acc->bytes / acc->frames;
+	}
+	if (acc->flips)
+		info->flip_us_avg = acc->flip_us / acc->flips;
+	pthread_mutex_lock(&stats->hist_lock);
+	memcpy(info->latency_hist, acc->latency_hist, sizeof(info->latency_hist));
+	pthread_mutex_unlock(&stats->hist_lock);
+
+	n = stats->log_pos < OSDL_STATS_LOG ? stats->log_pos : OSDL_STATS_LOG;
+	for (i = 0; i < n; i++)
+		info->frame_time_us[OSDL_STATS_LOG - n + i] =
+			stats->log[(stats->log_pos - n + i) % OSDL_STATS_LOG];
+}
+
+void osdl_stats_finish(struct osdl_stats *stats)
+{
+	struct stats_acc *acc;
+
+	if (stats == NULL)
+		return;
+
+	acc = &stats->total;
+	if (stats->dump_interval > 0 && acc->frames)
+		err("stats total: %u frames, frame %llu/%u us, %u missed vblanks",
+			acc->frames, acc->frame_us / acc->frames,
+			acc->frame_us_max, acc->missed);
+	pthread_mutex_destroy(&stats->hist_lock);
+	free(stats);
+}
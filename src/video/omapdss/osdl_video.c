@@ -14,12 +14,14 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #include <linux/fb.h>
 
 #include "osdl.h"
 #include "omapfb.h"
 #include "linux/fbdev.h"
+#include "linux/memfb.h"
 #include "linux/xenv.h"
 
 #define MIN(a, b) ( ((a) < (b)) ? (a) : (b) )
@@ -32,6 +34,17 @@ struct omapfb_state {
 	int tv_layer;
 };
 
+/* packed YUV overlay on the second video pipeline */
+struct osdl_yuv {
+	int fd;
+	struct omapfb_state state;
+	struct fb_var_screeninfo var_old;
+	struct fb_var_screeninfo var;
+	void *mem;
+	size_t mem_size;
+	int width, height;
+};
+
 static int read_sysfs(const char *fname, char *buff, size_t size);
 
 static int switch_tv_layer(struct omapfb_state *ostate, int layer)
@@ -81,7 +94,7 @@ static const char *get_fb_device(void)
 }
 
 static int osdl_setup_omapfb(struct omapfb_state *ostate, int fd, int enabled,
-	int x, int y, int w, int h, int mem, int *buffer_count)
+	int x, int y, int w, int h, int mem, int *buffer_count, int extra)
 {
 	struct omapfb_plane_info pi;
 	struct omapfb_mem_info mi;
@@ -92,13 +105,13 @@ static int osdl_setup_omapfb(struct omapfb_state *ostate, int fd, int enabled,
 	memset(&pi, 0, sizeof(pi));
 	memset(&mi, 0, sizeof(mi));
 
-	ret = ioctl(fd, OMAPFB_QUERY_PLANE, &pi);
+	ret = memfb_ioctl(fd, OMAPFB_QUERY_PLANE, &pi);
 	if (ret != 0) {
 		err_perror("QUERY_PLANE");
 		return -1;
 	}
 
-	ret = ioctl(fd, OMAPFB_QUERY_MEM, &mi);
+	ret = memfb_ioctl(fd, OMAPFB_QUERY_MEM, &mi);
 	if (ret != 0) {
 		err_perror("QUERY_MEM");
 		return -1;
@@ -108,7 +121,7 @@ static int osdl_setup_omapfb(struct omapfb_state *ostate, int fd, int enabled,
 	/* must disable when changing stuff */
 	if (pi.enabled) {
 		pi.enabled = 0;
-		ret = ioctl(fd, OMAPFB_SETUP_PLANE, &pi);
+		ret = memfb_ioctl(fd, OMAPFB_SETUP_PLANE, &pi);
 		if (ret != 0)
 			err_perror("SETUP_PLANE");
 	}
@@ -116,7 +129,7 @@ static int osdl_setup_omapfb(struct omapfb_state *ostate, int fd, int enabled,
 	/* allocate more mem, if needed */
 	for (; size_cur < mem * mem_blocks && mem_blocks > 0; mem_blocks--) {
 		mi.size = mem * mem_blocks;
-		ret = ioctl(fd, OMAPFB_SETUP_MEM, &mi);
+		ret = memfb_ioctl(fd, OMAPFB_SETUP_MEM, &mi);
 		if (ret == 0)
 			break;
 		mi.size = size_cur;
@@ -129,13 +142,24 @@ static int osdl_setup_omapfb(struct omapfb_state *ostate, int fd, int enabled,
 
 	*buffer_count = mem_blocks;
 
+	/* some spare for hw surfaces, fine if there is none */
+	if (extra > 0 && mi.size < mem * mem_blocks + extra) {
+		struct omapfb_mem_info mi_extra = mi;
+		mi_extra.size = mem * mem_blocks + extra;
+		ret = memfb_ioctl(fd, OMAPFB_SETUP_MEM, &mi_extra);
+		if (ret == 0)
+			mi = mi_extra;
+		else
+			log("no %d KiB of spare vram for hw surfaces", extra / 1024);
+	}
+
 	pi.pos_x = x;
 	pi.pos_y = y;
 	pi.out_width = w;
 	pi.out_height = h;
 	pi.enabled = enabled;
 
-	ret = ioctl(fd, OMAPFB_SETUP_PLANE, &pi);
+	ret = memfb_ioctl(fd, OMAPFB_SETUP_PLANE, &pi);
 	if (ret != 0) {
 		err_perror("SETUP_PLANE");
 		err("(%d %d %d %d)\n", x, y, w, h);
@@ -155,7 +179,7 @@ static int osdl_setup_omapfb_enable(struct omapfb_state *ostate,
 	switch_tv_layer(ostate, 1);
 
 	ostate->pi.enabled = enabled;
-	ret = ioctl(fd, OMAPFB_SETUP_PLANE, &ostate->pi);
+	ret = memfb_ioctl(fd, OMAPFB_SETUP_PLANE, &ostate->pi);
 	if (ret != 0)
 		err_perror("SETUP_PLANE");
 
@@ -187,19 +211,19 @@ static int read_sysfs(const char *fname, char *buff, size_t size)
 	return 0;
 }
 
-int read_vscreeninfo(const char *fbname, int *w, int *h)
+int read_vscreeninfo(const char *fbname, int *w, int *h, unsigned int *period_us)
 {
 	struct fb_var_screeninfo fbvar;
 	int ret, fd;
 
-	fd = open(fbname, O_RDWR);
+	fd = memfb_open(fbname, O_RDWR);
 	if (fd == -1) {
 		err_perror("open %s", fbname);
 		return -1;
 	}
 
-	ret = ioctl(fd, FBIOGET_VSCREENINFO, &fbvar);
-	close(fd);
+	ret = memfb_ioctl(fd, FBIOGET_VSCREENINFO, &fbvar);
+	memfb_close(fd);
 
 	if (ret == -1) {
 		err_perror("ioctl %s", fbname);
@@ -211,6 +235,11 @@ int read_vscreeninfo(const char *fbname, int *w, int *h)
 
 	*w = fbvar.xres;
 	*h = fbvar.yres;
+	if (fbvar.pixclock != 0)
+		*period_us = (unsigned long long)fbvar.pixclock
+			* (fbvar.left_margin + fbvar.xres + fbvar.right_margin + fbvar.hsync_len)
+			* (fbvar.upper_margin + fbvar.yres + fbvar.lower_margin + fbvar.vsync_len)
+			/ 1000000;
 	return 0;
 }
 
@@ -221,10 +250,11 @@ int osdl_video_detect_screen(struct SDL_PrivateVideoData *pdata)
 	const char *fbname;
 	struct stat status;
 	int fd, i, ret;
-	int w, h;
+	int pclk, w, hfp, hbp, hsw, h, vfp, vbp, vsw;
 	FILE *f;
 
 	pdata->phys_w = pdata->phys_h = 0;
+	pdata->vsync_period_us = 0;
 
 	fbname = get_fb_device();
 
@@ -283,12 +313,16 @@ int osdl_video_detect_screen(struct SDL_PrivateVideoData *pdata)
 		goto skip_screen;
 	}
 
-	ret = fscanf(f, "%*d,%d/%*d/%*d/%*d,%d/%*d/%*d/%*d", &w, &h);
+	ret = fscanf(f, "%d,%d/%d/%d/%d,%d/%d/%d/%d", &pclk,
+		&w, &hfp, &hbp, &hsw, &h, &vfp, &vbp, &vsw);
 	fclose(f);
-	if (ret != 2) {
+	if (ret != 9) {
 		err("can't parse %s (%d), skip screen detection", buff, ret);
 		goto skip_screen;
 	}
+	if (pclk > 0)
+		pdata->vsync_period_us = (unsigned long long)(w + hfp + hbp + hsw)
+			* (h + vfp + vbp + vsw) * 1000 / pclk;
 
 	log("detected %dx%d '%s' (%d) screen attached to fb %d and overlay %d",
 		w, h, screen_name, screen_id, fb_id, overlay_id);
@@ -299,10 +333,12 @@ int osdl_video_detect_screen(struct SDL_PrivateVideoData *pdata)
 
 skip_screen:
 	/* attempt to extract this from FB then */
-	ret = read_vscreeninfo(fbname, &pdata->phys_w, &pdata->phys_h);
+	ret = read_vscreeninfo(fbname, &pdata->phys_w, &pdata->phys_h,
+		&pdata->vsync_period_us);
 	if (ret != 0 && strcmp(fbname, "/dev/fb0") != 0) {
 		/* last resort */
-		ret = read_vscreeninfo("/dev/fb0", &pdata->phys_w, &pdata->phys_h);
+		ret = read_vscreeninfo("/dev/fb0", &pdata->phys_w, &pdata->phys_h,
+			&pdata->vsync_period_us);
 	}
 
 	if (ret != 0) {
@@ -330,7 +366,7 @@ static int osdl_setup_omap_layer(struct SDL_PrivateVideoData *pdata,
 	if (pdata->phys_h != 0)
 		screen_h = pdata->phys_h;
 
-	fd = open(fbname, O_RDWR);
+	fd = memfb_open(fbname, O_RDWR);
 	if (fd == -1) {
 		err_perror("open %s", fbname);
 		return -1;
@@ -343,13 +379,13 @@ static int osdl_setup_omap_layer(struct SDL_PrivateVideoData *pdata,
 		if (slayer == NULL)
 			goto out;
 
-		ret = ioctl(fd, OMAPFB_QUERY_PLANE, &slayer->pi_old);
+		ret = memfb_ioctl(fd, OMAPFB_QUERY_PLANE, &slayer->pi_old);
 		if (ret != 0) {
 			err_perror("QUERY_PLANE");
 			goto out;
 		}
 
-		ret = ioctl(fd, OMAPFB_QUERY_MEM, &slayer->mi_old);
+		ret = memfb_ioctl(fd, OMAPFB_QUERY_MEM, &slayer->mi_old);
 		if (ret != 0) {
 			err_perror("QUERY_MEM");
 			goto out;
@@ -396,7 +432,8 @@ static int osdl_setup_omap_layer(struct SDL_PrivateVideoData *pdata,
 	x = screen_w / 2 - w / 2;
 	y = screen_h / 2 - h / 2;
 	ret = osdl_setup_omapfb(pdata->layer_state, fd, 0, x, y, w, h,
-				width * height * ((bpp + 7) / 8), buffer_count);
+				width * height * ((bpp + 7) / 8), buffer_count,
+				pdata->cfg_vram_surfaces_kb * 1024);
 	if (ret == 0) {
 		pdata->layer_x = x;
 		pdata->layer_y = y;
@@ -406,22 +443,107 @@ static int osdl_setup_omap_layer(struct SDL_PrivateVideoData *pdata,
 
 	retval = ret;
 out:
-	close(fd);
+	memfb_close(fd);
 	return retval;
 }
 
+/* map whatever VRAM the framebuffers don't use */
+static void osdl_vram_map(struct SDL_PrivateVideoData *pdata, size_t used)
+{
+	struct omapfb_mem_info mi;
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t offs;
+	void *mem;
+	int fd, ret;
+
+	fd = vout_fbdev_get_fd(pdata->fbdev);
+	ret = memfb_ioctl(fd, OMAPFB_QUERY_MEM, &mi);
+	if (ret != 0)
+		return;
+
+	offs = (used + page - 1) & ~(page - 1);
+	if (mi.size <= offs)
+		return;
+
+	mem = mmap(0, mi.size - offs, PROT_WRITE|PROT_READ, MAP_SHARED, fd, offs);
+	if (mem == MAP_FAILED) {
+		err_perror("mmap spare vram");
+		return;
+	}
+
+	pdata->vram_mem = mem;
+	pdata->vram_size = mi.size - offs;
+	pdata->vram_offs = offs;
+}
+
+static void osdl_vram_unmap(struct SDL_PrivateVideoData *pdata)
+{
+	if (pdata->vram_mem != NULL)
+		munmap(pdata->vram_mem, pdata->vram_size);
+	pdata->vram_mem = NULL;
+	pdata->vram_size = 0;
+	free(pdata->vram_saved);
+	pdata->vram_saved = NULL;
+}
+
+/* omapfb can't resize mapped memory, so keep a copy while paused */
+static int osdl_vram_save(struct SDL_PrivateVideoData *pdata)
+{
+	if (pdata->vram_mem == NULL)
+		return 0;
+
+	pdata->vram_saved = malloc(pdata->vram_size);
+	if (pdata->vram_saved == NULL) {
+		err("no memory to save vram");
+		return -1;
+	}
+	memcpy(pdata->vram_saved, pdata->vram_mem, pdata->vram_size);
+	munmap(pdata->vram_mem, pdata->vram_size);
+	pdata->vram_mem = NULL;
+	return 0;
+}
+
+static void osdl_vram_restore(struct SDL_PrivateVideoData *pdata)
+{
+	void *mem;
+	int fd;
+
+	if (pdata->vram_saved == NULL)
+		return;
+
+	fd = vout_fbdev_get_fd(pdata->fbdev);
+	mem = mmap(0, pdata->vram_size, PROT_WRITE|PROT_READ, MAP_SHARED,
+		fd, pdata->vram_offs);
+	if (mem == MAP_FAILED) {
+		/* surfaces just stay in the copy */
+		err_perror("mmap spare vram");
+		osdl_vram_rebase(pdata->vram, pdata->vram_saved);
+		return;
+	}
+
+	memcpy(mem, pdata->vram_saved, pdata->vram_size);
+	osdl_vram_rebase(pdata->vram, mem);
+	free(pdata->vram_saved);
+	pdata->vram_saved = NULL;
+	pdata->vram_mem = mem;
+}
+
 void *osdl_video_set_mode(struct SDL_PrivateVideoData *pdata,
 			  int border_l, int border_r, int border_t, int border_b,
 			  int width, int height, int bpp, int *doublebuf,
 			  const char *wm_title)
 {
+	struct fb_fix_screeninfo fix;
 	int buffers_try, buffers_set;
 	const char *fbname;
+	size_t fb_used;
 	void *result;
 	int ret;
 
 	fbname = get_fb_device();
 
+	/* hw surfaces must have been moved out by now */
+	osdl_vram_unmap(pdata);
 	if (pdata->fbdev != NULL) {
 		vout_fbdev_finish(pdata->fbdev);
 		pdata->fbdev = NULL;
@@ -439,6 +561,7 @@ void *osdl_video_set_mode(struct SDL_PrivateVideoData *pdata,
 	pdata->fbdev = vout_fbdev_init(fbname, &width, &height, bpp, buffers_set);
 	if (pdata->fbdev == NULL)
 		goto fail;
+	fb_used = (size_t)width * height * ((bpp + 7) / 8) * buffers_set;
 
 	if (border_l | border_r | border_t | border_b) {
 		width -= border_l + border_r;
@@ -452,6 +575,25 @@ void *osdl_video_set_mode(struct SDL_PrivateVideoData *pdata,
 	if (result == NULL)
 		goto fail;
 
+	osdl_vram_map(pdata, fb_used);
+
+	/* for DMA, omapfb memory is physically contiguous */
+	pdata->fb_phys = 0;
+	ret = memfb_ioctl(vout_fbdev_get_fd(pdata->fbdev), FBIOGET_FSCREENINFO, &fix);
+	if (ret == 0)
+		pdata->fb_phys = fix.smem_start;
+
+	pdata->async_flip = 0;
+	if (pdata->cfg_async_flip && buffers_set >= 3) {
+		ret = vout_fbdev_async_start(pdata->fbdev);
+		if (ret == 0)
+			pdata->async_flip = 1;
+		else
+			err("async flip unavailable, using normal flips");
+	}
+	if (pdata->stats != NULL)
+		osdl_video_set_stats(pdata, pdata->stats);
+
 	if (!pdata->xenv_up) {
 		int xenv_flags = XENV_CAP_KEYS | XENV_CAP_MOUSE;
 		ret = xenv_init(&xenv_flags, wm_title);
@@ -483,19 +625,44 @@ fail:
 
 void *osdl_video_flip(struct SDL_PrivateVideoData *pdata)
 {
+	unsigned long long t;
 	void *ret;
 
 	if (pdata->fbdev == NULL)
 		return NULL;
 
+	t = osdl_stats_begin(pdata->stats);
 	ret = vout_fbdev_flip(pdata->fbdev);
 
-	if (pdata->cfg_force_vsync)
+	/* flip thread does the waiting in async mode */
+	if (pdata->cfg_force_vsync && !pdata->async_flip) {
 		vout_fbdev_wait_vsync(pdata->fbdev);
+		if (pdata->stats != NULL)
+			osdl_stats_latency(pdata->stats,
+				osdl_stats_begin(pdata->stats) - t);
+	}
+	osdl_stats_flip(pdata->stats, t);
 
 	return ret;
 }
 
+static void osdl_video_latency_cb(void *arg, unsigned int us)
+{
+	osdl_stats_latency(arg, us);
+}
+
+/* start (or stop with NULL) collecting stats */
+void osdl_video_set_stats(struct SDL_PrivateVideoData *pdata,
+	struct osdl_stats *stats)
+{
+	pdata->stats = stats;
+	osdl_stats_set_period(stats, pdata->vsync_period_us);
+
+	if (pdata->fbdev != NULL && pdata->async_flip)
+		vout_fbdev_set_latency_cb(pdata->fbdev,
+			stats != NULL ? osdl_video_latency_cb : NULL, stats);
+}
+
 void *osdl_video_get_active_buffer(struct SDL_PrivateVideoData *pdata)
 {
 	if (pdata->fbdev == NULL)
@@ -504,6 +671,233 @@ void *osdl_video_get_active_buffer(struct SDL_PrivateVideoData *pdata)
 	return vout_fbdev_get_active_mem(pdata->fbdev);
 }
 
+static const char *get_yuv_fb_device(void)
+{
+	const char *fbname = getenv("SDL_OMAP_YUV_FBDEV");
+	if (fbname != NULL)
+		return fbname;
+
+	/* keep the overlay emulated when the main layer is */
+	if (strncmp(get_fb_device(), "mem", 3) == 0)
+		return "mem2";
+
+	return "/dev/fb2";
+}
+
+struct osdl_yuv *osdl_yuv_create(struct SDL_PrivateVideoData *pdata,
+	int width, int height, int uyvy, void **pixels, int *pitch)
+{
+	struct fb_fix_screeninfo fix;
+	struct osdl_yuv *yuv;
+	const char *fbname;
+	unsigned int *p, black;
+	int one = 1;
+	size_t i;
+	int ret;
+
+	if (pdata->yuv != NULL) {
+		err("only one YUV overlay supported");
+		return NULL;
+	}
+	if (width & 1) {
+		err("YUV overlay width must be even, got %d", width);
+		return NULL;
+	}
+
+	yuv = calloc(1, sizeof(*yuv));
+	if (yuv == NULL)
+		return NULL;
+
+	fbname = get_yuv_fb_device();
+	yuv->fd = memfb_open(fbname, O_RDWR);
+	if (yuv->fd == -1) {
+		err_perror("open %s", fbname);
+		goto fail_free;
+	}
+
+	ret = memfb_ioctl(yuv->fd, OMAPFB_QUERY_PLANE, &yuv->state.pi_old);
+	ret |= memfb_ioctl(yuv->fd, OMAPFB_QUERY_MEM, &yuv->state.mi_old);
+	ret |= memfb_ioctl(yuv->fd, FBIOGET_VSCREENINFO, &yuv->var_old);
+	if (ret != 0) {
+		err_perror("%s: query", fbname);
+		goto fail_close;
+	}
+
+	/* kept disabled until the first display call positions it */
+	ret = osdl_setup_omapfb(&yuv->state, yuv->fd, 0,
+		pdata->layer_x, pdata->layer_y, pdata->layer_w, pdata->layer_h,
+		width * height * 2, &one, 0);
+	if (ret != 0)
+		goto fail_restore;
+
+	yuv->var = yuv->var_old;
+	yuv->var.xres = yuv->var.xres_virtual = width;
+	yuv->var.yres = yuv->var.yres_virtual = height;
+	yuv->var.xoffset = yuv->var.yoffset = 0;
+	yuv->var.bits_per_pixel = 16;
+	yuv->var.nonstd = uyvy ? OMAPFB_COLOR_YUV422 : OMAPFB_COLOR_YUY422;
+	ret = memfb_ioctl(yuv->fd, FBIOPUT_VSCREENINFO, &yuv->var);
+	if (ret != 0) {
+		err_perror("%s: YUV mode %dx%d", fbname, width, height);
+		goto fail_restore;
+	}
+
+	ret = memfb_ioctl(yuv->fd, FBIOGET_FSCREENINFO, &fix);
+	if (ret != 0) {
+		err_perror("%s: FBIOGET_FSCREENINFO", fbname);
+		goto fail_restore;
+	}
+
+	yuv->mem_size = fix.line_length * height;
+	yuv->mem = mmap(0, yuv->mem_size, PROT_WRITE|PROT_READ,
+			MAP_SHARED, yuv->fd, 0);
+	if (yuv->mem == MAP_FAILED) {
+		err_perror("%s: mmap", fbname);
+		yuv->mem = NULL;
+		goto fail_restore;
+	}
+
+	black = uyvy ? 0x10801080 : 0x80108010;
+	for (p = yuv->mem, i = 0; i < yuv->mem_size / 4; i++)
+		p[i] = black;
+
+	yuv->width = width;
+	yuv->height = height;
+	*pixels = yuv->mem;
+	*pitch = fix.line_length;
+	pdata->yuv = yuv;
+	return yuv;
+
+fail_restore:
+	memfb_ioctl(yuv->fd, OMAPFB_SETUP_MEM, &yuv->state.mi_old);
+	memfb_ioctl(yuv->fd, OMAPFB_SETUP_PLANE, &yuv->state.pi_old);
+fail_close:
+	memfb_close(yuv->fd);
+fail_free:
+	free(yuv);
+	return NULL;
+}
+
+/* src is in overlay pixels, out_* in physical screen pixels */
+int osdl_yuv_display(struct SDL_PrivateVideoData *pdata, struct osdl_yuv *yuv,
+	int src_x, int src_y, int src_w, int src_h,
+	int out_x, int out_y, int out_w, int out_h)
+{
+	struct omapfb_plane_info *pi = &yuv->state.pi;
+	int crop_changed;
+	int ret;
+
+	/* chroma is shared by pixel pairs */
+	src_x &= ~1;
+	src_w = (src_w + 1) & ~1;
+	if (src_x + src_w > yuv->width)
+		src_w = yuv->width - src_x;
+	if (src_w <= 0 || src_h <= 0 || out_w <= 0 || out_h <= 0)
+		return 0;
+
+	crop_changed = yuv->var.xoffset != src_x || yuv->var.yoffset != src_y
+		|| yuv->var.xres != src_w || yuv->var.yres != src_h;
+	if (!crop_changed && pi->enabled
+	    && pi->pos_x == out_x && pi->pos_y == out_y
+	    && pi->out_width == out_w && pi->out_height == out_h)
+		/* nothing to do, the plane scans out by itself */
+		return 0;
+
+	if (pi->enabled) {
+		pi->enabled = 0;
+		ret = memfb_ioctl(yuv->fd, OMAPFB_SETUP_PLANE, pi);
+		if (ret != 0)
+			err_perror("SETUP_PLANE");
+	}
+
+	if (crop_changed) {
+		yuv->var.xoffset = src_x;
+		yuv->var.yoffset = src_y;
+		yuv->var.xres = src_w;
+		yuv->var.yres = src_h;
+		ret = memfb_ioctl(yuv->fd, FBIOPUT_VSCREENINFO, &yuv->var);
+		if (ret != 0) {
+			err_perror("YUV crop %d,%d %dx%d", src_x, src_y, src_w, src_h);
+			return -1;
+		}
+	}
+
+	pi->pos_x = out_x;
+	pi->pos_y = out_y;
+	pi->out_width = out_w;
+	pi->out_height = out_h;
+	pi->enabled = 1;
+	ret = memfb_ioctl(yuv->fd, OMAPFB_SETUP_PLANE, pi);
+	if (ret != 0) {
+		err_perror("SETUP_PLANE");
+		err("(%d %d %d %d)", out_x, out_y, out_w, out_h);
+		pi->enabled = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+void osdl_yuv_destroy(struct SDL_PrivateVideoData *pdata, struct osdl_yuv *yuv)
+{
+	struct omapfb_state *state = &yuv->state;
+	int enabled = state->pi_old.enabled;
+
+	state->pi.enabled = 0;
+	memfb_ioctl(yuv->fd, OMAPFB_SETUP_PLANE, &state->pi);
+	if (yuv->mem != NULL)
+		munmap(yuv->mem, yuv->mem_size);
+
+	memfb_ioctl(yuv->fd, FBIOPUT_VSCREENINFO, &yuv->var_old);
+	state->pi_old.enabled = 0;
+	memfb_ioctl(yuv->fd, OMAPFB_SETUP_PLANE, &state->pi_old);
+	memfb_ioctl(yuv->fd, OMAPFB_SETUP_MEM, &state->mi_old);
+	if (enabled) {
+		state->pi_old.enabled = enabled;
+		memfb_ioctl(yuv->fd, OMAPFB_SETUP_PLANE, &state->pi_old);
+	}
+	memfb_close(yuv->fd);
+
+	if (pdata->yuv == yuv)
+		pdata->yuv = NULL;
+	free(yuv);
+}
+
+/* hide/unhide the overlay along with the main layer */
+static void osdl_yuv_pause(struct osdl_yuv *yuv, int is_pause)
+{
+	struct omapfb_plane_info pi = yuv->state.pi;
+	int ret;
+
+	if (!pi.enabled)
+		return;
+
+	pi.enabled = !is_pause;
+	ret = memfb_ioctl(yuv->fd, OMAPFB_SETUP_PLANE, &pi);
+	if (ret != 0)
+		err_perror("SETUP_PLANE");
+}
+
+unsigned long osdl_video_phys_addr(struct SDL_PrivateVideoData *pdata,
+	const void *ptr)
+{
+	const char *p = ptr, *mem;
+	size_t size;
+
+	if (pdata->fb_phys == 0 || pdata->fbdev == NULL)
+		return 0;
+
+	mem = vout_fbdev_get_mem(pdata->fbdev, &size);
+	if (mem != NULL && mem <= p && p < mem + size)
+		return pdata->fb_phys + (p - mem);
+
+	mem = pdata->vram_mem;
+	if (mem != NULL && mem <= p && p < mem + pdata->vram_size)
+		return pdata->fb_phys + pdata->vram_offs + (p - mem);
+
+	return 0;
+}
+
 int osdl_video_pause(struct SDL_PrivateVideoData *pdata, int is_pause)
 {
 	struct omapfb_state *state = pdata->layer_state;
@@ -525,9 +919,16 @@ int osdl_video_pause(struct SDL_PrivateVideoData *pdata, int is_pause)
 	}
 
 	if (is_pause) {
-		ret = vout_fbdev_save(pdata->fbdev);
+		ret = osdl_vram_save(pdata);
 		if (ret != 0)
 			return ret;
+		ret = vout_fbdev_save(pdata->fbdev);
+		if (ret != 0) {
+			osdl_vram_restore(pdata);
+			return ret;
+		}
+		if (pdata->yuv != NULL)
+			osdl_yuv_pause(pdata->yuv, 1);
 		pi = state->pi_old;
 		mi = state->mi_old;
 		enabled = pi.enabled;
@@ -537,13 +938,13 @@ int osdl_video_pause(struct SDL_PrivateVideoData *pdata, int is_pause)
 		enabled = 1;
 	}
 	pi.enabled = 0;
-	ret = ioctl(fd, OMAPFB_SETUP_PLANE, &pi);
+	ret = memfb_ioctl(fd, OMAPFB_SETUP_PLANE, &pi);
 	if (ret != 0) {
 		err_perror("SETUP_PLANE");
 		return -1;
 	}
 
-	ret = ioctl(fd, OMAPFB_SETUP_MEM, &mi);
+	ret = memfb_ioctl(fd, OMAPFB_SETUP_MEM, &mi);
 	if (ret != 0)
 		err_perror("SETUP_MEM");
 
@@ -553,17 +954,21 @@ int osdl_video_pause(struct SDL_PrivateVideoData *pdata, int is_pause)
 			err("fbdev_restore failed\n");
 			return ret;
 		}
+		osdl_vram_restore(pdata);
 	}
 
 	if (enabled) {
 		pi.enabled = 1;
-		ret = ioctl(fd, OMAPFB_SETUP_PLANE, &pi);
+		ret = memfb_ioctl(fd, OMAPFB_SETUP_PLANE, &pi);
 		if (ret != 0) {
 			err_perror("SETUP_PLANE");
 			return -1;
 		}
 	}
 
+	if (!is_pause && pdata->yuv != NULL)
+		osdl_yuv_pause(pdata->yuv, 0);
+
 	return 0;
 }
 
@@ -577,7 +982,16 @@ void osdl_video_finish(struct SDL_PrivateVideoData *pdata)
 	static const char *fbname;
 
 	fbname = get_fb_device();
+	osdl_vram_unmap(pdata);
 	if (pdata->fbdev != NULL) {
+		if (pdata->async_flip) {
+			unsigned int queued, dropped, waited;
+			vout_fbdev_get_flip_stats(pdata->fbdev,
+				&queued, &dropped, &waited);
+			log("async flip: %u queued, %u dropped, %u waited",
+				queued, dropped, waited);
+			pdata->async_flip = 0;
+		}
 		vout_fbdev_finish(pdata->fbdev);
 		pdata->fbdev = NULL;
 	}
@@ -590,19 +1004,19 @@ void osdl_video_finish(struct SDL_PrivateVideoData *pdata)
 		if (slayer->tv_layer)
 			switch_tv_layer(slayer, 0);
 
-		fd = open(fbname, O_RDWR);
+		fd = memfb_open(fbname, O_RDWR);
 		if (fd != -1) {
 			int enabled = slayer->pi_old.enabled;
 
 			/* be sure to disable while setting up */
 			slayer->pi_old.enabled = 0;
-			ioctl(fd, OMAPFB_SETUP_PLANE, &slayer->pi_old);
-			ioctl(fd, OMAPFB_SETUP_MEM, &slayer->mi_old);
+			memfb_ioctl(fd, OMAPFB_SETUP_PLANE, &slayer->pi_old);
+			memfb_ioctl(fd, OMAPFB_SETUP_MEM, &slayer->mi_old);
 			if (enabled) {
 				slayer->pi_old.enabled = enabled;
-				ioctl(fd, OMAPFB_SETUP_PLANE, &slayer->pi_old);
+				memfb_ioctl(fd, OMAPFB_SETUP_PLANE, &slayer->pi_old);
 			}
-			close(fd);
+			memfb_close(fd);
 		}
 		free(slayer);
 		pdata->layer_state = NULL;
@@ -0,0 +1,249 @@
+/*
+ * (C) Gražvydas "notaz" Ignotas, 2012
+ *
+ * This work is licensed under the terms of the GNU LGPL, version 2.1 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ * Sub-allocator for spare VRAM (hw surfaces).
+ * Blocks are kept in address order, free neighbours are merged right
+ * away. When a request doesn't fit only because of fragmentation,
+ * unpinned blocks are slid down over the holes and their owners are told
+ * the new address.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "osdl.h"
+
+/* keep surfaces cache line and DMA burst aligned */
+#define VRAM_ALIGN 64
+
+struct osdl_vram_block {
+	struct osdl_vram_block *prev, *next;
+	char *base;
+	size_t size;
+	void *owner;
+	unsigned int used:1;
+	unsigned int pinned;
+};
+
+struct osdl_vram {
+	struct osdl_vram_block *first;
+	char *mem;
+	void (*relocate)(void *owner, void *base);
+	size_t size, avail;
+	unsigned int compactions;
+};
+
+struct osdl_vram *osdl_vram_init(void *base, size_t size,
+	void (*relocate)(void *owner, void *base))
+{
+	struct osdl_vram *vram;
+	size_t skip;
+
+	/* align the heap start, mapping is page aligned anyway */
+	skip = -(unsigned long)base & (VRAM_ALIGN - 1);
+	if (base == NULL || size < skip + VRAM_ALIGN)
+		return NULL;
+
+	vram = calloc(1, sizeof(*vram));
+	if (vram == NULL)
+		return NULL;
+	vram->first = calloc(1, sizeof(*vram->first));
+	if (vram->first == NULL) {
+		free(vram);
+		return NULL;
+	}
+
+	vram->size = vram->avail = (size - skip) & ~(VRAM_ALIGN - 1);
+	vram->first->base = (char *)base + skip;
+	vram->first->size = vram->size;
+	vram->mem = base;
+	vram->relocate = relocate;
+
+	return vram;
+}
+
+/* merge b with the following block, both must be free */
+static void vram_merge_next(struct osdl_vram_block *b)
+{
+	struct osdl_vram_block *n = b->next;
+
+	b->size += n->size;
+	b->next = n->next;
+	if (n->next != NULL)
+		n->next->prev = b;
+	free(n);
+}
+
+/* slide used blocks down over free ones, pinned blocks stay put */
+static void vram_compact(struct osdl_vram *vram)
+{
+	struct osdl_vram_block *b, *f;
+	int moved = 0;
+
+	for (b = vram->first; b != NULL; b = b->next) {
+		f = b->prev;
+		if (!b->used || b->pinned || f == NULL || f->used)
+			continue;
+
+		/* f (free) b (used) -> b f */
+		memmove(f->base, b->base, b->size);
+		b->base = f->base;
+		f->base = b->base + b->size;
+
+		f->next = b->next;
+		if (b->next != NULL)
+			b->next->prev = f;
+		b->prev = f->prev;
+		if (f->prev != NULL)
+			f->prev->next = b;
+		else
+			vram->first = b;
+		b->next = f;
+		f->prev = b;
+
+		if (f->next != NULL && !f->next->used)
+			vram_merge_next(f);
+
+		vram->relocate(b->owner, b->base);
+		moved = 1;
+		b = f;
+	}
+
+	if (moved)
+		vram->compactions++;
+}
+
+static struct osdl_vram_block *vram_find(struct osdl_vram *vram, size_t size)
+{
+	struct osdl_vram_block *b, *best = NULL;
+
+	/* best fit, keeps large holes for large surfaces */
+	for (b = vram->first; b != NULL; b = b->next)
+		if (!b->used && b->size >= size
+		    && (best == NULL || b->size < best->size))
+			best = b;
+
+	return best;
+}
+
+struct osdl_vram_block *osdl_vram_alloc(struct osdl_vram *vram, size_t size,
+	void *owner, void **base)
+{
+	struct osdl_vram_block *b, *n;
+
+	if (vram == NULL || size == 0)
+		return NULL;
+
+	size = (size + VRAM_ALIGN - 1) & ~(VRAM_ALIGN - 1);
+	if (size > vram->avail)
+		return NULL;
+
+	b = vram_find(vram, size);
+	if (b == NULL) {
+		/* enough space in total, just fragmented */
+		vram_compact(vram);
+		b = vram_find(vram, size);
+		if (b == NULL)
+			return NULL;
+	}
+
+	if (b->size > size) {
+		n = calloc(1, sizeof(*n));
+		if (n == NULL)
+			return NULL;
+		n->base = b->base + size;
+		n->size = b->size - size;
+		n->prev = b;
+		n->next = b->next;
+		if (b->next != NULL)
+			b->next->prev = n;
+		b->next = n;
+		b->size = size;
+	}
+
+	b->used = 1;
+	b->pinned = 0;
+	b->owner = owner;
+	vram->avail -= size;
+
+	*base = b->base;
+	return b;
+}
+
+void osdl_vram_free(struct osdl_vram *vram, struct osdl_vram_block *b)
+{
+	if (vram == NULL || b == NULL || !b->used)
+		return;
+
+	vram->avail += b->size;
+	b->used = 0;
+	b->pinned = 0;
+	b->owner = NULL;
+
+	if (b->next != NULL && !b->next->used)
+		vram_merge_next(b);
+	if (b->prev != NULL && !b->prev->used)
+		vram_merge_next(b->prev);
+}
+
+/* pinned blocks (locked surfaces) are never moved */
+void osdl_vram_pin(struct osdl_vram_block *b, int pin)
+{
+	if (pin)
+		b->pinned++;
+	else if (b->pinned > 0)
+		b->pinned--;
+}
+
+size_t osdl_vram_avail(struct osdl_vram *vram, size_t *total)
+{
+	if (vram == NULL) {
+		if (total != NULL)
+			*total = 0;
+		return 0;
+	}
+
+	if (total != NULL)
+		*total = vram->size;
+	return vram->avail;
+}
+
+/* whole heap moved (remapped), tell everyone */
+void osdl_vram_rebase(struct osdl_vram *vram, void *base)
+{
+	struct osdl_vram_block *b;
+
+	if (vram == NULL || base == vram->mem)
+		return;
+
+	for (b = vram->first; b != NULL; b = b->next) {
+		b->base = (char *)base + (b->base - vram->mem);
+		if (b->used)
+			vram->relocate(b->owner, b->base);
+	}
+	vram->mem = base;
+}
+
+void osdl_vram_finish(struct osdl_vram *vram,
+	void (*evict)(void *owner, void *base, size_t size))
+{
+	struct osdl_vram_block *b, *n;
+
+	if (vram == NULL)
+		return;
+
+	if (vram->compactions)
+		log("vram: %u compactions", vram->compactions);
+
+	for (b = vram->first; b != NULL; b = n) {
+		n = b->next;
+		if (b->used && evict != NULL)
+			evict(b->owner, b->base, b->size);
+		free(b);
+	}
+	free(vram);
+}
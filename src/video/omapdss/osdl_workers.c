@@ -0,0 +1,169 @@
+/*
+ * (C) Gražvydas "notaz" Ignotas, 2012
+ *
+ * This work is licensed under the terms of the GNU LGPL, version 2.1 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ * Small thread pool for splitting big framebuffer copies into bands
+ * on multicore SoCs. The caller works on bands too and returns when
+ * all of them are done, so nothing is left running in the background.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "osdl.h"
+
+struct osdl_workers {
+	pthread_t *threads;
+	int count;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond_work;
+	pthread_cond_t cond_done;
+	void (*func)(void *arg, int band, int bands);
+	void *arg;
+	int bands, next_band, pending;
+	int quit;
+	/* stats */
+	unsigned int runs, bands_total;
+};
+
+/* grab the next band, -1 if none left; mutex must be held */
+static int workers_take(struct osdl_workers *w)
+{
+	if (w->next_band >= w->bands)
+		return -1;
+	return w->next_band++;
+}
+
+static void *workers_thread(void *arg)
+{
+	struct osdl_workers *w = arg;
+	void (*func)(void *arg, int band, int bands);
+	int band, bands;
+	void *func_arg;
+
+	pthread_mutex_lock(&w->mutex);
+	for (;;) {
+		while ((band = workers_take(w)) < 0 && !w->quit)
+			pthread_cond_wait(&w->cond_work, &w->mutex);
+		if (band < 0)
+			break;
+
+		func = w->func;
+		func_arg = w->arg;
+		bands = w->bands;
+		pthread_mutex_unlock(&w->mutex);
+		func(func_arg, band, bands);
+		pthread_mutex_lock(&w->mutex);
+
+		if (--w->pending == 0)
+			pthread_cond_signal(&w->cond_done);
+	}
+	pthread_mutex_unlock(&w->mutex);
+
+	return NULL;
+}
+
+struct osdl_workers *osdl_workers_init(int count)
+{
+	struct osdl_workers *w;
+	int i, ret;
+
+	if (count <= 0)
+		return NULL;
+
+	w = calloc(1, sizeof(*w));
+	if (w == NULL)
+		return NULL;
+	w->threads = calloc(count, sizeof(w->threads[0]));
+	if (w->threads == NULL) {
+		free(w);
+		return NULL;
+	}
+
+	pthread_mutex_init(&w->mutex, NULL);
+	pthread_cond_init(&w->cond_work, NULL);
+	pthread_cond_init(&w->cond_done, NULL);
+
+	for (i = 0; i < count; i++) {
+		ret = pthread_create(&w->threads[i], NULL, workers_thread, w);
+		if (ret != 0) {
+			err("workers: pthread_create: %d", ret);
+			break;
+		}
+	}
+	w->count = i;
+	if (w->count == 0) {
+		osdl_workers_finish(w);
+		return NULL;
+	}
+
+	log("workers: %d extra threads for copies", w->count);
+	return w;
+}
+
+/* threads available including the caller */
+int osdl_workers_count(struct osdl_workers *w)
+{
+	return w != NULL ? w->count + 1 : 1;
+}
+
+void osdl_workers_run(struct osdl_workers *w,
+	void (*func)(void *arg, int band, int bands), void *arg, int bands)
+{
+	int band;
+
+	if (w == NULL || bands <= 1) {
+		for (band = 0; band < bands; band++)
+			func(arg, band, bands);
+		return;
+	}
+
+	pthread_mutex_lock(&w->mutex);
+	w->func = func;
+	w->arg = arg;
+	w->bands = bands;
+	w->next_band = 0;
+	w->pending = bands;
+	w->runs++;
+	w->bands_total += bands;
+	pthread_cond_broadcast(&w->cond_work);
+
+	while ((band = workers_take(w)) >= 0) {
+		pthread_mutex_unlock(&w->mutex);
+		func(arg, band, bands);
+		pthread_mutex_lock(&w->mutex);
+		w->pending--;
+	}
+
+	while (w->pending > 0)
+		pthread_cond_wait(&w->cond_done, &w->mutex);
+	w->bands = 0;
+	pthread_mutex_unlock(&w->mutex);
+}
+
+void osdl_workers_finish(struct osdl_workers *w)
+{
+	int i;
+
+	if (w == NULL)
+		return;
+
+	pthread_mutex_lock(&w->mutex);
+	w->quit = 1;
+	pthread_cond_broadcast(&w->cond_work);
+	pthread_mutex_unlock(&w->mutex);
+	for (i = 0; i < w->count; i++)
+		pthread_join(w->threads[i], NULL);
+
+	if (w->runs)
+		log("workers: %u split copies, %u bands", w->runs, w->bands_total);
+
+	pthread_cond_destroy(&w->cond_done);
+	pthread_cond_destroy(&w->cond_work);
+	pthread_mutex_destroy(&w->mutex);
+	free(w->threads);
+	free(w);
+}
@@ -9,14 +9,30 @@
 #include <stdlib.h>
 #include <X11/XF86keysym.h>
 
+#include "SDL_omapdss.h"
 #include "../SDL_sysvideo.h"
 #include "../SDL_pixels_c.h"
+#include "../SDL_yuvfuncs.h"
 #include "../../events/SDL_events_c.h"
 
 #include "SDL_x11reuse.h"
 #include "linux/xenv.h"
 #include "osdl.h"
 
+/* damage tracking granularity for UpdateRects, in pixels */
+#define DIRTY_TILE_W 16
+#define DIRTY_TILE_H 8
+/* dirty tile percentage above which whole screen is copied */
+#define DIRTY_FULL_COPY_PCT 75
+/* smaller blits/fills are not worth queueing for the accel backend */
+#define ACCEL_MIN_BYTES 4096
+/* copies split between threads must be at least this big,
+ * with at least this many lines per thread */
+#define THREADS_MIN_BYTES (64 * 1024)
+#define THREADS_MIN_LINES 16
+
+static void update_rect(struct SDL_PrivateVideoData *pdata, SDL_Surface *screen,
+	char *dst, const char *src, int x, int y, int w, int h);
 
 static int omap_available(void) 
 {
@@ -62,12 +78,59 @@ static int omap_VideoInit(SDL_VideoDevice *this, SDL_PixelFormat *vformat)
 	return 0;
 }
 
+/* hw surface memory got moved by VRAM compaction */
+static void omap_vram_relocate(void *owner, void *base)
+{
+	SDL_Surface *surface = owner;
+
+	surface->pixels = base;
+}
+
+/* VRAM is going away, turn the surface into a normal one.
+ * If there's no memory for that it stays a hw surface without pixels
+ * (lost), locking it fails instead of handing out a NULL pointer. */
+static void omap_vram_evict(void *owner, void *base, size_t size)
+{
+	SDL_Surface *surface = owner;
+	void *pixels;
+
+	pixels = SDL_malloc(surface->h * surface->pitch);
+	surface->pixels = pixels;
+	surface->hwdata = NULL;
+	if (pixels != NULL) {
+		memcpy(pixels, base, surface->h * surface->pitch);
+		surface->flags &= ~SDL_HWSURFACE;
+	}
+	else
+		err("no memory to evict surface %p from vram, it's lost", surface);
+
+	if (surface->map != NULL)
+		SDL_InvalidateMap(surface->map);
+}
+
 static void omap_VideoQuit(SDL_VideoDevice *this)
 {
 	trace();
 
+	osdl_workers_finish(this->hidden->workers);
+	this->hidden->workers = NULL;
+	osdl_accel_finish(this->hidden->accel);
+	this->hidden->accel = NULL;
+	this->info.blit_hw = this->info.blit_fill = 0;
+	osdl_vram_finish(this->hidden->vram, omap_vram_evict);
+	this->hidden->vram = NULL;
+	/* overlays the app forgot about */
+	if (this->hidden->yuv != NULL)
+		osdl_yuv_destroy(this->hidden, this->hidden->yuv);
 	osdl_video_finish(this->hidden);
+	osdl_stats_finish(this->hidden->stats);
+	this->hidden->stats = NULL;
+	free(this->hidden->dirty_map);
+	this->hidden->dirty_map = NULL;
 	this->screen->pixels = NULL;
+	free(this->hidden->clut_pixels);
+	this->hidden->clut_pixels = NULL;
+	this->hidden->clut_bpp = 0;
 	omapsdl_input_finish();
 }
 
@@ -86,7 +149,7 @@ static SDL_Rect **omap_ListModes(SDL_VideoDevice *this, SDL_PixelFormat *format,
 
 	trace();
 
-	if (format->BitsPerPixel <= 8)
+	if (format->BitsPerPixel < 8)
 		// not (yet?) supported
 		return NULL;
 
@@ -99,14 +162,24 @@ static SDL_Surface *omap_SetVideoMode(SDL_VideoDevice *this, SDL_Surface *curren
 	struct SDL_PrivateVideoData *pdata = this->hidden;
 	SDL_PixelFormat *format;
 	Uint32 unhandled_flags;
-	int doublebuf;
+	int doublebuf, fb_bpp;
 	void *fbmem;
 
 	trace("%d, %d, %d, %08x", width, height, bpp, flags);
 
 	omapsdl_config_from_env(pdata);
 
+	fb_bpp = bpp;
 	switch (bpp) {
+	case 8:
+		/* drawn in system memory, expanded to the framebuffer */
+		format = SDL_ReallocFormat(current, 8, 0, 0, 0, 0);
+		fb_bpp = pdata->cfg_clut_bpp;
+		if (fb_bpp != 16 && fb_bpp != 32) {
+			err("clut depth %d not supported, using 16", fb_bpp);
+			fb_bpp = 16;
+		}
+		break;
 	case 16:
 		format = SDL_ReallocFormat(current, 16, 0xf800, 0x07e0, 0x001f, 0);
 		break;
@@ -141,9 +214,14 @@ static SDL_Surface *omap_SetVideoMode(SDL_VideoDevice *this, SDL_Surface *curren
 	 * we'll have to blit manually on UpdateRects() */
 	doublebuf = 1;
 
+	/* VRAM layout changes with the mode */
+	osdl_accel_sync(pdata->accel);
+	osdl_vram_finish(pdata->vram, omap_vram_evict);
+	pdata->vram = NULL;
+
 	fbmem = osdl_video_set_mode(pdata,
 		pdata->border_l, pdata->border_r, pdata->border_t, pdata->border_b,
-		width, height, bpp, &doublebuf, this->wm_title);
+		width, height, fb_bpp, &doublebuf, this->wm_title);
 	if (fbmem == NULL) {
 		err("failing on mode %dx%d@%d, doublebuf %s, border %d,%d,%d,%d",
 		    width, height, bpp, (flags & SDL_DOUBLEBUF) ? "on" : "off",
@@ -156,6 +234,20 @@ static SDL_Surface *omap_SetVideoMode(SDL_VideoDevice *this, SDL_Surface *curren
 		return NULL;
 	}
 
+	pdata->vram = osdl_vram_init(pdata->vram_mem, pdata->vram_size,
+		omap_vram_relocate);
+	this->info.video_mem = pdata->vram_size / 1024;
+
+	if (pdata->accel == NULL && pdata->cfg_accel != OSDL_ACCEL_NONE)
+		pdata->accel = osdl_accel_init(pdata->cfg_accel);
+	this->info.blit_hw = this->info.blit_fill = pdata->accel != NULL;
+
+	if (pdata->workers == NULL && pdata->cfg_threads > 1)
+		pdata->workers = osdl_workers_init(pdata->cfg_threads - 1);
+
+	if (pdata->stats == NULL && pdata->cfg_stats >= 0)
+		osdl_video_set_stats(pdata, osdl_stats_init(pdata->cfg_stats));
+
 	if (!doublebuf) {
 		if (flags & SDL_DOUBLEBUF) {
 			log("doublebuffering could not be set\n");
@@ -168,8 +260,15 @@ static SDL_Surface *omap_SetVideoMode(SDL_VideoDevice *this, SDL_Surface *curren
 	if (!(flags & SDL_DOUBLEBUF) && pdata->cfg_force_directbuf)
 		fbmem = pdata->front_buffer;
 
-	flags |= SDL_FULLSCREEN | SDL_HWSURFACE;
-	unhandled_flags = flags & ~(SDL_FULLSCREEN | SDL_HWSURFACE | SDL_DOUBLEBUF);
+	if (bpp == 8) {
+		/* not a hw surface, or SDL would add a shadow for sw apps */
+		flags &= ~SDL_HWSURFACE;
+		flags |= SDL_FULLSCREEN | SDL_HWPALETTE;
+	}
+	else
+		flags |= SDL_FULLSCREEN | SDL_HWSURFACE;
+	unhandled_flags = flags & ~(SDL_FULLSCREEN | SDL_HWSURFACE | SDL_DOUBLEBUF
+		| SDL_HWPALETTE);
 	if (unhandled_flags != 0) {
 		log("dropping unhandled flags: %08x", unhandled_flags);
 		flags &= ~unhandled_flags;
@@ -182,6 +281,28 @@ static SDL_Surface *omap_SetVideoMode(SDL_VideoDevice *this, SDL_Surface *curren
 	current->pixels = fbmem;
 	pdata->app_uses_flip = 0;
 
+	free(pdata->clut_pixels);
+	pdata->clut_pixels = NULL;
+	pdata->clut_bpp = 0;
+	if (bpp == 8) {
+		pdata->clut_pixels = calloc(height, current->pitch);
+		if (pdata->clut_pixels == NULL) {
+			SDL_OutOfMemory();
+			return NULL;
+		}
+		pdata->clut_back = fbmem;
+		pdata->clut_bpp = fb_bpp;
+		pdata->clut_pitch = width * fb_bpp / 8;
+		current->pixels = pdata->clut_pixels;
+	}
+
+	free(pdata->dirty_map);
+	pdata->dirty_cols = (width + DIRTY_TILE_W - 1) / DIRTY_TILE_W;
+	pdata->dirty_rows = (height + DIRTY_TILE_H - 1) / DIRTY_TILE_H;
+	pdata->dirty_map = malloc(pdata->dirty_cols * pdata->dirty_rows);
+	if (pdata->dirty_map == NULL)
+		err("no memory for damage map, UpdateRects will copy everything");
+
 	if (pdata->layer_w != 0 && pdata->layer_h != 0) {
 		int v_width  = width  - (pdata->border_l + pdata->border_r);
 		int v_height = height - (pdata->border_t + pdata->border_b);
@@ -203,16 +324,84 @@ static SDL_Surface *omap_SetVideoMode(SDL_VideoDevice *this, SDL_Surface *curren
 	return current;
 }
 
+#ifndef __ARM_NEON__
+static void clut8to16(void *dst, const void *src, const unsigned short *lut,
+	int count)
+{
+	const unsigned char *s = src;
+	unsigned short *d = dst;
+
+	while (count-- > 0)
+		*d++ = lut[*s++];
+}
+
+static void clut8to32(void *dst, const void *src, const unsigned int *lut,
+	int count)
+{
+	const unsigned char *s = src;
+	unsigned int *d = dst;
+
+	while (count-- > 0)
+		*d++ = lut[*s++];
+}
+#endif
+
+/* 8bpp surface -> framebuffer through the palette */
+static void clut_rect(struct SDL_PrivateVideoData *pdata, SDL_Surface *screen,
+	char *dst, int x, int y, int w, int h)
+{
+	int Bpp = pdata->clut_bpp / 8;
+	const char *s = (char *)screen->pixels + y * screen->pitch + x;
+	char *d = dst + y * pdata->clut_pitch + x * Bpp;
+
+	if (w == screen->pitch && w * Bpp == pdata->clut_pitch) {
+		w *= h;
+		h = 1;
+	}
+
+	for (; h > 0; h--, s += screen->pitch, d += pdata->clut_pitch) {
+		if (Bpp == 2)
+			clut8to16(d, s, pdata->clut_lut16, w);
+		else
+			clut8to32(d, s, pdata->clut_lut32, w);
+	}
+}
+
+/* whole frame to the back buffer, then show it */
+static void clut_flip(struct SDL_PrivateVideoData *pdata, SDL_Surface *screen)
+{
+	void *buf = pdata->clut_back;
+
+	update_rect(pdata, screen, buf, NULL, 0, 0, screen->w, screen->h);
+	pdata->clut_back = osdl_video_flip(pdata);
+	pdata->front_buffer = buf;
+}
+
 static int omap_LockHWSurface(SDL_VideoDevice *this, SDL_Surface *surface)
 {
 	trace("%p", surface);
 
+	if (surface->pixels == NULL) {
+		SDL_SetError("Surface lost its video memory");
+		return -1;
+	}
+
+	/* CPU access, wait for queued blits */
+	osdl_accel_sync(this->hidden->accel);
+
+	/* app has the pointer now, VRAM compaction must not move it */
+	if (surface->hwdata != NULL)
+		osdl_vram_pin((struct osdl_vram_block *)surface->hwdata, 1);
+
 	return 0;
 }
 
 static void omap_UnlockHWSurface(SDL_VideoDevice *this, SDL_Surface *surface)
 {
 	trace("%p", surface);
+
+	if (surface->hwdata != NULL)
+		osdl_vram_pin((struct osdl_vram_block *)surface->hwdata, 0);
 }
 
 static int omap_FlipHWSurface(SDL_VideoDevice *this, SDL_Surface *surface)
@@ -231,12 +420,18 @@ static int omap_FlipHWSurface(SDL_VideoDevice *this, SDL_Surface *surface)
 		return;
 	}
 
-	if (surface->flags & SDL_DOUBLEBUF)
+	osdl_accel_sync(pdata->accel);
+	osdl_accel_frame(pdata->accel);
+	osdl_stats_frame(pdata->stats);
+
+	if (pdata->clut_bpp)
+		clut_flip(pdata, surface);
+	else if (surface->flags & SDL_DOUBLEBUF)
 		surface->pixels = osdl_video_flip(pdata);
 	else {
 		if (surface->pixels != pdata->front_buffer)
-			memcpy(surface->pixels, pdata->front_buffer,
-				surface->pitch * surface->h);
+			update_rect(pdata, surface, pdata->front_buffer,
+				surface->pixels, 0, 0, surface->w, surface->h);
 	}
 
 	pdata->app_uses_flip = 1;
@@ -244,22 +439,321 @@ static int omap_FlipHWSurface(SDL_VideoDevice *this, SDL_Surface *surface)
 	return 0;
 }
 
-/* we can't do hw surfaces (besides screen one) yet */
+/* hw surfaces live in spare VRAM after the framebuffers,
+ * SDL falls back to system memory if this fails */
 static int omap_AllocHWSurface(SDL_VideoDevice *this, SDL_Surface *surface)
 {
+	struct SDL_PrivateVideoData *pdata = this->hidden;
+	struct osdl_vram_block *block;
+	size_t size;
+	void *pixels;
+
 	trace("%p", surface);
-	return -1;
+
+	/* compaction may move memory around */
+	osdl_accel_sync(pdata->accel);
+
+	size = surface->h * surface->pitch;
+	block = osdl_vram_alloc(pdata->vram, size, surface, &pixels);
+	if (block == NULL) {
+		SDL_SetError("Not enough video memory");
+		return -1;
+	}
+
+	memset(pixels, 0, size);
+	surface->flags |= SDL_HWSURFACE;
+	surface->pixels = pixels;
+	surface->hwdata = (struct private_hwdata *)block;
+	return 0;
 }
 
 static void omap_FreeHWSurface(SDL_VideoDevice *this, SDL_Surface *surface)
 {
 	trace("%p", surface);
+
+	osdl_accel_sync(this->hidden->accel);
+	osdl_vram_free(this->hidden->vram, (struct osdl_vram_block *)surface->hwdata);
+	surface->pixels = NULL;
+	surface->hwdata = NULL;
+}
+
+static void accel_buf(struct SDL_PrivateVideoData *pdata,
+	struct osdl_accel_buf *buf, void *pixels, int pitch, int x, int y, int Bpp)
+{
+	buf->virt = (char *)pixels + y * pitch + x * Bpp;
+	buf->phys = osdl_video_phys_addr(pdata, buf->virt);
+	buf->pitch = pitch;
+}
+
+static int omap_HWAccelBlit(SDL_Surface *src, SDL_Rect *srcrect,
+	SDL_Surface *dst, SDL_Rect *dstrect)
+{
+	struct SDL_PrivateVideoData *pdata = current_video->hidden;
+	int Bpp = dst->format->BytesPerPixel;
+	struct osdl_accel_buf d, s;
+
+	/* either might have been moved to system memory since mapping */
+	if (src != dst && (src->flags & dst->flags & SDL_HWSURFACE)
+	    && src->pixels != NULL && dst->pixels != NULL
+	    && srcrect->w * srcrect->h * Bpp >= ACCEL_MIN_BYTES)
+	{
+		accel_buf(pdata, &s, src->pixels, src->pitch,
+			srcrect->x, srcrect->y, Bpp);
+		accel_buf(pdata, &d, dst->pixels, dst->pitch,
+			dstrect->x, dstrect->y, Bpp);
+		if (osdl_accel_copy(pdata->accel, &d, &s,
+				srcrect->w * Bpp, srcrect->h) == 0)
+			return 0;
+	}
+
+	return src->map->sw_blit(src, srcrect, dst, dstrect);
+}
+
+/* plain same format copies only */
+static int omap_CheckHWBlit(SDL_VideoDevice *this, SDL_Surface *src, SDL_Surface *dst)
+{
+	trace("%p, %p", src, dst);
+
+	src->flags &= ~SDL_HWACCEL;
+	if (this->hidden->accel == NULL
+	    || (src->flags & (SDL_SRCCOLORKEY | SDL_SRCALPHA)))
+		return 0;
+
+	src->flags |= SDL_HWACCEL;
+	src->map->hw_blit = omap_HWAccelBlit;
+	return 1;
+}
+
+static int omap_FillHWRect(SDL_VideoDevice *this, SDL_Surface *dst,
+	SDL_Rect *rect, Uint32 color)
+{
+	struct SDL_PrivateVideoData *pdata = this->hidden;
+	int Bpp = dst->format->BytesPerPixel;
+	struct osdl_accel_buf d;
+
+	trace("%p, %d,%d %dx%d, %08x", dst, rect->x, rect->y, rect->w, rect->h, color);
+
+	if (dst->pixels == NULL) {
+		SDL_SetError("Surface lost its video memory");
+		return -1;
+	}
+
+	accel_buf(pdata, &d, dst->pixels, dst->pitch, rect->x, rect->y, Bpp);
+	if (rect->w * rect->h * Bpp >= ACCEL_MIN_BYTES
+	    && osdl_accel_fill(pdata->accel, &d, rect->w, rect->h, Bpp, color) == 0)
+		return 0;
+
+	osdl_accel_sync(pdata->accel);
+	osdl_fill(d.virt, d.pitch, rect->w, rect->h, Bpp, color);
+	return 0;
+}
+
+static void copy_rect_cpu(char *dst, const char *src, int pitch,
+	int x, int y, int w, int h, int Bpp)
+{
+	int offs = y * pitch + x * Bpp;
+
+	if (w * Bpp == pitch) {
+		fbcopy(dst + offs, src + offs, pitch * h);
+		return;
+	}
+
+	for (; h > 0; offs += pitch, h--)
+		fbcopy(dst + offs, src + offs, w * Bpp);
+}
+
+static void copy_rect(struct SDL_PrivateVideoData *pdata, char *dst,
+	const char *src, int pitch, int x, int y, int w, int h, int Bpp)
+{
+	if (pdata->accel != NULL && w * h * Bpp >= ACCEL_MIN_BYTES) {
+		struct osdl_accel_buf d, s;
+		accel_buf(pdata, &d, dst, pitch, x, y, Bpp);
+		accel_buf(pdata, &s, (void *)src, pitch, x, y, Bpp);
+		if (osdl_accel_copy(pdata->accel, &d, &s, w * Bpp, h) == 0)
+			return;
+	}
+
+	/* queued blits may still be writing the source */
+	osdl_accel_sync(pdata->accel);
+	copy_rect_cpu(dst, src, pitch, x, y, w, h, Bpp);
 }
 
+struct band_work {
+	struct SDL_PrivateVideoData *pdata;
+	SDL_Surface *screen;
+	char *dst;
+	const char *src;
+	int x, y, w, h;
+};
+
+static void update_band(void *arg, int band, int bands)
+{
+	struct band_work *bw = arg;
+	int y0 = bw->y + bw->h * band / bands;
+	int y1 = bw->y + bw->h * (band + 1) / bands;
+
+	if (bw->pdata->clut_bpp)
+		clut_rect(bw->pdata, bw->screen, bw->dst, bw->x, y0, bw->w, y1 - y0);
+	else
+		copy_rect_cpu(bw->dst, bw->src, bw->screen->pitch, bw->x, y0,
+			bw->w, y1 - y0, bw->screen->format->BytesPerPixel);
+}
+
+static void update_rect(struct SDL_PrivateVideoData *pdata, SDL_Surface *screen,
+	char *dst, const char *src, int x, int y, int w, int h)
+{
+	int Bpp = pdata->clut_bpp ? pdata->clut_bpp / 8
+		: screen->format->BytesPerPixel;
+	unsigned long long t = osdl_stats_begin(pdata->stats);
+	struct band_work bw;
+	int bands;
+
+	/* big ones in horizontal bands on all cores,
+	 * copies go to the accel backend instead if there is one */
+	if (pdata->workers != NULL && w * h * Bpp >= THREADS_MIN_BYTES
+	    && (pdata->clut_bpp || pdata->accel == NULL))
+	{
+		bands = osdl_workers_count(pdata->workers);
+		if (bands > h / THREADS_MIN_LINES)
+			bands = h / THREADS_MIN_LINES;
+		if (bands > 1) {
+			bw.pdata = pdata;
+			bw.screen = screen;
+			bw.dst = dst;
+			bw.src = src;
+			bw.x = x, bw.y = y, bw.w = w, bw.h = h;
+			osdl_workers_run(pdata->workers, update_band, &bw, bands);
+			goto out;
+		}
+	}
+
+	if (pdata->clut_bpp)
+		clut_rect(pdata, screen, dst, x, y, w, h);
+	else
+		copy_rect(pdata, dst, src, screen->pitch, x, y, w, h,
+			screen->format->BytesPerPixel);
+out:
+	osdl_stats_copy(pdata->stats, t, w * h * Bpp);
+}
+
+/* only entries that actually changed are converted, and like with a real
+ * hardware palette the change is visible right away */
 static int omap_SetColors(SDL_VideoDevice *this, int firstcolor, int ncolors, SDL_Color *colors)
 {
+	struct SDL_PrivateVideoData *pdata = this->hidden;
+	SDL_Surface *screen = this->screen;
+	int i, r, g, b, changed = 0;
+	unsigned int c32;
+
 	trace("%d, %d, %p", firstcolor, ncolors, colors);
-	return 0;
+
+	if (!pdata->clut_bpp)
+		return 0;
+
+	for (i = 0; i < ncolors && firstcolor + i < 256; i++) {
+		r = colors[i].r, g = colors[i].g, b = colors[i].b;
+		c32 = (r << 16) | (g << 8) | b;
+		if (c32 == pdata->clut_lut32[firstcolor + i])
+			continue;
+		pdata->clut_lut32[firstcolor + i] = c32;
+		pdata->clut_lut16[firstcolor + i] =
+			((r << 8) & 0xf800) | ((g << 3) & 0x07e0) | (b >> 3);
+		changed = 1;
+	}
+
+	if (!changed || screen == NULL || screen->pixels != pdata->clut_pixels)
+		return 1;
+
+	if (!(screen->flags & SDL_DOUBLEBUF))
+		clut_rect(pdata, screen, pdata->front_buffer,
+			0, 0, screen->w, screen->h);
+	/* flipping apps will have it on the next frame anyway */
+	else if (!pdata->app_uses_flip)
+		clut_flip(pdata, screen);
+
+	return 1;
+}
+
+/* mark tiles touched by rects, returns number of newly dirty tiles */
+static int mark_dirty(struct SDL_PrivateVideoData *pdata, SDL_Surface *screen,
+	int nrects, SDL_Rect *rects)
+{
+	int i, x, y, w, h, tx, ty, tx1, ty1;
+	int marked = 0;
+	unsigned char *row;
+
+	for (i = 0; i < nrects; i++) {
+		/* this supposedly has no clipping, but we'll do it anyway */
+		x = rects[i].x, y = rects[i].y, w = rects[i].w, h = rects[i].h;
+		if (x < 0)
+			w += x, x = 0;
+		if (x + w > screen->w)
+			w = screen->w - x;
+		if (y < 0)
+			h += y, y = 0;
+		if (y + h > screen->h)
+			h = screen->h - y;
+		if (w <= 0 || h <= 0)
+			continue;
+
+		tx1 = (x + w - 1) / DIRTY_TILE_W;
+		ty1 = (y + h - 1) / DIRTY_TILE_H;
+		for (ty = y / DIRTY_TILE_H; ty <= ty1; ty++) {
+			row = pdata->dirty_map + ty * pdata->dirty_cols;
+			for (tx = x / DIRTY_TILE_W; tx <= tx1; tx++) {
+				marked += !row[tx];
+				row[tx] = 1;
+			}
+		}
+	}
+
+	return marked;
+}
+
+/* copy each horizontal run of dirty tiles once,
+ * fully dirty tile rows get merged vertically */
+static void copy_dirty(struct SDL_PrivateVideoData *pdata, SDL_Surface *screen,
+	char *dst, const char *src)
+{
+	int cols = pdata->dirty_cols, rows = pdata->dirty_rows;
+	int tx, ty, ty_end, start, x, y, w, h;
+	const unsigned char *row;
+
+	for (ty = 0; ty < rows; ty = ty_end) {
+		row = pdata->dirty_map + ty * cols;
+		ty_end = ty + 1;
+		y = ty * DIRTY_TILE_H;
+
+		if (memchr(row, 0, cols) == NULL) {
+			while (ty_end < rows && memchr(row + (ty_end - ty) * cols,
+						0, cols) == NULL)
+				ty_end++;
+			h = ty_end * DIRTY_TILE_H;
+			if (h > screen->h)
+				h = screen->h;
+			update_rect(pdata, screen, dst, src, 0, y,
+				screen->w, h - y);
+			continue;
+		}
+
+		h = screen->h - y;
+		if (h > DIRTY_TILE_H)
+			h = DIRTY_TILE_H;
+
+		for (tx = 0; tx < cols; ) {
+			if (!row[tx]) {
+				tx++;
+				continue;
+			}
+			for (start = tx; tx < cols && row[tx]; tx++)
+				;
+			x = start * DIRTY_TILE_W;
+			w = tx * DIRTY_TILE_W;
+			if (w > screen->w)
+				w = screen->w;
+			update_rect(pdata, screen, dst, src, x, y, w - x, h);
+		}
+	}
 }
 
 static void omap_UpdateRects(SDL_VideoDevice *this, int nrects, SDL_Rect *rects)
@@ -267,19 +761,27 @@ static void omap_UpdateRects(SDL_VideoDevice *this, int nrects, SDL_Rect *rects)
 	struct SDL_PrivateVideoData *pdata = this->hidden;
 	SDL_Surface *screen = this->screen;
 	int fullscreen_blit = 0;
-	int i, Bpp, x, y, w, h;
+	int marked, total;
 	char *src, *dst;
 
 	trace("%d, %p", nrects, rects);
 
+	osdl_accel_frame(pdata->accel);
+	osdl_stats_frame(pdata->stats);
+
 	fullscreen_blit =
 		nrects == 1 && rects->x == 0 && rects->y == 0
 		    && (rects->w == screen->w || rects->w == 0)
 		    && (rects->h == screen->h || rects->h == 0);
 
 	if (screen->flags & SDL_DOUBLEBUF) {
-		if (fullscreen_blit && !pdata->app_uses_flip)
-			screen->pixels = osdl_video_flip(pdata);
+		if (fullscreen_blit && !pdata->app_uses_flip) {
+			osdl_accel_sync(pdata->accel);
+			if (pdata->clut_bpp)
+				clut_flip(pdata, screen);
+			else
+				screen->pixels = osdl_video_flip(pdata);
+		}
 		return;
 	}
 
@@ -288,31 +790,164 @@ static void omap_UpdateRects(SDL_VideoDevice *this, int nrects, SDL_Rect *rects)
 	if (src == dst)
 		return;
 
-	if (fullscreen_blit) {
-		memcpy(dst, src, screen->pitch * screen->h);
+	if (fullscreen_blit || pdata->dirty_map == NULL) {
+		update_rect(pdata, screen, dst, src, 0, 0,
+			screen->w, screen->h);
 		return;
 	}
 
-	for (i = 0, Bpp = screen->format->BytesPerPixel; i < nrects; i++) {
-		/* this supposedly has no clipping, but we'll do it anyway */
-		x = rects[i].x, y = rects[i].y, w = rects[i].w, h = rects[i].h;
-		if (x < 0)
-			w += x, x = 0;
-		else if (x + w > screen->w)
-			w = screen->w - x;
-		if (w <= 0)
-			continue;
+	/* overlapping and adjacent rects get merged in the tile map,
+	 * so that every pixel is copied just once */
+	total = pdata->dirty_cols * pdata->dirty_rows;
+	memset(pdata->dirty_map, 0, total);
+	marked = mark_dirty(pdata, screen, nrects, rects);
+	if (marked == 0)
+		return;
 
-		if (y < 0)
-			h += y, y = 0;
-		else if (y + h > screen->h)
-			h = screen->h - y;
+	if (marked * 100 >= total * DIRTY_FULL_COPY_PCT) {
+		update_rect(pdata, screen, dst, src, 0, 0,
+			screen->w, screen->h);
+		return;
+	}
+
+	copy_dirty(pdata, screen, dst, src);
+}
+
+struct private_yuvhwdata {
+	struct osdl_yuv *yuv;
+	Uint16 pitch;
+	Uint8 *pixels;
+};
+
+/* app writes straight to the scanned out buffer */
+static int omap_LockYUVOverlay(SDL_VideoDevice *this, SDL_Overlay *overlay)
+{
+	return 0;
+}
+
+static void omap_UnlockYUVOverlay(SDL_VideoDevice *this, SDL_Overlay *overlay)
+{
+}
+
+static int omap_DisplayYUVOverlay(SDL_VideoDevice *this, SDL_Overlay *overlay,
+	SDL_Rect *src, SDL_Rect *dst)
+{
+	struct SDL_PrivateVideoData *pdata = this->hidden;
+	int v_w, v_h, sx, sy, sw, sh, x, y, w, h, c;
+
+	trace("%d,%d %dx%d -> %d,%d %dx%d", src->x, src->y, src->w, src->h,
+		dst->x, dst->y, dst->w, dst->h);
+
+	/* SDL clipped to the surface, clip to the visible part too,
+	 * adjusting source proportionally */
+	v_w = this->screen->w - pdata->border_l - pdata->border_r;
+	v_h = this->screen->h - pdata->border_t - pdata->border_b;
+	sx = src->x; sy = src->y; sw = src->w; sh = src->h;
+	x = dst->x - pdata->border_l; y = dst->y - pdata->border_t;
+	w = dst->w; h = dst->h;
+	if (x < 0) {
+		c = -x * sw / w;
+		sx += c; sw -= c; w += x; x = 0;
+	}
+	if (x + w > v_w) {
+		c = (x + w - v_w) * sw / w;
+		sw -= c; w = v_w - x;
+	}
+	if (y < 0) {
+		c = -y * sh / h;
+		sy += c; sh -= c; h += y; y = 0;
+	}
+	if (y + h > v_h) {
+		c = (y + h - v_h) * sh / h;
+		sh -= c; h = v_h - y;
+	}
+	if (sw <= 0 || sh <= 0 || w <= 0 || h <= 0)
+		return 0;
+
+	/* surface -> physical screen coords */
+	if (pdata->layer_w != 0 && pdata->layer_h != 0) {
+		w = (x + w) * pdata->layer_w / v_w;
+		h = (y + h) * pdata->layer_h / v_h;
+		x = x * pdata->layer_w / v_w;
+		y = y * pdata->layer_h / v_h;
+		w -= x; h -= y;
+		x += pdata->layer_x;
+		y += pdata->layer_y;
+	}
 
-		for (; h > 0; y++, h--)
-			memcpy(dst + y * screen->pitch + x * Bpp,
-			       src + y * screen->pitch + x * Bpp,
-			       w * Bpp);
+	if (osdl_yuv_display(pdata, overlay->hwdata->yuv,
+			sx, sy, sw, sh, x, y, w, h) != 0) {
+		SDL_SetError("YUV overlay display failed");
+		return -1;
 	}
+
+	return 0;
+}
+
+static void omap_FreeYUVOverlay(SDL_VideoDevice *this, SDL_Overlay *overlay)
+{
+	struct private_yuvhwdata *hwdata = overlay->hwdata;
+
+	if (hwdata == NULL)
+		return;
+
+	if (hwdata->yuv == this->hidden->yuv)
+		osdl_yuv_destroy(this->hidden, hwdata->yuv);
+	free(hwdata);
+	overlay->hwdata = NULL;
+}
+
+static struct private_yuvhwfuncs omap_yuvfuncs = {
+	omap_LockYUVOverlay,
+	omap_UnlockYUVOverlay,
+	omap_DisplayYUVOverlay,
+	omap_FreeYUVOverlay,
+};
+
+/* DSS video pipelines can only do packed formats here,
+ * planar ones are left for the software fallback */
+static SDL_Overlay *omap_CreateYUVOverlay(SDL_VideoDevice *this, int width,
+	int height, Uint32 format, SDL_Surface *display)
+{
+	struct private_yuvhwdata *hwdata;
+	SDL_Overlay *overlay;
+	void *pixels;
+	int pitch;
+
+	trace("%d, %d, %08x", width, height, format);
+
+	if (format != SDL_YUY2_OVERLAY && format != SDL_UYVY_OVERLAY)
+		return NULL;
+
+	overlay = calloc(1, sizeof(*overlay));
+	hwdata = calloc(1, sizeof(*hwdata));
+	if (overlay == NULL || hwdata == NULL)
+		goto fail;
+
+	hwdata->yuv = osdl_yuv_create(this->hidden, width, height,
+		format == SDL_UYVY_OVERLAY, &pixels, &pitch);
+	if (hwdata->yuv == NULL)
+		goto fail;
+
+	hwdata->pixels = pixels;
+	hwdata->pitch = pitch;
+
+	overlay->format = format;
+	overlay->w = width;
+	overlay->h = height;
+	overlay->planes = 1;
+	overlay->pitches = &hwdata->pitch;
+	overlay->pixels = &hwdata->pixels;
+	overlay->hwfuncs = &omap_yuvfuncs;
+	overlay->hwdata = hwdata;
+	overlay->hw_overlay = 1;
+
+	return overlay;
+
+fail:
+	free(hwdata);
+	free(overlay);
+	return NULL;
 }
 
 static void omap_InitOSKeymap(SDL_VideoDevice *this)
@@ -424,6 +1059,7 @@ static int xkey_cb(void *cb_arg, int kc, int is_pressed)
 	int ret;
 
 	if (kc == XF86XK_MenuKB && is_pressed) {
+		osdl_accel_sync(pdata->accel);
 		ret = osdl_video_pause(pdata, 1);
 		if (ret == 0) {
 			xenv_minimize();
@@ -525,6 +1161,9 @@ static SDL_VideoDevice *omap_create(int devindex)
 	this->FreeHWSurface = omap_FreeHWSurface;
 	this->SetColors = omap_SetColors;
 	this->UpdateRects = omap_UpdateRects;
+	this->CreateYUVOverlay = omap_CreateYUVOverlay;
+	this->CheckHWBlit = omap_CheckHWBlit;
+	this->FillHWRect = omap_FillHWRect;
 	this->VideoQuit = omap_VideoQuit;
 	this->InitOSKeymap = omap_InitOSKeymap;
 	this->PumpEvents = omap_PumpEvents;
@@ -540,3 +1179,39 @@ VideoBootStrap omapdss_bootstrap = {
 	omap_available, omap_create
 };
 
+
+DECLSPEC int SDLCALL SDL_OMAP_GetStats(SDL_OMAP_Stats *stats)
+{
+	struct SDL_PrivateVideoData *pdata;
+	struct osdl_stats_info info;
+	int i;
+
+	if (current_video == NULL || current_video->name == NULL
+	    || strcmp(current_video->name, omapdss_bootstrap.name) != 0) {
+		SDL_SetError("omapdss video driver not in use");
+		return -1;
+	}
+
+	pdata = current_video->hidden;
+	if (pdata->stats == NULL)
+		osdl_video_set_stats(pdata, osdl_stats_init(0));
+	osdl_stats_get(pdata->stats, &info);
+
+	stats->frames = info.frames;
+	stats->missed_vblanks = info.missed_vblanks;
+	stats->frame_us_last = info.frame_us_last;
+	stats->frame_us_avg = info.frame_us_avg;
+	stats->frame_us_max = info.frame_us_max;
+	stats->flip_us_avg = info.flip_us_avg;
+	stats->flip_us_max = info.flip_us_max;
+	stats->copy_us_avg = info.copy_us_avg;
+	stats->copy_us_max = info.copy_us_max;
+	stats->copy_bytes_last = info.copy_bytes_last;
+	stats->copy_bytes_avg = info.copy_bytes_avg;
+	for (i = 0; i < SDL_OMAP_STATS_HIST; i++)
+		stats->latency_hist[i] = info.latency_hist[i];
+	for (i = 0; i < SDL_OMAP_STATS_LOG; i++)
+		stats->frame_time_us[i] = info.frame_time_us[i];
+
+	return 0;
+}
@@ -240,6 +240,7 @@ SDL_Overlay *X11_CreateYUVOverlay(_THIS, int width, int height, Uint32 format, S
 	    case SDL_YUY2_OVERLAY:
 	    case SDL_UYVY_OVERLAY:
 	    case SDL_YVYU_OVERLAY:
+	    case SDL_P010_OVERLAY:
 		bpp = 2;
 		break;
 	    default:
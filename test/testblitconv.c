@@ -0,0 +1,197 @@
+/*
+ * Checks the optimized pixel format conversion blitters against the
+ * generic C ones bit for bit, and times both.
+ *
+ * The C results come from a second pass with the SIMD blitters turned
+ * off through SDL_NEON_BLIT_FEATURES / SDL_ALTIVEC_BLIT_FEATURES.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+struct conv_test {
+	const char *name;
+	int sbpp;
+	Uint32 sR, sG, sB, sA;
+	int dbpp;
+	Uint32 dR, dG, dB, dA;
+};
+
+static const struct conv_test tests[] = {
+	{ "RGB888->RGB565",     32, 0x00FF0000,0x0000FF00,0x000000FF,0x00000000,
+	                        16, 0x0000F800,0x000007E0,0x0000001F,0x00000000 },
+	{ "ARGB8888->RGB565",   32, 0x00FF0000,0x0000FF00,0x000000FF,0xFF000000,
+	                        16, 0x0000F800,0x000007E0,0x0000001F,0x00000000 },
+	{ "BGR888->RGB565",     32, 0x000000FF,0x0000FF00,0x00FF0000,0x00000000,
+	                        16, 0x0000F800,0x000007E0,0x0000001F,0x00000000 },
+	{ "RGB565->XRGB8888",   16, 0x0000F800,0x000007E0,0x0000001F,0x00000000,
+	                        32, 0x00FF0000,0x0000FF00,0x000000FF,0x00000000 },
+	{ "RGB555->RGB565",     16, 0x00007C00,0x000003E0,0x0000001F,0x00000000,
+	                        16, 0x0000F800,0x000007E0,0x0000001F,0x00000000 },
+	{ "RGB565->RGB555",     16, 0x0000F800,0x000007E0,0x0000001F,0x00000000,
+	                        16, 0x00007C00,0x000003E0,0x0000001F,0x00000000 },
+	{ "ARGB8888->XRGB8888", 32, 0x00FF0000,0x0000FF00,0x000000FF,0xFF000000,
+	                        32, 0x00FF0000,0x0000FF00,0x000000FF,0x00000000 },
+	{ "ABGR8888->XRGB8888", 32, 0x000000FF,0x0000FF00,0x00FF0000,0xFF000000,
+	                        32, 0x00FF0000,0x0000FF00,0x000000FF,0x00000000 },
+};
+#define NUM_TESTS (sizeof(tests) / sizeof(tests[0]))
+
+/* odd widths catch edge handling, the last one is timed */
+static const int widths[] = { 1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 0 };
+#define NUM_WIDTHS (sizeof(widths) / sizeof(widths[0]))
+
+static int width = 640, height = 480, loops = 100;
+
+struct result {
+	Uint8 *pixels[NUM_WIDTHS];
+	Uint32 ms;
+};
+static struct result results[2][NUM_TESTS];
+
+static SDL_Surface *make_src(const struct conv_test *t, int w, int h)
+{
+	SDL_Surface *s;
+	int x, y;
+
+	s = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, t->sbpp,
+	                         t->sR, t->sG, t->sB, t->sA);
+	if (s == NULL)
+		return NULL;
+	SDL_SetAlpha(s, 0, 0);
+
+	srand(w * 31 + h);
+	for (y = 0; y < h; y++) {
+		Uint8 *p = (Uint8 *)s->pixels + y * s->pitch;
+		for (x = 0; x < s->pitch; x++)
+			p[x] = rand() >> 4;
+	}
+	return s;
+}
+
+static SDL_Surface *make_dst(const struct conv_test *t, int w, int h)
+{
+	SDL_Surface *d;
+
+	d = SDL_CreateRGBSurface(SDL_SWSURFACE, w, h, t->dbpp,
+	                         t->dR, t->dG, t->dB, t->dA);
+	if (d != NULL)
+		memset(d->pixels, 0x5a, d->pitch * d->h);
+	return d;
+}
+
+static int run_test(const struct conv_test *t, struct result *r)
+{
+	SDL_Surface *src, *dst;
+	Uint32 start;
+	int i, w, h, row;
+
+	for (i = 0; i < NUM_WIDTHS; i++) {
+		w = widths[i] ? widths[i] : width;
+		h = widths[i] ? 4 : height;
+		src = make_src(t, w, h);
+		dst = make_dst(t, w, h);
+		if (src == NULL || dst == NULL) {
+			fprintf(stderr, "Couldn't create surfaces: %s\n", SDL_GetError());
+			return -1;
+		}
+
+		if (SDL_BlitSurface(src, NULL, dst, NULL) < 0) {
+			fprintf(stderr, "Blit failed: %s\n", SDL_GetError());
+			return -1;
+		}
+
+		r->pixels[i] = malloc(w * h * 4);
+		for (row = 0; row < h; row++)
+			memcpy(r->pixels[i] + row * w * dst->format->BytesPerPixel,
+			       (Uint8 *)dst->pixels + row * dst->pitch,
+			       w * dst->format->BytesPerPixel);
+
+		if (widths[i] == 0) {
+			start = SDL_GetTicks();
+			for (row = 0; row < loops; row++)
+				SDL_BlitSurface(src, NULL, dst, NULL);
+			r->ms = SDL_GetTicks() - start;
+		}
+
+		SDL_FreeSurface(src);
+		SDL_FreeSurface(dst);
+	}
+	return 0;
+}
+
+static int compare(const struct conv_test *t)
+{
+	int i, w, h, len, ofs, bad = 0;
+
+	for (i = 0; i < NUM_WIDTHS; i++) {
+		w = widths[i] ? widths[i] : width;
+		h = widths[i] ? 4 : height;
+		len = w * h * (t->dbpp / 8);
+		for (ofs = 0; ofs < len; ofs++)
+			if (results[0][t - tests].pixels[i][ofs] !=
+			    results[1][t - tests].pixels[i][ofs])
+				break;
+		if (ofs < len) {
+			printf("  mismatch at width %d, pixel %d\n",
+			       w, ofs / (t->dbpp / 8));
+			bad++;
+		}
+	}
+	return bad;
+}
+
+int main(int argc, char *argv[])
+{
+	int i, pass, bad = 0;
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+			width = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc)
+			height = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			loops = atoi(argv[++i]);
+		else {
+			fprintf(stderr, "usage: %s [-w width] [-h height] [-n loops]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if (SDL_Init(0) < 0) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return 1;
+	}
+
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			/* the overrides are read once until SDL_Quit() */
+			SDL_Quit();
+			SDL_putenv("SDL_NEON_BLIT_FEATURES=0");
+			SDL_putenv("SDL_ALTIVEC_BLIT_FEATURES=0");
+			if (SDL_Init(0) < 0) {
+				fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+				return 1;
+			}
+		}
+		for (i = 0; i < NUM_TESTS; i++)
+			if (run_test(&tests[i], &results[pass][i]) < 0)
+				return 1;
+	}
+
+	printf("%dx%d, %d blits each\n", width, height, loops);
+	printf("%-20s %10s %10s %8s\n", "", "optimized", "C", "speedup");
+	for (i = 0; i < NUM_TESTS; i++) {
+		int test_bad = compare(&tests[i]);
+		Uint32 ms0 = results[0][i].ms, ms1 = results[1][i].ms;
+		printf("%-20s %8u ms %8u ms %7.2fx %s\n", tests[i].name, ms0, ms1,
+		       ms0 ? (double)ms1 / ms0 : 0.0, test_bad ? "MISMATCH" : "ok");
+		bad += test_bad;
+	}
+
+	SDL_Quit();
+	return bad ? 1 : 0;
+}
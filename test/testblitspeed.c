@@ -13,6 +13,7 @@
 static SDL_Surface *dest = NULL;
 static SDL_Surface *src = NULL;
 static int testSeconds = 10;
+static int testFill = 0;
 
 
 static int percent(int val, int total)
@@ -156,7 +157,10 @@ static Uint32 blit(SDL_Surface *dst, SDL_Surface *src, int x, int y)
     dstRect.h = srcRect.h = src->h;
 
     start = SDL_GetTicks();
-    SDL_BlitSurface(src, &srcRect, dst, &dstRect);
+    if (testFill)
+        SDL_FillRect(dst, &dstRect, SDL_MapRGB(dst->format, 0x40, 0x80, 0xC0));
+    else
+        SDL_BlitSurface(src, &srcRect, dst, &dstRect);
     return(SDL_GetTicks() - start);
 }
 
@@ -186,6 +190,8 @@ static int atoi_hex(const char *str)
 
 static int setup_test(int argc, char **argv)
 {
+    static char threads_env[64];
+    static char threadsmin_env[64];
     const char *dumpfile = NULL;
     SDL_Surface *bmp = NULL;
     Uint32 dstbpp = 32;
@@ -255,6 +261,21 @@ static int setup_test(int argc, char **argv)
             screenSurface = 1;
         else if (strcmp(arg, "--dumpfile") == 0)
             dumpfile = argv[++i];
+        else if (strcmp(arg, "--threads") == 0)
+        {
+            /* the blit thread pool is started by SDL_Init() */
+            SDL_snprintf(threads_env, sizeof (threads_env),
+                         "SDL_BLIT_THREADS=%s", argv[++i]);
+            SDL_putenv(threads_env);
+        }
+        else if (strcmp(arg, "--threadsmin") == 0)
+        {
+            SDL_snprintf(threadsmin_env, sizeof (threadsmin_env),
+                         "SDL_BLIT_THREADS_MIN=%s", argv[++i]);
+            SDL_putenv(threadsmin_env);
+        }
+        else if (strcmp(arg, "--fill") == 0)
+            testFill = 1;
         /* !!! FIXME: set colorkey. */
         else if (0)  /* !!! FIXME: we handle some commandlines elsewhere now */
         {
@@ -371,7 +392,9 @@ static void test_blit_speed(void)
     int isScreen = (SDL_GetVideoSurface() == dest);
     SDL_Event event;
 
-    printf("Testing blit speed for %d seconds...\n", testSeconds);
+    printf("Testing %s speed for %d seconds, SDL_BLIT_THREADS=%s...\n",
+           testFill ? "fill" : "blit", testSeconds,
+           SDL_getenv("SDL_BLIT_THREADS") ? SDL_getenv("SDL_BLIT_THREADS") : "1");
 
     now = SDL_GetTicks();
     end = now + testms;
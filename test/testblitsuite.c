@@ -0,0 +1,739 @@
+/*
+ * Blitter benchmark and conformance suite.
+ *
+ * Blits between all the pixel formats below in every blit mode (copy,
+ * colorkey, surface, per-pixel and premultiplied alpha, RLE) plus
+ * SDL_SoftStretch() and SDL_StretchBlit(), which goes through every entry
+ * of the blitter tables for this build.  Each path is timed in MPixel/s and its output
+ * is checked two ways:
+ *
+ *  - "ref": against the plain C model of the blit in this file.  Copies
+ *    and colorkey blits must match it exactly.  Alpha blending in SDL is
+ *    approximate (shifts instead of divides, 5 bit alpha for 16bpp), so
+ *    there the result may be off by a couple of destination steps.  The
+ *    alpha channel of the destination is not checked.
+ *  - "C": bit for bit against a second run with the SIMD blitters turned
+ *    off through SDL_NEON_BLIT_FEATURES / SDL_ALTIVEC_BLIT_FEATURES.
+ *
+ * It uses the dummy video driver unless SDL_VIDEODRIVER is set, so it
+ * runs anywhere.  The exit status is 1 if anything didn't match.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+struct format {
+	const char *name;
+	int bpp;
+	Uint32 R, G, B, A;
+};
+
+static const struct format formats[] = {
+	{ "P8",       8,  0,          0,          0,          0 },
+	{ "RGB555",   16, 0x00007C00, 0x000003E0, 0x0000001F, 0 },
+	{ "RGB565",   16, 0x0000F800, 0x000007E0, 0x0000001F, 0 },
+	{ "BGR565",   16, 0x0000001F, 0x000007E0, 0x0000F800, 0 },
+	{ "RGB888",   24, 0x00FF0000, 0x0000FF00, 0x000000FF, 0 },
+	{ "BGR888",   24, 0x000000FF, 0x0000FF00, 0x00FF0000, 0 },
+	{ "XRGB8888", 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0 },
+	{ "XBGR8888", 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0 },
+	{ "ARGB8888", 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0xFF000000 },
+	{ "ABGR8888", 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000 },
+	{ "RGBA8888", 32, 0xFF000000, 0x00FF0000, 0x0000FF00, 0x000000FF },
+	{ "BGRA8888", 32, 0x0000FF00, 0x00FF0000, 0xFF000000, 0x000000FF },
+};
+#define NUM_FORMATS (int)(sizeof(formats) / sizeof(formats[0]))
+
+enum {
+	M_COPY, M_KEY, M_ALPHA128, M_ALPHA, M_ALPHAKEY,
+	M_RLEKEY, M_RLEALPHA, M_PREMUL, M_STRETCH, M_SBLIT, M_SBLIT_BILINEAR
+};
+static const char *mode_names[] = {
+	"copy", "key", "alpha128", "alpha", "alpha+key",
+	"rle key", "rle alpha", "premul alpha", "stretch", "stretchblit", "stretchblit bl"
+};
+#define NUM_MODES (int)(sizeof(mode_names) / sizeof(mode_names[0]))
+
+#define SURFACE_ALPHA	0x60
+#define STRETCH_NUM	7	/* stretches are by 7/4 */
+#define STRETCH_DEN	4
+
+/* odd widths catch edge handling, the last one is timed */
+static const int widths[] = { 1, 3, 7, 8, 9, 15, 16, 17, 31, 33, 0 };
+#define NUM_WIDTHS (int)(sizeof(widths) / sizeof(widths[0]))
+#define SMALL_HEIGHT	5
+
+#ifndef MAX
+#define MAX(a, b)	((a) > (b) ? (a) : (b))
+#endif
+
+static int width = 320, height = 240, loops = 10, min_ms = 25;
+static int quiet = 0, checking = 1;
+static const char *mode_filter = NULL, *format_filter = NULL;
+
+struct result {
+	Uint32 hash[NUM_WIDTHS];
+	int ref_bad;
+	int bad_x, bad_y, bad_w;	/* first bad pixel */
+	Uint32 bad_got, bad_expect;
+	int skipped;
+	double mpix;
+};
+
+/* Which modes make sense for a source format */
+static int mode_ok(int mode, const struct format *s, const struct format *d)
+{
+	switch (mode) {
+	case M_ALPHA128:
+	case M_ALPHAKEY:
+		/* surface alpha is ignored with per-pixel alpha */
+		return s->A == 0;
+	case M_PREMUL:
+		return s->A != 0;
+	case M_STRETCH:
+		/* the plain stretcher keeps the format */
+		return s == d;
+	case M_SBLIT:
+	case M_SBLIT_BILINEAR:
+		return s->bpp >= 16 && d->bpp >= 16;
+	}
+	return 1;
+}
+
+/* RLE with surface alpha needs a colorkey */
+static int has_key(int mode, SDL_PixelFormat *f)
+{
+	return mode == M_KEY || mode == M_ALPHAKEY || mode == M_RLEKEY ||
+	       (mode == M_RLEALPHA && !f->Amask);
+}
+
+static int blends(int mode)
+{
+	return mode == M_ALPHA128 || mode == M_ALPHA ||
+	       mode == M_ALPHAKEY || mode == M_RLEALPHA || mode == M_PREMUL;
+}
+
+static int is_stretch(int mode)
+{
+	return mode >= M_STRETCH;
+}
+
+static Uint32 get_pixel(SDL_Surface *s, int x, int y)
+{
+	Uint8 *p = (Uint8 *)s->pixels + y * s->pitch + x * s->format->BytesPerPixel;
+
+	switch (s->format->BytesPerPixel) {
+	case 1:
+		return *p;
+	case 2:
+		return *(Uint16 *)p;
+	case 3:
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+		return p[0] | (p[1] << 8) | (p[2] << 16);
+#else
+		return (p[0] << 16) | (p[1] << 8) | p[2];
+#endif
+	}
+	return *(Uint32 *)p;
+}
+
+static void put_pixel(SDL_Surface *s, int x, int y, Uint32 v)
+{
+	Uint8 *p = (Uint8 *)s->pixels + y * s->pitch + x * s->format->BytesPerPixel;
+
+	switch (s->format->BytesPerPixel) {
+	case 1:
+		*p = v;
+		break;
+	case 2:
+		*(Uint16 *)p = v;
+		break;
+	case 3:
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+		p[0] = v; p[1] = v >> 8; p[2] = v >> 16;
+#else
+		p[0] = v >> 16; p[1] = v >> 8; p[2] = v;
+#endif
+		break;
+	default:
+		*(Uint32 *)p = v;
+		break;
+	}
+}
+
+/* Channels the way the SDL blitters see them, low bits left zero */
+static void get_rgba(SDL_PixelFormat *f, Uint32 v, int *c)
+{
+	if (f->palette) {
+		c[0] = f->palette->colors[v].r;
+		c[1] = f->palette->colors[v].g;
+		c[2] = f->palette->colors[v].b;
+		c[3] = 255;
+		return;
+	}
+	c[0] = ((v & f->Rmask) >> f->Rshift) << f->Rloss;
+	c[1] = ((v & f->Gmask) >> f->Gshift) << f->Gloss;
+	c[2] = ((v & f->Bmask) >> f->Bshift) << f->Bloss;
+	c[3] = f->Amask ? (int)(((v & f->Amask) >> f->Ashift) << f->Aloss) : 255;
+}
+
+/* Nearest palette entry, same as SDL_FindColor() */
+static Uint32 find_color(SDL_Palette *pal, const int *c)
+{
+	int i, d, best = 0, best_d = 0x7fffffff;
+
+	for (i = 0; i < pal->ncolors; i++) {
+		d = (pal->colors[i].r - c[0]) * (pal->colors[i].r - c[0]) +
+		    (pal->colors[i].g - c[1]) * (pal->colors[i].g - c[1]) +
+		    (pal->colors[i].b - c[2]) * (pal->colors[i].b - c[2]);
+		if (d < best_d) {
+			best = i;
+			best_d = d;
+			if (d == 0)
+				break;
+		}
+	}
+	return best;
+}
+
+/* Destination pixel for 8 bit channels */
+static Uint32 map_rgb(SDL_PixelFormat *f, SDL_PixelFormat *from, const int *c)
+{
+	if (f->palette) {
+		/* palette sources are mapped to the nearest color, the
+		   others through a 3-3-2 dither palette, which is what
+		   the destinations here have */
+		if (from && from->palette)
+			return find_color(f->palette, c);
+		return ((c[0] >> 5) << 5) | ((c[1] >> 5) << 2) | (c[2] >> 6);
+	}
+	return ((c[0] >> f->Rloss) << f->Rshift) |
+	       ((c[1] >> f->Gloss) << f->Gshift) |
+	       ((c[2] >> f->Bloss) << f->Bshift);
+}
+
+/* Colorkey compare, like the blitters it ignores the alpha bits */
+static int is_key(SDL_Surface *s, Uint32 v)
+{
+	Uint32 mask = s->format->palette ? 0xff :
+		s->format->Rmask | s->format->Gmask | s->format->Bmask;
+
+	return (v & mask) == (s->format->colorkey & mask);
+}
+
+static SDL_Palette *dither_palette(void)
+{
+	static SDL_Color colors[256];
+	static SDL_Palette pal;
+	int i;
+
+	/* same as SDL_DitherColors() */
+	for (i = 0; i < 256; i++) {
+		colors[i].r = (i & 0xe0) | ((i & 0xe0) >> 3) | ((i & 0xe0) >> 6);
+		colors[i].g = ((i << 3) & 0xe0) | (((i << 3) & 0xe0) >> 3) |
+		              (((i << 3) & 0xe0) >> 6);
+		colors[i].b = (i & 3) | ((i & 3) << 2);
+		colors[i].b |= colors[i].b << 4;
+		colors[i].unused = 0;
+	}
+	pal.ncolors = 256;
+	pal.colors = colors;
+	return &pal;
+}
+
+static SDL_Surface *make_surface(const struct format *f, int w, int h, int is_src,
+                                 Uint32 flags)
+{
+	SDL_Surface *s;
+	SDL_Color colors[256];
+	int i;
+
+	s = SDL_CreateRGBSurface(SDL_SWSURFACE | flags, w, h, f->bpp,
+	                         f->R, f->G, f->B, f->A);
+	if (s == NULL)
+		return NULL;
+	SDL_SetAlpha(s, 0, 0);
+	if (f->bpp == 8) {
+		if (is_src) {
+			for (i = 0; i < 256; i++) {
+				colors[i].r = rand();
+				colors[i].g = rand();
+				colors[i].b = rand();
+			}
+			SDL_SetColors(s, colors, 0, 256);
+		} else {
+			SDL_SetColors(s, dither_palette()->colors, 0, 256);
+		}
+	}
+	return s;
+}
+
+/* Random pixels, a quarter of them the colorkey, and with per-pixel alpha
+   runs of transparent, opaque and translucent pixels like real sprites,
+   with the colors multiplied by alpha for premultiplied surfaces */
+static void fill_src(SDL_Surface *s, int mode)
+{
+	SDL_PixelFormat *f = s->format;
+	Uint32 key, v;
+	int x, y, run = 0, kind = 0;
+
+	key = f->palette ? 5 : SDL_MapRGB(f, 0x12, 0x34, 0x56);
+	SDL_SetColorKey(s, 0, key);
+	s->format->colorkey = key;
+
+	for (y = 0; y < s->h; y++) {
+		for (x = 0; x < s->w; x++) {
+			if (run-- <= 0) {
+				run = rand() % 12;
+				kind = rand() % 4;
+			}
+			if (has_key(mode, f) && kind == 0) {
+				put_pixel(s, x, y, key);
+				continue;
+			}
+			do {
+				v = rand() ^ ((Uint32)rand() << 15) ^ ((Uint32)rand() << 30);
+				/* bits outside the masks stay zero */
+				if (f->palette)
+					v &= 0xff;
+				else
+					v &= f->Rmask | f->Gmask | f->Bmask | f->Amask;
+			} while (is_key(s, v));
+			if (f->Amask) {
+				v &= ~f->Amask;
+				if (kind == 1)
+					v |= f->Amask;
+				else if (kind == 2)
+					v |= (rand() << f->Ashift) & f->Amask;
+			}
+			if (s->flags & SDL_PREMULALPHA) {
+				Uint8 r, g, b, a;
+
+				SDL_GetRGBA(v, f, &r, &g, &b, &a);
+				v = SDL_MapRGBA(f, r * a / 255, g * a / 255,
+				                b * a / 255, a);
+			}
+			put_pixel(s, x, y, v);
+		}
+	}
+}
+
+static void fill_dst(SDL_Surface *s)
+{
+	SDL_PixelFormat *f = s->format;
+	Uint32 mask = f->palette ? 0xff : f->Rmask | f->Gmask | f->Bmask | f->Amask;
+	int x, y;
+
+	for (y = 0; y < s->h; y++)
+		for (x = 0; x < s->w; x++)
+			put_pixel(s, x, y, (rand() ^ ((Uint32)rand() << 15) ^
+			                   ((Uint32)rand() << 30)) & mask);
+}
+
+static void set_mode(SDL_Surface *s, int mode)
+{
+	Uint32 rle = 0;
+
+	if (mode == M_RLEKEY || mode == M_RLEALPHA)
+		rle = SDL_RLEACCEL;
+	if (has_key(mode, s->format))
+		SDL_SetColorKey(s, SDL_SRCCOLORKEY | rle, s->format->colorkey);
+	if (mode == M_ALPHA128)
+		SDL_SetAlpha(s, SDL_SRCALPHA, 128);
+	else if (mode == M_ALPHA || mode == M_ALPHAKEY || mode == M_RLEALPHA ||
+	         mode == M_PREMUL)
+		SDL_SetAlpha(s, SDL_SRCALPHA | rle,
+		             s->format->Amask ? 255 : SURFACE_ALPHA);
+}
+
+/* Source positions for each destination position with SDL_SoftStretch() */
+static int *stretch_pos(int src_len, int dst_len)
+{
+	int *idx = malloc(dst_len * sizeof(*idx));
+	int i, pos = 0x10000, inc = (src_len << 16) / dst_len, cur = -1;
+
+	for (i = 0; idx && i < dst_len; i++) {
+		while (pos >= 0x10000) {
+			cur++;
+			pos -= 0x10000;
+		}
+		idx[i] = cur;
+		pos += inc;
+	}
+	return idx;
+}
+
+static void bad_pixel(struct result *r, int x, int y, int w,
+                      Uint32 got, Uint32 expect)
+{
+	if (r->ref_bad++ == 0) {
+		r->bad_x = x;
+		r->bad_y = y;
+		r->bad_w = w;
+		r->bad_got = got;
+		r->bad_expect = expect;
+	}
+}
+
+/* Checks a blit of src at (sx,sy) to dst at (dx,dy), 'before' is a copy
+   of the destination before the blit */
+static void check(SDL_Surface *src, SDL_Surface *before, SDL_Surface *dst,
+                  int mode, int sx, int sy, int dx, int dy, int w, int h,
+                  struct result *r)
+{
+	SDL_PixelFormat *sf = src->format, *df = dst->format;
+	int x, y, i, tol[3], dmask[3];
+	int *xs = NULL, *ys = NULL;
+	int sc[4], dc[4], ec[4], rc[4];
+	Uint32 sv, expect, old, got;
+	int alpha;
+
+	/* how far the blends are allowed to be off in 8 bit units */
+	tol[0] = df->palette ? 72 : 2 * (1 << df->Rloss) + 8;
+	tol[1] = df->palette ? 72 : 2 * (1 << df->Gloss) + 8;
+	tol[2] = df->palette ? 72 : 2 * (1 << df->Bloss) + 8;
+
+	if (mode == M_STRETCH) {
+		xs = stretch_pos(src->w - sx, w);
+		ys = stretch_pos(src->h - sy, h);
+		if (xs == NULL || ys == NULL) {
+			bad_pixel(r, 0, 0, w, 0, 0);
+			return;
+		}
+	}
+	/* bits both formats have */
+	dmask[0] = 0xff << MAX(sf->Rloss, df->Rloss);
+	dmask[1] = 0xff << MAX(sf->Gloss, df->Gloss);
+	dmask[2] = 0xff << MAX(sf->Bloss, df->Bloss);
+
+	for (y = 0; y < h; y++) {
+		for (x = 0; x < w; x++) {
+			if (mode == M_STRETCH) {
+				sv = get_pixel(src, sx + xs[x], sy + ys[y]);
+			} else {
+				sv = get_pixel(src, sx + x, sy + y);
+			}
+			got = get_pixel(dst, dx + x, dy + y);
+			old = get_pixel(before, dx + x, dy + y);
+
+			if (has_key(mode, sf) && is_key(src, sv)) {
+				if (got != old)
+					bad_pixel(r, x, y, w, got, old);
+				continue;
+			}
+			if (mode == M_STRETCH) {
+				if (got != sv)
+					bad_pixel(r, x, y, w, got, sv);
+				continue;
+			}
+
+			get_rgba(sf, sv, sc);
+			if (!blends(mode)) {
+				expect = map_rgb(df, sf, sc);
+				if (df->palette) {
+					if (got != expect)
+						bad_pixel(r, x, y, w, got, expect);
+					continue;
+				}
+				/* the source bits have to be there, conversions
+				   to more bits may fill the low ones any way */
+				get_rgba(df, got, rc);
+				for (i = 0; i < 3; i++) {
+					if ((rc[i] ^ sc[i]) & dmask[i])
+						break;
+				}
+				if (i < 3)
+					bad_pixel(r, x, y, w, got, expect);
+				continue;
+			}
+
+			if (mode == M_ALPHA128)
+				alpha = 128;
+			else if (sf->Amask)
+				alpha = sc[3];
+			else
+				alpha = SURFACE_ALPHA;
+			get_rgba(df, old, dc);
+			for (i = 0; i < 3; i++) {
+				if (mode == M_PREMUL)
+					ec[i] = sc[i] + (dc[i] * (255 - alpha) + 127) / 255;
+				else
+					ec[i] = dc[i] + ((sc[i] - dc[i]) * alpha + 127) / 255;
+			}
+			get_rgba(df, got, rc);
+			for (i = 0; i < 3; i++) {
+				if (abs(rc[i] - ec[i]) > tol[i])
+					break;
+			}
+			if (i < 3)
+				bad_pixel(r, x, y, w, got,
+				          map_rgb(df, NULL, ec));
+		}
+	}
+	free(xs);
+	free(ys);
+}
+
+static Uint32 hash_rect(SDL_Surface *s, int x, int y, int w, int h)
+{
+	Uint32 hash = 2166136261u;
+	int i, j, bpp = s->format->BytesPerPixel;
+	Uint8 *p;
+
+	for (j = 0; j < h; j++) {
+		p = (Uint8 *)s->pixels + (y + j) * s->pitch + x * bpp;
+		for (i = 0; i < w * bpp; i++)
+			hash = (hash ^ p[i]) * 16777619u;
+	}
+	return hash;
+}
+
+static int do_blit(SDL_Surface *src, SDL_Rect *sr, SDL_Surface *dst,
+                   SDL_Rect *dr, int mode)
+{
+	SDL_Rect d = *dr;
+
+	switch (mode) {
+	case M_STRETCH:
+		return SDL_SoftStretch(src, sr, dst, &d);
+	case M_SBLIT:
+		return SDL_StretchBlit(src, sr, dst, &d, SDL_STRETCH_NEAREST);
+	case M_SBLIT_BILINEAR:
+		return SDL_StretchBlit(src, sr, dst, &d, SDL_STRETCH_BILINEAR);
+	}
+	return SDL_BlitSurface(src, sr, dst, &d);
+}
+
+static int run_case(int mode, const struct format *sfmt,
+                    const struct format *dfmt, struct result *r)
+{
+	SDL_Surface *src, *dst, *before;
+	SDL_Rect sr, dr;
+	Uint32 start, ms;
+	int i, w, h, dw, dh, n;
+
+	memset(r, 0, sizeof(*r));
+	for (i = 0; i < NUM_WIDTHS; i++) {
+		w = widths[i] ? widths[i] : width;
+		h = widths[i] ? SMALL_HEIGHT : height;
+		dw = is_stretch(mode) ? w * STRETCH_NUM / STRETCH_DEN : w;
+		dh = is_stretch(mode) ? h * STRETCH_NUM / STRETCH_DEN : h;
+
+		/* blit from and to odd positions too, for alignment */
+		sr.x = i & 3;
+		sr.y = 1;
+		sr.w = w;
+		sr.h = h;
+		dr.x = (i * 3) & 3;
+		dr.y = 2;
+		dr.w = dw;
+		dr.h = dh;
+
+		srand(i * 131 + (int)(sfmt - formats) * 17 + mode);
+		src = make_surface(sfmt, w + 4, h + 2, 1,
+		                   mode == M_PREMUL ? SDL_PREMULALPHA : 0);
+		dst = make_surface(dfmt, dw + 4, dh + 4, 0, 0);
+		before = make_surface(dfmt, dw + 4, dh + 4, 0, 0);
+		if (src == NULL || dst == NULL || before == NULL) {
+			fprintf(stderr, "Couldn't create surfaces: %s\n", SDL_GetError());
+			return -1;
+		}
+		if (mode == M_STRETCH && src->format->palette) {
+			/* other palettes are converted, not copied */
+			SDL_SetColors(dst, src->format->palette->colors, 0, 256);
+			SDL_SetColors(before, src->format->palette->colors, 0, 256);
+		}
+		fill_src(src, mode);
+		fill_dst(dst);
+		memcpy(before->pixels, dst->pixels, dst->pitch * dst->h);
+		set_mode(src, mode);
+		if (mode == M_STRETCH) {
+			/* SDL_SoftStretch() takes the source to the edge */
+			sr.w = src->w - sr.x;
+			sr.h = src->h - sr.y;
+		}
+
+		if (do_blit(src, &sr, dst, &dr, mode) < 0) {
+			/* not every combination is supported (like alpha
+			   blits to 8bpp), that's no error */
+			r->skipped = 1;
+			SDL_FreeSurface(src);
+			SDL_FreeSurface(dst);
+			SDL_FreeSurface(before);
+			return 0;
+		}
+		r->hash[i] = hash_rect(dst, 0, 0, dst->w, dst->h);
+		if (checking && mode < M_SBLIT) {
+			/* RLE surfaces don't have their pixels otherwise */
+			SDL_LockSurfaceReadOnly(src);
+			check(src, before, dst, mode,
+			      sr.x, sr.y, dr.x, dr.y, dw, dh, r);
+			SDL_UnlockSurface(src);
+		}
+
+		if (widths[i] == 0) {
+			/* RLE surfaces are encoded on the first blit above */
+			start = SDL_GetTicks();
+			n = 0;
+			do {
+				do_blit(src, &sr, dst, &dr, mode);
+				ms = SDL_GetTicks() - start;
+			} while (++n < loops || ms < (Uint32)min_ms);
+			r->mpix = (double)dw * dh * n / (ms * 1000.0);
+		}
+
+		SDL_FreeSurface(src);
+		SDL_FreeSurface(dst);
+		SDL_FreeSurface(before);
+	}
+	return 0;
+}
+
+static int selected(int mode, const struct format *s, const struct format *d)
+{
+	if (!mode_ok(mode, s, d))
+		return 0;
+	if (mode_filter && strcmp(mode_filter, mode_names[mode]) != 0)
+		return 0;
+	if (format_filter && strcmp(format_filter, s->name) != 0 &&
+	    strcmp(format_filter, d->name) != 0)
+		return 0;
+	return 1;
+}
+
+static int start_video(void)
+{
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return -1;
+	}
+	if (SDL_SetVideoMode(320, 240, 0, SDL_SWSURFACE) == NULL) {
+		fprintf(stderr, "Couldn't set video mode: %s\n", SDL_GetError());
+		SDL_Quit();
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct result *results[2];
+	int i, m, s, d, pass, ncases, bad = 0;
+	char name[64];
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+			width = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc)
+			height = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			loops = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			min_ms = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+			mode_filter = argv[++i];
+		else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			format_filter = argv[++i];
+		else if (strcmp(argv[i], "-q") == 0)
+			quiet = 1;
+		else {
+			fprintf(stderr, "usage: %s [-w width] [-h height] [-n min loops] "
+			        "[-t min ms] [-m mode] [-f format] [-q]\n", argv[0]);
+			fprintf(stderr, "modes:");
+			for (m = 0; m < NUM_MODES; m++)
+				fprintf(stderr, " \"%s\"", mode_names[m]);
+			fprintf(stderr, "\nformats:");
+			for (s = 0; s < NUM_FORMATS; s++)
+				fprintf(stderr, " %s", formats[s].name);
+			fprintf(stderr, "\n");
+			return 1;
+		}
+	}
+
+	/* no window needed, but blits should see a real video setup */
+	if (SDL_getenv("SDL_VIDEODRIVER") == NULL)
+		SDL_putenv("SDL_VIDEODRIVER=dummy");
+	if (start_video() < 0)
+		return 1;
+
+	ncases = NUM_MODES * NUM_FORMATS * NUM_FORMATS;
+	results[0] = calloc(ncases, sizeof(struct result));
+	results[1] = calloc(ncases, sizeof(struct result));
+	if (results[0] == NULL || results[1] == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			/* the overrides are read once until SDL_Quit() */
+			checking = 0;
+			SDL_Quit();
+			SDL_putenv("SDL_NEON_BLIT_FEATURES=0");
+			SDL_putenv("SDL_ALTIVEC_BLIT_FEATURES=0");
+			if (start_video() < 0)
+				return 1;
+		}
+		for (m = 0; m < NUM_MODES; m++)
+			for (s = 0; s < NUM_FORMATS; s++)
+				for (d = 0; d < NUM_FORMATS; d++) {
+					if (!selected(m, &formats[s], &formats[d]))
+						continue;
+					i = (m * NUM_FORMATS + s) * NUM_FORMATS + d;
+					if (run_case(m, &formats[s], &formats[d],
+					             &results[pass][i]) < 0)
+						return 1;
+				}
+	}
+
+	printf("%dx%d, at least %d blits and %d ms each, MPixel/s\n",
+	       width, height, loops, min_ms);
+	printf("%-36s %9s %9s %8s  %s\n", "", "optimized", "C", "speedup", "ref / C");
+	for (m = 0; m < NUM_MODES; m++)
+		for (s = 0; s < NUM_FORMATS; s++)
+			for (d = 0; d < NUM_FORMATS; d++) {
+				struct result *r0, *r1;
+				int diff = 0, case_bad;
+
+				if (!selected(m, &formats[s], &formats[d]))
+					continue;
+				i = (m * NUM_FORMATS + s) * NUM_FORMATS + d;
+				r0 = &results[0][i];
+				r1 = &results[1][i];
+				if (r0->skipped)
+					continue;
+				for (i = 0; i < NUM_WIDTHS; i++)
+					if (r0->hash[i] != r1->hash[i])
+						diff = 1;
+				case_bad = r0->ref_bad || diff;
+				bad += case_bad;
+				if (quiet && !case_bad)
+					continue;
+
+				sprintf(name, "%s %s->%s", mode_names[m],
+				        formats[s].name, formats[d].name);
+				printf("%-36s %9.1f %9.1f %7.2fx  ", name, r0->mpix,
+				       r1->mpix, r1->mpix ? r0->mpix / r1->mpix : 0.0);
+				if (m >= M_SBLIT)
+					printf("-");
+				else if (r0->ref_bad)
+					printf("%d BAD", r0->ref_bad);
+				else
+					printf("ok");
+				printf(" / %s\n", diff ? "MISMATCH" : "ok");
+				if (r0->ref_bad)
+					printf("  first at %d,%d of width %d: %08x, "
+					       "expected about %08x\n", r0->bad_x,
+					       r0->bad_y, r0->bad_w, r0->bad_got,
+					       r0->bad_expect);
+			}
+	printf("%d failed\n", bad);
+
+	free(results[0]);
+	free(results[1]);
+	SDL_Quit();
+	return bad ? 1 : 0;
+}
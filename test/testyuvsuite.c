@@ -0,0 +1,551 @@
+/*
+ * Software YUV overlay benchmark and conformance suite.
+ *
+ * Displays every overlay format on every RGB display format at 1x, 2x,
+ * scaled up and down and clipped by the screen edge, which goes through
+ * the C and SIMD converters and the scaling path of SDL_yuv_sw.c.  The
+ * big sizes are timed in MPixel/s (destination pixels) and each result
+ * is checked two ways:
+ *
+ *  - "ref": exactly against the fixed point model of the conversion and
+ *    the SDL_SoftStretch() nearest neighbour steps in this file, and
+ *    nothing outside the destination rectangle may change.
+ *  - "C": bit for bit against a second run with the SIMD converters
+ *    turned off through SDL_NEON_BLIT_FEATURES.
+ *
+ * Set SDL_BLIT_THREADS (and SDL_BLIT_THREADS_MIN=0 for the small sizes)
+ * to check and time the displays split between threads, and
+ * SDL_VIDEO_YUV_ASYNC=1 for the asynchronous ones.
+ *
+ * It uses the dummy video driver unless SDL_VIDEODRIVER is set, so it
+ * runs anywhere.  The exit status is 1 if anything didn't match.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SDL.h"
+
+struct format {
+	const char *name;
+	int bpp;
+	Uint32 R, G, B;
+};
+
+static const struct format formats[] = {
+	{ "RGB555",   16, 0x00007C00, 0x000003E0, 0x0000001F },
+	{ "RGB565",   16, 0x0000F800, 0x000007E0, 0x0000001F },
+	{ "BGR565",   16, 0x0000001F, 0x000007E0, 0x0000F800 },
+	{ "RGB888",   24, 0x00FF0000, 0x0000FF00, 0x000000FF },
+	{ "XRGB8888", 32, 0x00FF0000, 0x0000FF00, 0x000000FF },
+	{ "XBGR8888", 32, 0x000000FF, 0x0000FF00, 0x00FF0000 },
+};
+#define NUM_FORMATS (int)(sizeof(formats) / sizeof(formats[0]))
+
+static const struct {
+	const char *name;
+	Uint32 format;
+} yuv_formats[] = {
+	{ "YV12", SDL_YV12_OVERLAY },
+	{ "IYUV", SDL_IYUV_OVERLAY },
+	{ "YUY2", SDL_YUY2_OVERLAY },
+	{ "UYVY", SDL_UYVY_OVERLAY },
+	{ "YVYU", SDL_YVYU_OVERLAY },
+	{ "NV12", SDL_NV12_OVERLAY },
+	{ "NV21", SDL_NV21_OVERLAY },
+	{ "P010", SDL_P010_OVERLAY },
+};
+#define NUM_YUV (int)(sizeof(yuv_formats) / sizeof(yuv_formats[0]))
+
+enum { S_1X, S_2X, S_UP, S_DOWN, S_CLIP };
+static const char *scale_names[] = { "1x", "2x", "up", "down", "clipped" };
+#define NUM_SCALES (int)(sizeof(scale_names) / sizeof(scale_names[0]))
+
+/* overlay sizes, widths around the SIMD group size of 16 pixels; they are
+   even as the layouts keep whole pixel pairs, odd heights leave the last
+   line without a pair.  0 is timed */
+static const struct { int w, h; } sizes[] = {
+	{ 2, 2 }, { 6, 4 }, { 14, 6 }, { 16, 4 }, { 18, 6 },
+	{ 34, 4 }, { 62, 8 }, { 6, 3 }, { 18, 5 }, { 62, 7 }, { 0, 0 }
+};
+#define NUM_SIZES (int)(sizeof(sizes) / sizeof(sizes[0]))
+
+#define SCREEN_W	1280
+#define SCREEN_H	720
+
+static int width = 1280, height = 720, loops = 10, min_ms = 25;
+static int quiet = 0, checking = 1;
+static const char *scale_filter = NULL, *format_filter = NULL;
+static SDL_Surface *screen;
+
+struct result {
+	Uint32 hash[NUM_SIZES];
+	int ref_bad;
+	int bad_x, bad_y, bad_w;	/* first bad pixel */
+	Uint32 bad_got, bad_expect;
+	double mpix;
+};
+
+static void dst_rect(int scale, int w, int h, SDL_Rect *r)
+{
+	switch (scale) {
+	case S_1X:
+		r->x = 3; r->y = 2; r->w = w; r->h = h;
+		break;
+	case S_2X:
+		r->x = 1; r->y = 1; r->w = w * 2; r->h = h * 2;
+		break;
+	case S_UP:
+		r->x = 2; r->y = 3; r->w = w * 5 / 3 + 1; r->h = h * 3 / 2 + 1;
+		break;
+	case S_DOWN:
+		r->x = 1; r->y = 0; r->w = w * 5 / 8 + 1; r->h = h * 2 / 3 + 1;
+		break;
+	case S_CLIP:
+		r->x = -w / 3 - 1; r->y = -h / 4 - 1;
+		r->w = w * 3 / 2; r->h = h * 3 / 2;
+		break;
+	}
+}
+
+/* Overlay size for about width x height on the screen */
+static void timed_size(int scale, int *w, int *h)
+{
+	switch (scale) {
+	case S_2X:
+		*w = width / 2;
+		*h = height / 2;
+		break;
+	case S_UP:
+		*w = width * 3 / 5;
+		*h = height * 2 / 3;
+		break;
+	default:
+		*w = width;
+		*h = height;
+		break;
+	}
+	*w = (*w + 1) & ~1;
+	*h = (*h + 1) & ~1;
+}
+
+/* Same as SDL_DisplayYUVOverlay() clipping to the screen */
+static int clip(SDL_Overlay *o, SDL_Rect *d, SDL_Rect *src, SDL_Rect *dst)
+{
+	int sx = 0, sy = 0, sw = o->w, sh = o->h;
+	int dx = d->x, dy = d->y, dw = d->w, dh = d->h;
+
+	if (dx < 0) {
+		sw += (dx * o->w) / d->w;
+		dw += dx;
+		sx -= (dx * o->w) / d->w;
+		dx = 0;
+	}
+	if (dx + dw > screen->w) {
+		int extra = dx + dw - screen->w;
+		sw -= (extra * o->w) / d->w;
+		dw -= extra;
+	}
+	if (dy < 0) {
+		sh += (dy * o->h) / d->h;
+		dh += dy;
+		sy -= (dy * o->h) / d->h;
+		dy = 0;
+	}
+	if (dy + dh > screen->h) {
+		int extra = dy + dh - screen->h;
+		sh -= (extra * o->h) / d->h;
+		dh -= extra;
+	}
+	if (sw <= 0 || sh <= 0 || dw <= 0 || dh <= 0)
+		return 0;
+	src->x = sx; src->y = sy; src->w = sw; src->h = sh;
+	dst->x = dx; dst->y = dy; dst->w = dw; dst->h = dh;
+	return 1;
+}
+
+/* Source positions for each destination position with SDL_SoftStretch() */
+static int *stretch_pos(int src_len, int dst_len)
+{
+	int *idx = malloc(dst_len * sizeof(*idx));
+	int i, pos = 0x10000, inc = (src_len << 16) / dst_len, cur = -1;
+
+	for (i = 0; idx && i < dst_len; i++) {
+		while (pos >= 0x10000) {
+			cur++;
+			pos -= 0x10000;
+		}
+		idx[i] = cur;
+		pos += inc;
+	}
+	return idx;
+}
+
+static void get_yuv(SDL_Overlay *o, int x, int y, int *Y, int *U, int *V)
+{
+	Uint8 *p;
+
+	switch (o->format) {
+	case SDL_YV12_OVERLAY:
+	case SDL_IYUV_OVERLAY:
+		*Y = o->pixels[0][y * o->pitches[0] + x];
+		*U = o->pixels[1][(y / 2) * o->pitches[1] + x / 2];
+		*V = o->pixels[2][(y / 2) * o->pitches[2] + x / 2];
+		if (o->format == SDL_YV12_OVERLAY) {
+			int t = *U; *U = *V; *V = t;
+		}
+		return;
+	case SDL_NV12_OVERLAY:
+	case SDL_NV21_OVERLAY:
+		*Y = o->pixels[0][y * o->pitches[0] + x];
+		p = o->pixels[1] + (y / 2) * o->pitches[1] + (x & ~1);
+		*U = p[0]; *V = p[1];
+		if (o->format == SDL_NV21_OVERLAY) {
+			int t = *U; *U = *V; *V = t;
+		}
+		return;
+	case SDL_P010_OVERLAY:
+		/* little endian samples, only their top 8 bits are shown */
+		*Y = o->pixels[0][y * o->pitches[0] + x * 2 + 1];
+		p = o->pixels[1] + (y / 2) * o->pitches[1] + (x & ~1) * 2;
+		*U = p[1]; *V = p[3];
+		return;
+	}
+	p = o->pixels[0] + y * o->pitches[0] + (x & ~1) * 2;
+	switch (o->format) {
+	case SDL_YUY2_OVERLAY:
+		*Y = p[(x & 1) * 2]; *U = p[1]; *V = p[3];
+		break;
+	case SDL_UYVY_OVERLAY:
+		*Y = p[(x & 1) * 2 + 1]; *U = p[0]; *V = p[2];
+		break;
+	default:
+		*Y = p[(x & 1) * 2]; *U = p[3]; *V = p[1];
+		break;
+	}
+}
+
+static int clamp(int c)
+{
+	return c < 0 ? 0 : c > 255 ? 255 : c;
+}
+
+/* The fixed point math of SDL_yuv_sw.c */
+static Uint32 yuv_to_pixel(SDL_PixelFormat *f, int y, int u, int v)
+{
+	int r, g, b;
+
+	u -= 128;
+	v -= 128;
+	r = clamp(y + ((v * 22960) >> 14));
+	g = clamp(y + ((v * -11692) >> 14) + ((u * -5643) >> 14));
+	b = clamp(y + ((u * 29056) >> 14));
+	return ((r >> f->Rloss) << f->Rshift) |
+	       ((g >> f->Gloss) << f->Gshift) |
+	       ((b >> f->Bloss) << f->Bshift);
+}
+
+static Uint32 get_pixel(SDL_Surface *s, int x, int y)
+{
+	Uint8 *p = (Uint8 *)s->pixels + y * s->pitch + x * s->format->BytesPerPixel;
+
+	switch (s->format->BytesPerPixel) {
+	case 2:
+		return *(Uint16 *)p;
+	case 3:
+#if SDL_BYTEORDER == SDL_LIL_ENDIAN
+		return p[0] | (p[1] << 8) | (p[2] << 16);
+#else
+		return (p[0] << 16) | (p[1] << 8) | p[2];
+#endif
+	}
+	return *(Uint32 *)p;
+}
+
+static void bad_pixel(struct result *r, int x, int y, int w,
+                      Uint32 got, Uint32 expect)
+{
+	if (r->ref_bad++ == 0) {
+		r->bad_x = x;
+		r->bad_y = y;
+		r->bad_w = w;
+		r->bad_got = got;
+		r->bad_expect = expect;
+	}
+}
+
+static void check(SDL_Overlay *o, SDL_Surface *before, SDL_Surface *disp,
+                  SDL_Rect *src, SDL_Rect *dst, struct result *r)
+{
+	int *xs = stretch_pos(src->w, dst->w);
+	int *ys = stretch_pos(src->h, dst->h);
+	int x, y, Y, U, V;
+	Uint32 got, expect;
+
+	if (xs == NULL || ys == NULL) {
+		bad_pixel(r, 0, 0, o->w, 0, 0);
+		return;
+	}
+	for (y = 0; y < disp->h; y++) {
+		for (x = 0; x < disp->w; x++) {
+			got = get_pixel(disp, x, y);
+			if (x < dst->x || x >= dst->x + dst->w ||
+			    y < dst->y || y >= dst->y + dst->h) {
+				expect = get_pixel(before, x, y);
+			} else {
+				get_yuv(o, src->x + xs[x - dst->x],
+				        src->y + ys[y - dst->y], &Y, &U, &V);
+				expect = yuv_to_pixel(disp->format, Y, U, V);
+			}
+			if (got != expect)
+				bad_pixel(r, x, y, o->w, got, expect);
+		}
+	}
+	free(xs);
+	free(ys);
+}
+
+static Uint32 hash_surface(SDL_Surface *s)
+{
+	Uint32 hash = 2166136261u;
+	int i, j, len = s->w * s->format->BytesPerPixel;
+	Uint8 *p;
+
+	for (j = 0; j < s->h; j++) {
+		p = (Uint8 *)s->pixels + j * s->pitch;
+		for (i = 0; i < len; i++)
+			hash = (hash ^ p[i]) * 16777619u;
+	}
+	return hash;
+}
+
+static void fill_overlay(SDL_Overlay *o)
+{
+	int i, x, y, w;
+
+	SDL_LockYUVOverlay(o);
+	for (i = 0; i < o->planes; i++) {
+		w = o->pitches[i];
+		for (y = 0; y < (i ? (o->h + 1) / 2 : o->h); y++)
+			for (x = 0; x < w; x++)
+				o->pixels[i][y * w + x] = rand() >> 3;
+	}
+	SDL_UnlockYUVOverlay(o);
+}
+
+static int run_case(int scale, int yuv, const struct format *fmt,
+                    struct result *r)
+{
+	SDL_Surface *disp, *before;
+	SDL_Overlay *o;
+	SDL_Rect d, src, dst;
+	Uint32 start, ms;
+	int i, w, h, n;
+
+	memset(r, 0, sizeof(*r));
+	for (i = 0; i < NUM_SIZES; i++) {
+		w = sizes[i].w;
+		h = sizes[i].h;
+		if (w == 0) {
+			/* the timed ones have the full size on the screen */
+			timed_size(scale, &w, &h);
+		}
+		dst_rect(scale, w, h, &d);
+		if (sizes[i].w == 0 && scale != S_CLIP)
+			d.x = d.y = 0;
+
+		srand(i * 131 + yuv * 17 + scale);
+		disp = SDL_CreateRGBSurface(SDL_SWSURFACE,
+		                            sizes[i].w ? w * 2 + 8 : SCREEN_W,
+		                            sizes[i].w ? h * 2 + 8 : SCREEN_H,
+		                            fmt->bpp, fmt->R, fmt->G, fmt->B, 0);
+		before = SDL_CreateRGBSurface(SDL_SWSURFACE, disp->w, disp->h,
+		                              fmt->bpp, fmt->R, fmt->G, fmt->B, 0);
+		o = SDL_CreateYUVOverlay(w, h, yuv_formats[yuv].format, disp);
+		if (disp == NULL || before == NULL || o == NULL) {
+			fprintf(stderr, "Couldn't create overlay: %s\n", SDL_GetError());
+			return -1;
+		}
+		for (n = 0; n < disp->pitch * disp->h; n++)
+			((Uint8 *)disp->pixels)[n] = rand();
+		memcpy(before->pixels, disp->pixels, disp->pitch * disp->h);
+		fill_overlay(o);
+
+		if (SDL_DisplayYUVOverlay(o, &d) < 0) {
+			fprintf(stderr, "Display failed: %s\n", SDL_GetError());
+			return -1;
+		}
+		/* waits for asynchronous displays */
+		SDL_LockYUVOverlay(o);
+		SDL_UnlockYUVOverlay(o);
+		r->hash[i] = hash_surface(disp);
+		if (checking && clip(o, &d, &src, &dst))
+			check(o, before, disp, &src, &dst, r);
+
+		if (sizes[i].w == 0) {
+			start = SDL_GetTicks();
+			n = 0;
+			do {
+				SDL_DisplayYUVOverlay(o, &d);
+				ms = SDL_GetTicks() - start;
+			} while (++n < loops || ms < (Uint32)min_ms);
+			SDL_LockYUVOverlay(o);
+			SDL_UnlockYUVOverlay(o);
+			ms = SDL_GetTicks() - start;
+			clip(o, &d, &src, &dst);
+			r->mpix = (double)dst.w * dst.h * n / (ms * 1000.0);
+		}
+
+		SDL_FreeYUVOverlay(o);
+		SDL_FreeSurface(disp);
+		SDL_FreeSurface(before);
+	}
+	return 0;
+}
+
+static int selected(int scale, int yuv, const struct format *f)
+{
+	if (scale_filter && strcmp(scale_filter, scale_names[scale]) != 0)
+		return 0;
+	if (format_filter && strcmp(format_filter, f->name) != 0 &&
+	    strcmp(format_filter, yuv_formats[yuv].name) != 0)
+		return 0;
+	return 1;
+}
+
+static int start_video(void)
+{
+	if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+		fprintf(stderr, "Couldn't initialize SDL: %s\n", SDL_GetError());
+		return -1;
+	}
+	screen = SDL_SetVideoMode(SCREEN_W, SCREEN_H, 0, SDL_SWSURFACE);
+	if (screen == NULL) {
+		fprintf(stderr, "Couldn't set video mode: %s\n", SDL_GetError());
+		SDL_Quit();
+		return -1;
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct result *results[2];
+	int i, s, y, f, pass, ncases, bad = 0;
+	char name[64];
+
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "-w") == 0 && i + 1 < argc)
+			width = atoi(argv[++i]) & ~1;
+		else if (strcmp(argv[i], "-h") == 0 && i + 1 < argc)
+			height = atoi(argv[++i]) & ~1;
+		else if (strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+			loops = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc)
+			min_ms = atoi(argv[++i]);
+		else if (strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+			scale_filter = argv[++i];
+		else if (strcmp(argv[i], "-f") == 0 && i + 1 < argc)
+			format_filter = argv[++i];
+		else if (strcmp(argv[i], "-q") == 0)
+			quiet = 1;
+		else {
+			fprintf(stderr, "usage: %s [-w width] [-h height] [-n min loops] "
+			        "[-t min ms] [-s scale] [-f format] [-q]\n", argv[0]);
+			fprintf(stderr, "scales:");
+			for (s = 0; s < NUM_SCALES; s++)
+				fprintf(stderr, " %s", scale_names[s]);
+			fprintf(stderr, "\nformats:");
+			for (y = 0; y < NUM_YUV; y++)
+				fprintf(stderr, " %s", yuv_formats[y].name);
+			for (f = 0; f < NUM_FORMATS; f++)
+				fprintf(stderr, " %s", formats[f].name);
+			fprintf(stderr, "\n");
+			return 1;
+		}
+	}
+	if (width < 2 || height < 2 || width > SCREEN_W || height > SCREEN_H) {
+		fprintf(stderr, "The size must be 2x2 to %dx%d\n", SCREEN_W, SCREEN_H);
+		return 1;
+	}
+
+	/* no window needed, but overlays are clipped to the screen */
+	if (SDL_getenv("SDL_VIDEODRIVER") == NULL)
+		SDL_putenv("SDL_VIDEODRIVER=dummy");
+	if (start_video() < 0)
+		return 1;
+
+	ncases = NUM_SCALES * NUM_YUV * NUM_FORMATS;
+	results[0] = calloc(ncases, sizeof(struct result));
+	results[1] = calloc(ncases, sizeof(struct result));
+	if (results[0] == NULL || results[1] == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	for (pass = 0; pass < 2; pass++) {
+		if (pass == 1) {
+			/* the override is read once until SDL_Quit() */
+			checking = 0;
+			SDL_Quit();
+			SDL_putenv("SDL_NEON_BLIT_FEATURES=0");
+			if (start_video() < 0)
+				return 1;
+		}
+		for (s = 0; s < NUM_SCALES; s++)
+			for (y = 0; y < NUM_YUV; y++)
+				for (f = 0; f < NUM_FORMATS; f++) {
+					if (!selected(s, y, &formats[f]))
+						continue;
+					i = (s * NUM_YUV + y) * NUM_FORMATS + f;
+					if (run_case(s, y, &formats[f],
+					             &results[pass][i]) < 0)
+						return 1;
+				}
+	}
+
+	printf("%dx%d, at least %d displays and %d ms each, MPixel/s\n",
+	       width, height, loops, min_ms);
+	printf("%-28s %9s %9s %8s  %s\n", "", "optimized", "C", "speedup", "ref / C");
+	for (s = 0; s < NUM_SCALES; s++)
+		for (y = 0; y < NUM_YUV; y++)
+			for (f = 0; f < NUM_FORMATS; f++) {
+				struct result *r0, *r1;
+				int diff = 0, case_bad;
+
+				if (!selected(s, y, &formats[f]))
+					continue;
+				i = (s * NUM_YUV + y) * NUM_FORMATS + f;
+				r0 = &results[0][i];
+				r1 = &results[1][i];
+				for (i = 0; i < NUM_SIZES; i++)
+					if (r0->hash[i] != r1->hash[i])
+						diff = 1;
+				case_bad = r0->ref_bad || diff;
+				bad += case_bad;
+				if (quiet && !case_bad)
+					continue;
+
+				sprintf(name, "%s %s->%s", scale_names[s],
+				        yuv_formats[y].name, formats[f].name);
+				printf("%-28s %9.1f %9.1f %7.2fx  ", name, r0->mpix,
+				       r1->mpix, r1->mpix ? r0->mpix / r1->mpix : 0.0);
+				if (r0->ref_bad)
+					printf("%d BAD", r0->ref_bad);
+				else
+					printf("ok");
+				printf(" / %s\n", diff ? "MISMATCH" : "ok");
+				if (r0->ref_bad)
+					printf("  first at %d,%d of width %d: %08x, "
+					       "expected %08x\n", r0->bad_x,
+					       r0->bad_y, r0->bad_w, r0->bad_got,
+					       r0->bad_expect);
+			}
+	printf("%d failed\n", bad);
+
+	free(results[0]);
+	free(results[1]);
+	SDL_Quit();
+	return bad ? 1 : 0;
+}